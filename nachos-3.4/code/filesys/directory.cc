@@ -11,6 +11,14 @@
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
+//	Entries are placed by hashing the file name, with linear probing
+//	on collisions.  Since the table is stored on disk in exactly this
+//	layout, looking up a name only reads the sectors holding the 
+//	entries on its probe sequence -- usually just one -- instead of 
+//	the whole directory.  Remove shifts later entries of a probe
+//	sequence back into the hole, rather than leaving a "deleted" 
+//	marker, so that lookups never have to scan past stale entries.
+//
 //	Also, this implementation has the restriction that the size
 //	of the directory cannot expand.  In other words, once all the
 //	entries in the directory are used, no more files can be created.
@@ -38,9 +46,14 @@
 Directory::Directory(int size)
 {
     table = new DirectoryEntry[size];
+    loaded = new bool[size];
+    dirty = new bool[size];
     tableSize = size;
-    for (int i = 0; i < tableSize; i++)
+    dirFile = NULL;
+    for (int i = 0; i < tableSize; i++) {
 	table[i].inUse = FALSE;
+	loaded[i] = dirty[i] = TRUE;	// nothing on disk yet
+    }
 }
 
 //----------------------------------------------------------------------
@@ -51,11 +64,15 @@ Directory::Directory(int size)
 Directory::~Directory()
 { 
     delete [] table;
+    delete [] loaded;
+    delete [] dirty;
 } 
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  We don't actually
+//	read anything yet; each entry is read in by Entry the first time 
+//	it's needed.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -63,12 +80,15 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    dirFile = file;
+    for (int i = 0; i < tableSize; i++)
+	loaded[i] = dirty[i] = FALSE;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  Each run
+//	of consecutive changed entries is written with a single WriteAt.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -76,7 +96,55 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int i, j;
+
+    for (i = 0; i < tableSize; i = j) {
+	if (!dirty[i]) {
+	    j = i + 1;
+	    continue;
+	}
+	for (j = i; j < tableSize && dirty[j]; j++)
+	    dirty[j] = FALSE;
+	(void) file->WriteAt((char *)&table[i], 
+		(j - i) * sizeof(DirectoryEntry), i * sizeof(DirectoryEntry));
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::Entry
+// 	Return a pointer to entry "i" of the table, first reading it from
+//	the directory file if we haven't done so yet.
+//
+//	"i" -- index of the entry we want
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::Entry(int i)
+{
+    if (!loaded[i]) {
+	(void) dirFile->ReadAt((char *)&table[i], sizeof(DirectoryEntry), 
+						i * sizeof(DirectoryEntry));
+	loaded[i] = TRUE;
+    }
+    return &table[i];
+}
+
+//----------------------------------------------------------------------
+// Directory::Hash
+// 	Return the slot where "name" would go if there were no collisions.
+//	(FNV-1a over the significant characters of the name.)
+//
+//	"name" -- the file name
+//----------------------------------------------------------------------
+
+int
+Directory::Hash(char *name)
+{
+    unsigned int h = 2166136261u;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	h = (h ^ (unsigned char) name[i]) * 16777619u;
+    return h % tableSize;
 }
 
 //----------------------------------------------------------------------
@@ -84,15 +152,26 @@ Directory::WriteBack(OpenFile *file)
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory.
 //
+//	We start at the name's hash slot and walk forward; since Remove
+//	never leaves holes in a probe sequence, the first free entry we
+//	come to means the name isn't there.
+//
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    int i = Hash(name);
+    DirectoryEntry *entry;
+
+    for (int n = 0; n < tableSize; n++, i = (i + 1) % tableSize) {
+	entry = Entry(i);
+	if (!entry->inUse)
+	    break;
+        if (!strncmp(entry->name, name, FileNameMaxLen))
 	    return i;
+    }
     return -1;		// name not in directory
 }
 
@@ -103,16 +182,19 @@ Directory::FindIndex(char *name)
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDir" -- if non-NULL, set to whether "name" is a directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(char *name)
+Directory::Find(char *name, bool *isDir)
 {
     int i = FindIndex(name);
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (i == -1)
+	return -1;
+    if (isDir != NULL)
+	*isDir = table[i].isDir;
+    return table[i].sector;
 }
 
 //----------------------------------------------------------------------
@@ -124,20 +206,25 @@ Directory::Find(char *name)
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the new file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDir)
 { 
+    int i = Hash(name);
+
     if (FindIndex(name) != -1)
 	return FALSE;
-
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
+    for (int n = 0; n < tableSize; n++, i = (i + 1) % tableSize)
+        if (!Entry(i)->inUse) {
             table[i].inUse = TRUE;
+	    table[i].isDir = isDir;
             strncpy(table[i].name, name, FileNameMaxLen); 
+	    table[i].name[FileNameMaxLen] = '\0';
             table[i].sector = newSector;
-        return TRUE;
+	    dirty[i] = TRUE;
+            return TRUE;
 	}
     return FALSE;	// no space.  Fix when we have extensible files.
 }
@@ -147,6 +234,10 @@ Directory::Add(char *name, int newSector)
 // 	Remove a file name from the directory.  Return TRUE if successful;
 //	return FALSE if the file isn't in the directory. 
 //
+//	To keep probe sequences unbroken, each later entry in the same
+//	cluster that could legally sit in the hole is moved back into it,
+//	which opens a new hole further on; we stop at the first free entry.
+//
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
@@ -154,24 +245,51 @@ bool
 Directory::Remove(char *name)
 { 
     int i = FindIndex(name);
+    int j, home;
 
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    dirty[i] = TRUE;
+    for (j = (i + 1) % tableSize; Entry(j)->inUse; j = (j + 1) % tableSize) {
+	home = Hash(table[j].name);
+	// can table[j] move to i?  only if its home isn't in (i, j]
+	if ((i < j) ? (home <= i || home > j) : (home <= i && home > j)) {
+	    table[i] = table[j];
+	    table[j].inUse = FALSE;
+	    dirty[i] = dirty[j] = TRUE;
+	    i = j;
+	}
+    }
     return TRUE;	
 }
 
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return TRUE if there are no files in the directory.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    for (int i = 0; i < tableSize; i++)
+	if (Entry(i)->inUse)
+	    return FALSE;
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory.  Directories are
+//	marked with a trailing "/".
 //----------------------------------------------------------------------
 
 void
 Directory::List()
 {
    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+	if (Entry(i)->inUse)
+	    printf("%s%s\n", table[i].name, table[i].isDir ? "/" : "");
 }
 
 //----------------------------------------------------------------------
@@ -187,8 +305,9 @@ Directory::Print()
 
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	if (Entry(i)->inUse) {
+	    printf("Name: %s%s, Sector: %d\n", table[i].name, 
+				table[i].isDir ? "/" : "", table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
@@ -4,7 +4,13 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry can
+//	itself name a directory, so directories form a tree.
+//
+//	The table is a hash table (open addressing, linear probing), 
+//	and is kept that way on disk, so a lookup only needs to read
+//	the few entries on the name's probe sequence, not the whole
+//	directory file.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -19,8 +25,8 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		27	// for simplicity, we assume 
+					// file names are <= 27 characters long
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,6 +38,7 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool isDir;				// Is it a (sub)directory?
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
@@ -46,7 +53,9 @@ class DirectoryEntry {
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  FetchFrom doesn't read anything by itself -- entries
+// are brought in from the file the first time they are looked at, and
+// WriteBack only writes the entries that have changed.
 
 class Directory {
   public:
@@ -58,13 +67,18 @@ class Directory {
     void WriteBack(OpenFile *file);	// Write modifications to 
 					// directory contents back to disk
 
-    int Find(char *name);		// Find the sector number of the 
-					// FileHeader for file: "name"
+    int Find(char *name, bool *isDir = NULL);
+					// Find the sector number of the 
+					// FileHeader for file: "name", and
+					// whether it is a directory
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir = FALSE);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
+    bool IsEmpty();			// Are there no files in it?
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
@@ -75,6 +89,14 @@ class Directory {
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    bool *loaded;			// Has table[i] been read from disk?
+    bool *dirty;			// Has table[i] changed since then?
+    OpenFile *dirFile;			// Where to read entries from, 
+					// or NULL for a new directory
+
+    DirectoryEntry *Entry(int i);	// Return table[i], reading it in
+					//  from disk if necessary
+    int Hash(char *name);		// Where "name" belongs in the table
 
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
@@ -34,20 +34,46 @@
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
+//	We try to put the data in a single extent of consecutive sectors,
+//	so that reading the file sequentially needs at most one seek
+//	(plus one per track boundary crossed).  Only if the disk is too
+//	fragmented for that do we fall back to taking whatever sectors 
+//	happen to be free.
+//
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the size of the file, in bytes
+//	"near" is where we'd like the data to start (e.g., right after
+//		the file header)
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(BitMap *freeMap, int fileSize, int near)
 { 
+    int first;
+
     numBytes = fileSize;
     numSectors  = divRoundUp(fileSize, SectorSize);
+    if (numSectors > (int) NumDirect)
+	return FALSE;		// too big for one header
     if (freeMap->NumClear() < numSectors)
 	return FALSE;		// not enough space
-
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+    if (numSectors == 0)
+	return TRUE;
+
+    first = freeMap->FindRun(numSectors, near);
+    if (first == -1)
+	first = freeMap->FindRun(numSectors, 0);
+    if (first != -1) {
+        DEBUG('f', "Allocating extent [%d, %d)\n", first, first + numSectors);
+	for (int i = 0; i < numSectors; i++) {
+	    freeMap->Mark(first + i);
+	    dataSectors[i] = first + i;
+	}
+    } else {
+        DEBUG('f', "No extent of %d sectors, scattering\n", numSectors);
+	for (int i = 0; i < numSectors; i++)
+	    dataSectors[i] = freeMap->Find();
+    }
     return TRUE;
 }
 
@@ -37,9 +37,12 @@
 
 class FileHeader {
   public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    bool Allocate(BitMap *bitMap, int fileSize, int near = 0);
+						// Initialize a file header, 
 						//  including allocating space 
-						//  on disk for the file data
+						//  on disk for the file data,
+						//  contiguously if possible,
+						//  starting at "near"
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
 
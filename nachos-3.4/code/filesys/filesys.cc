@@ -18,6 +18,15 @@
 //	(sector 0 and sector 1), so that the file system can find them 
 //	on bootup.
 //
+//	That directory is the root of a tree: an entry can name another
+//	directory (itself just a file holding a directory table), and
+//	file names are paths such as "/usr/bin/ls", looked up one 
+//	component at a time starting at the root.  A leading "/" is
+//	optional, since there is no notion of a current directory.
+//	The results of those lookups are kept in a name cache, and file
+//	headers in a header cache (cf. fscache.h), so opening a file
+//	that was used recently doesn't have to touch the disk at all.
+//
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
@@ -28,16 +37,18 @@
 //	modified part of the directory and/or bitmap, we simply discard
 //	the changed version, without writing it back to disk.
 //
+//	Those writes go through the journal (cf. journal.h): they are
+//	committed to a log first, as one atomic transaction, so if Nachos
+//	exits in the middle of an operation the disk is still consistent
+//	once the log is replayed, the next time the file system starts up.
+//	Operations are run one at a time, under a lock.
+//
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
 //	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   only a limited number of files can be added to each directory
+//	   file data is not journaled, only metadata
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -50,6 +61,8 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "journal.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -60,10 +73,45 @@
 // Initial file sizes for the bitmap and directory; until the file system
 // supports extensible files, the directory size sets the maximum number 
 // of files that can be loaded onto the disk.
-#define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
+#define FreeMapSize(sectors)	(divRoundUp(sectors, BitsInWord) * sizeof(int))
+#define FreeMapFileSize 	FreeMapSize(synchDisk->TotalSectors())
+#define NumDirEntries 		64
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
+//----------------------------------------------------------------------
+// FileSystemFits
+// 	Return TRUE if the file system can be put on "numDisks" disks of
+//	the geometry -geometry set.  The journal and the log-structured
+//	layout both depend on this (cf. journal.h, logdisk.h):
+//
+//	  - tracks have an even number of sectors, so the log can
+//	    alternate slots and keep its checkpoints in the two halves
+//	    of track 0;
+//	  - every sector number fits in a short, as the journal's
+//	    descriptors and the log's maps keep them;
+//	  - the log fits on the disk, and has room for the biggest
+//	    operation in one transaction;
+//	  - the free map fits in one file header, and a mkdir, which
+//	    rewrites all of it, fits in one operation.
+//----------------------------------------------------------------------
+
+bool
+FileSystemFits(int numDisks)
+{
+    int total = numDisks * NumSectors;
+    int mapSectors = divRoundUp(FreeMapSize(total), SectorSize);
+    int dirSectors = divRoundUp(DirectoryFileSize, SectorSize);
+
+    return (sectorsPerTrack % 2 == 0)
+	&& (total <= 32767)
+	&& (JournalStart + JournalSectors <= total)
+	&& (JournalOpSectors <= JournalTxnSectors)
+	&& (mapSectors <= (int) NumDirect)
+	&& (1 + mapSectors + dirSectors + 2 <= JournalOpSectors);
+					// header, free map, directory
+					// table, and the parent's entry
+}
+
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format = TRUE, the disk has
@@ -71,8 +119,8 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).  
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we just have to replay the journal, and open 
+//	the files representing the bitmap and the directory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
@@ -80,8 +128,11 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    nameCache = new NameCache(NameCacheSize);
+    fsLock = new Lock("file system");
+    journal = new Journal;
     if (format) {
-        BitMap *freeMap = new BitMap(NumSectors);
+        BitMap *freeMap = new BitMap(synchDisk->TotalSectors());
         Directory *directory = new Directory(NumDirEntries);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
@@ -92,12 +143,17 @@ FileSystem::FileSystem(bool format)
     // (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	for (int i = 0; i < JournalSectors; i++)	// and the log, too
+	    freeMap->Mark(JournalStart + i);
+	for (int i = synchDisk->Capacity(); i < synchDisk->TotalSectors(); i++)
+	    freeMap->Mark(i);		// and what a log-structured disk
+					// keeps for itself
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
 
-	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, DirectorySector + 1));
+	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, DirectorySector + 1));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -124,6 +180,7 @@ FileSystem::FileSystem(bool format)
         DEBUG('f', "Writing bitmap and directory back to disk.\n");
 	freeMap->WriteBack(freeMapFile);	 // flush changes to disk
 	directory->WriteBack(directoryFile);
+	journal->Format();
 
 	if (DebugIsEnabled('f')) {
 	    freeMap->Print();
@@ -135,11 +192,162 @@ FileSystem::FileSystem(bool format)
 	delete dirHdr;
 	}
     } else {
-    // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+    // if we are not formatting the disk, finish any operations that were
+    // committed to the journal before we last stopped, then just open the 
+    // files representing the bitmap and directory; these are left open 
+    // while Nachos is running
+	journal->Recover();
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
     }
+    synchDisk->SetJournal(journal);	// log all metadata changes from now on
+}
+
+//----------------------------------------------------------------------
+// FileSystem::BeginUpdate, FileSystem::EndUpdate
+// 	Bracket an operation that changes the file system.  Operations
+//	run one at a time, and the journal collects everything each one
+//	writes.  EndUpdate returns once the operation is committed to the
+//	log -- but it lets the next operation start first, so that the
+//	two can be committed together (group commit).
+//----------------------------------------------------------------------
+
+void
+FileSystem::BeginUpdate()
+{
+    fsLock->Acquire();
+    journal->Begin();
+}
+
+void
+FileSystem::EndUpdate()
+{
+    int txn = journal->End();
+
+    fsLock->Release();
+    journal->Commit(txn);
+}
+
+//----------------------------------------------------------------------
+// FindExtent
+// 	Find room for a new file: its header followed immediately by
+//	"count" - 1 data sectors.  Sectors are numbered consecutively
+//	around a track, so a run that stays on one track can be read 
+//	with a single seek; prefer that, and otherwise take the first
+//	run that fits anywhere (it will spill onto the next track).
+//
+//	Return the first sector of the run, or -1 if there is none.
+//	The sectors are not marked.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"count" is the number of sectors needed
+//----------------------------------------------------------------------
+
+static int
+FindExtent(BitMap *freeMap, int count)
+{
+    int first;
+
+    if (count <= sectorsPerTrack)
+	for (first = freeMap->FindRun(count, 0); first != -1; 
+	      first = freeMap->FindRun(count, 
+			(first / sectorsPerTrack + 1) * sectorsPerTrack))
+	    if (first / sectorsPerTrack == 
+				(first + count - 1) / sectorsPerTrack)
+		return first;
+    return freeMap->FindRun(count, 0);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory, FileSystem::CloseDirectory
+// 	Open (close) the directory file whose header is in "sector".  The
+//	root directory is always open, so we just hand back that.
+//----------------------------------------------------------------------
+
+OpenFile *
+FileSystem::OpenDirectory(int sector)
+{
+    if (sector == DirectorySector)
+	return directoryFile;
+    return new OpenFile(sector);
+}
+
+void
+FileSystem::CloseDirectory(OpenFile *dirFile)
+{
+    if (dirFile != directoryFile)
+	delete dirFile;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Return the sector of the file header for "name" in the directory
+//	whose header is in "dirSector", or -1 if there is no such file.
+//	We only read the directory if the name cache doesn't know.
+//
+//	"isDir" -- set to whether "name" is a directory, if found
+//----------------------------------------------------------------------
+
+int
+FileSystem::Lookup(int dirSector, char *name, bool *isDir)
+{
+    OpenFile *dirFile;
+    Directory *directory;
+    int sector = nameCache->Find(dirSector, name, isDir);
+
+    if (sector != -1)
+	return sector;
+    dirFile = OpenDirectory(dirSector);
+    directory = new Directory(NumDirEntries);
+    directory->FetchFrom(dirFile);
+    sector = directory->Find(name, isDir);
+    delete directory;
+    CloseDirectory(dirFile);
+    if (sector != -1)
+	nameCache->Add(dirSector, name, sector, *isDir);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindParent
+// 	Walk down the directory tree along "path", and return the sector
+//	of the header of the directory that (should) contain the last
+//	component of the path.  That last component is copied to "leaf".
+//
+//	Return -1 if one of the directories along the way doesn't exist
+//	(or isn't a directory), or if some component is empty or longer
+//	than FileNameMaxLen.
+//
+//	"path" -- the name of a file, e.g. "/usr/bin/ls"
+//	"leaf" -- where to put the file's name within its directory, 
+//		e.g. "ls"; must have room for FileNameMaxLen + 1 chars
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindParent(char *path, char *leaf)
+{
+    int sector = DirectorySector;
+    bool isDir;
+    int len;
+
+    while (*path == '/')
+	path++;
+    for (;;) {
+	for (len = 0; path[len] != '/' && path[len] != '\0'; len++)
+	    ;
+	if (len == 0 || len > FileNameMaxLen)
+	    return -1;			// bad name
+	strncpy(leaf, path, len);
+	leaf[len] = '\0';
+	for (path += len; *path == '/'; path++)
+	    ;
+	if (*path == '\0')
+	    return sector;		// "leaf" was the last component
+
+	sector = Lookup(sector, leaf, &isDir);
+	if (sector == -1 || !isDir)
+	    return -1;			// no such directory
+    }
 }
 
 //----------------------------------------------------------------------
@@ -148,62 +356,124 @@ FileSystem::FileSystem(bool format)
 //	Since we can't increase the size of files dynamically, we have
 //	to give Create the initial size of the file.
 //
+//	"name" -- name of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize)
+{
+    bool success;
+
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    BeginUpdate();
+    success = CreateEntry(name, initialSize, FALSE);
+    EndUpdate();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateDirectory
+// 	Create a new, empty directory (similar to UNIX mkdir).
+//
+//	"name" -- name of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::CreateDirectory(char *name)
+{
+    bool success;
+
+    DEBUG('f', "Creating directory %s\n", name);
+    BeginUpdate();
+    success = CreateEntry(name, DirectoryFileSize, TRUE);
+    EndUpdate();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Do the work of Create and CreateDirectory.
+//
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
+//	    (if we can, the header and the data go in one contiguous
+//	    extent, so reading the file doesn't seek)
 //	  Add the name to the directory
 //	  Store the new file header on disk 
+//	  If it's a directory, store an empty directory table in it
 //	  Flush the changes to the bitmap and the directory back to disk
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		a directory along the path doesn't exist
 //   		file is already in directory
 //	 	no free space for file header
 //	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+// 	Called between BeginUpdate and EndUpdate.
 //
-//	"name" -- name of file to be created
+//	"path" -- name of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDir" -- is it a directory?
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Create(char *name, int initialSize)
+FileSystem::CreateEntry(char *path, int initialSize, bool isDir)
 {
     Directory *directory;
     BitMap *freeMap;
     FileHeader *hdr;
-    int sector;
+    OpenFile *dirFile, *newFile;
+    char name[FileNameMaxLen + 1];
+    int dirSector, sector;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
-
+    dirSector = FindParent(path, name);
+    if (dirSector == -1)
+	return FALSE;			// no such directory
+    dirFile = OpenDirectory(dirSector);
     directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    directory->FetchFrom(dirFile);
 
     if (directory->Find(name) != -1)
       success = FALSE;			// file is already in directory
     else {	
-        freeMap = new BitMap(NumSectors);
+        freeMap = new BitMap(synchDisk->TotalSectors());
         freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();	// find a sector to hold the file header
+        sector = FindExtent(freeMap, 1 + divRoundUp(initialSize, SectorSize));
+	if (sector != -1)
+	    freeMap->Mark(sector);	// header first, data right after it
+	else
+            sector = freeMap->Find();	// find a sector to hold the file header
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
+        else if (!directory->Add(name, sector, isDir))
             success = FALSE;	// no space in directory
 	else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
+	    if (!hdr->Allocate(freeMap, initialSize, sector + 1))
             	success = FALSE;	// no space on disk for data
 	    else {	
 	    	success = TRUE;
 		// everthing worked, flush all changes back to disk
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
+		headerCache->Invalidate(sector);	// in case it's stale
+		nameCache->Add(dirSector, name, sector, isDir);
+		if (isDir) {
+		    Directory *newDir = new Directory(NumDirEntries);
+
+		    newFile = new OpenFile(sector);
+		    newDir->WriteBack(newFile);
+		    delete newDir;
+		    delete newFile;
+		}
+    	    	directory->WriteBack(dirFile);
     	    	freeMap->WriteBack(freeMapFile);
 	    }
             delete hdr;
@@ -211,6 +481,7 @@ FileSystem::Create(char *name, int initialSize)
         delete freeMap;
     }
     delete directory;
+    CloseDirectory(dirFile);
     return success;
 }
 
@@ -221,22 +492,25 @@ FileSystem::Create(char *name, int initialSize)
 //	  Find the location of the file's header, using the directory 
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"path" -- the text name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
-FileSystem::Open(char *name)
+FileSystem::Open(char *path)
 { 
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
+    char name[FileNameMaxLen + 1];
     int sector;
+    bool isDir;
 
-    DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
+    DEBUG('f', "Opening file %s\n", path);
+    fsLock->Acquire();
+    sector = FindParent(path, name);
+    if (sector != -1)
+	sector = Lookup(sector, name, &isDir); 
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    fsLock->Release();
     return openFile;				// return NULL if not found
 }
 
@@ -249,30 +523,55 @@ FileSystem::Open(char *name)
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system.  A directory can only be removed once it
+//	is empty.
 //
-//	"name" -- the text name of the file to be removed
+//	"path" -- the text name of the file to be removed
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Remove(char *path)
+{ 
+    bool success;
+
+    DEBUG('f', "Removing file %s\n", path);
+    BeginUpdate();
+    success = RemoveEntry(path);
+    EndUpdate();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::RemoveEntry
+// 	Do the work of Remove.  Called between BeginUpdate and EndUpdate.
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Remove(char *name)
+FileSystem::RemoveEntry(char *path)
 { 
     Directory *directory;
     BitMap *freeMap;
     FileHeader *fileHdr;
-    int sector;
+    OpenFile *dirFile;
+    char name[FileNameMaxLen + 1];
+    int dirSector, sector;
+    bool isDir;
     
+    dirSector = FindParent(path, name);
+    if (dirSector == -1)
+	return FALSE;			// no such directory
+    dirFile = OpenDirectory(dirSector);
     directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
+    directory->FetchFrom(dirFile);
+    sector = directory->Find(name, &isDir);
+    if (sector == -1 || (isDir && !IsEmptyDirectory(sector))) {
        delete directory;
-       return FALSE;			 // file not found 
+       CloseDirectory(dirFile);
+       return FALSE;			 // file not found, or dir not empty
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
+    fileHdr = headerCache->Acquire(sector);
 
-    freeMap = new BitMap(NumSectors);
+    freeMap = new BitMap(synchDisk->TotalSectors());
     freeMap->FetchFrom(freeMapFile);
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
@@ -280,26 +579,69 @@ FileSystem::Remove(char *name)
     directory->Remove(name);
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
-    delete fileHdr;
+    directory->WriteBack(dirFile);        	// flush to disk
+    headerCache->Release(fileHdr);
+    headerCache->Invalidate(sector);		// forget the file
+    nameCache->Remove(dirSector, name);
     delete directory;
     delete freeMap;
+    CloseDirectory(dirFile);
     return TRUE;
 } 
 
 //----------------------------------------------------------------------
-// FileSystem::List
-// 	List all the files in the file system directory.
+// FileSystem::IsEmptyDirectory
+// 	Return TRUE if the directory whose header is in "sector" has no
+//	files in it.
 //----------------------------------------------------------------------
 
-void
-FileSystem::List()
+bool
+FileSystem::IsEmptyDirectory(int sector)
 {
+    OpenFile *dirFile = OpenDirectory(sector);
     Directory *directory = new Directory(NumDirEntries);
+    bool empty;
 
-    directory->FetchFrom(directoryFile);
-    directory->List();
+    directory->FetchFrom(dirFile);
+    empty = directory->IsEmpty();
     delete directory;
+    CloseDirectory(dirFile);
+    return empty;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::List
+// 	List all the files in a file system directory.
+//
+//	"path" -- the directory to list, or NULL for the root
+//----------------------------------------------------------------------
+
+void
+FileSystem::List(char *path)
+{
+    Directory *directory;
+    OpenFile *dirFile;
+    char name[FileNameMaxLen + 1];
+    int sector = DirectorySector;
+    bool isDir = TRUE;
+
+    fsLock->Acquire();
+    if (path != NULL) {
+	sector = FindParent(path, name);
+	if (sector != -1)
+	    sector = Lookup(sector, name, &isDir);
+    }
+    if (sector == -1 || !isDir)
+	printf("%s: no such directory\n", path);
+    else {
+	dirFile = OpenDirectory(sector);
+	directory = new Directory(NumDirEntries);
+	directory->FetchFrom(dirFile);
+	directory->List();
+	delete directory;
+	CloseDirectory(dirFile);
+    }
+    fsLock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -317,7 +659,7 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
+    BitMap *freeMap = new BitMap(synchDisk->TotalSectors());
     Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:\n");
@@ -65,6 +65,11 @@ class FileSystem {
 };
 
 #else // FILESYS
+#include "fscache.h"
+
+class Lock;
+class Journal;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -77,11 +82,15 @@ class FileSystem {
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
 
+    bool CreateDirectory(char *name);	// Create a directory (UNIX mkdir)
+
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
-    bool Remove(char *name);  		// Delete a file (UNIX unlink)
+    bool Remove(char *name);  		// Delete a file (UNIX unlink),
+					// or an empty directory (UNIX rmdir)
 
-    void List();			// List all the files in the file system
+    void List(char *name = NULL);	// List all the files in a directory
+					// (by default, the root)
 
     void Print();			// List all the files and their contents
 
@@ -90,8 +99,29 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   NameCache *nameCache;		// Recently looked up names
+   Lock *fsLock;			// One operation at a time
+   Journal *journal;			// Log of metadata changes
+
+   void BeginUpdate();			// Start/finish an operation that
+   void EndUpdate();			// changes the file system
+
+   bool CreateEntry(char *name, int initialSize, bool isDir);
+					// Create a file or a directory
+   bool RemoveEntry(char *name);	// Remove a file or a directory
+   int Lookup(int dirSector, char *name, bool *isDir);
+					// Find "name" in a directory
+   int FindParent(char *path, char *leaf);
+					// Find the directory containing 
+					// "path", and "path"'s name in it
+   OpenFile *OpenDirectory(int sector);	// Open/close the directory file
+   void CloseDirectory(OpenFile *dirFile);	// with header in "sector"
+   bool IsEmptyDirectory(int sector);	// Does it have no files in it?
 };
 
+extern bool FileSystemFits(int numDisks);	// Can a file system be put
+					// on that many disks of this geometry?
+
 #endif // FILESYS
 
 #endif // FS_H
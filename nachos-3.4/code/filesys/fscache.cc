@@ -0,0 +1,265 @@
+// fscache.cc
+//	Routines to cache file system metadata in memory: the name cache
+//	(which file header a name in a directory refers to) and the
+//	header cache (the file headers themselves).
+//
+//	The name cache is a direct-mapped hash table -- a lookup costs
+//	one hash and one string compare, and collisions just evict.
+//
+//	The header cache is a list in most-recently-used order.  It is
+//	small enough (the open files plus HeaderCacheSize others) that a
+//	linear search costs nothing next to the disk read it saves.
+
+#include "copyright.h"
+#include "utility.h"
+#include "fscache.h"
+
+//----------------------------------------------------------------------
+// NameCache::NameCache
+// 	Initialize an empty name cache.
+//
+//	"size" is the number of slots in the cache
+//----------------------------------------------------------------------
+
+NameCache::NameCache(int size)
+{
+    table = new NameCacheEntry[size];
+    tableSize = size;
+    for (int i = 0; i < tableSize; i++)
+	table[i].valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// NameCache::~NameCache
+// 	De-allocate the name cache.
+//----------------------------------------------------------------------
+
+NameCache::~NameCache()
+{
+    delete [] table;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Hash
+// 	Return the slot for the <directory, name> pair.
+//----------------------------------------------------------------------
+
+int
+NameCache::Hash(int dirSector, char *name)
+{
+    unsigned int h = 2166136261u ^ (unsigned int) dirSector;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	h = (h ^ (unsigned char) name[i]) * 16777619u;
+    return h % tableSize;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Find
+// 	Return the sector of the file header for "name" in the directory
+//	whose header is at "dirSector", or -1 if we don't know it.
+//
+//	"isDir" -- set to whether "name" is a directory, if found
+//----------------------------------------------------------------------
+
+int
+NameCache::Find(int dirSector, char *name, bool *isDir)
+{
+    NameCacheEntry *entry = &table[Hash(dirSector, name)];
+
+    if (!entry->valid || entry->dirSector != dirSector
+	    || strncmp(entry->name, name, FileNameMaxLen))
+	return -1;
+    DEBUG('f', "Name cache hit: %s in %d -> %d\n", name, dirSector,
+						entry->sector);
+    if (isDir != NULL)
+	*isDir = entry->isDir;
+    return entry->sector;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Add
+// 	Remember that "name" in directory "dirSector" has its header in
+//	"sector".  Replaces whatever was in the slot.
+//----------------------------------------------------------------------
+
+void
+NameCache::Add(int dirSector, char *name, int sector, bool isDir)
+{
+    NameCacheEntry *entry = &table[Hash(dirSector, name)];
+
+    entry->valid = TRUE;
+    entry->dirSector = dirSector;
+    strncpy(entry->name, name, FileNameMaxLen);
+    entry->name[FileNameMaxLen] = '\0';
+    entry->sector = sector;
+    entry->isDir = isDir;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Remove
+// 	Forget about "name" in directory "dirSector", if we knew it.
+//----------------------------------------------------------------------
+
+void
+NameCache::Remove(int dirSector, char *name)
+{
+    NameCacheEntry *entry = &table[Hash(dirSector, name)];
+
+    if (entry->valid && entry->dirSector == dirSector
+	    && !strncmp(entry->name, name, FileNameMaxLen))
+	entry->valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::HeaderCache
+// 	Initialize an empty header cache.
+//
+//	"size" is how many headers to keep once no one is using them
+//----------------------------------------------------------------------
+
+HeaderCache::HeaderCache(int size)
+{
+    maxUnused = size;
+    numUnused = 0;
+    first = NULL;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::~HeaderCache
+// 	De-allocate the header cache, and all the headers in it.
+//----------------------------------------------------------------------
+
+HeaderCache::~HeaderCache()
+{
+    while (first != NULL)
+	delete Unlink(NULL, first);
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Unlink
+// 	Take "entry" off the list, and return it.
+//
+//	"prev" -- the entry before it on the list, or NULL if it's first
+//----------------------------------------------------------------------
+
+CachedHeader *
+HeaderCache::Unlink(CachedHeader *prev, CachedHeader *entry)
+{
+    if (prev == NULL)
+	first = entry->next;
+    else
+	prev->next = entry->next;
+    entry->next = NULL;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Acquire
+// 	Return the file header stored in "sector", reading it from disk
+//	only if it isn't cached.  The header is shared, and stays in
+//	memory at least until a matching Release.
+//
+//	"sector" -- where the header is on disk
+//----------------------------------------------------------------------
+
+FileHeader *
+HeaderCache::Acquire(int sector)
+{
+    CachedHeader *entry, *prev = NULL;
+
+    for (entry = first; entry != NULL; prev = entry, entry = entry->next)
+	if (entry->sector == sector)
+	    break;
+    if (entry != NULL) {
+	DEBUG('f', "Header cache hit: sector %d\n", sector);
+	Unlink(prev, entry);
+	if (entry->refCount == 0)
+	    numUnused--;
+    } else {
+	entry = new CachedHeader;
+	entry->sector = sector;
+	entry->refCount = 0;
+	entry->hdr.FetchFrom(sector);
+    }
+    entry->next = first;		// move to the front
+    first = entry;
+    entry->refCount++;
+    return &entry->hdr;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Release
+// 	The caller is done with "hdr".  If nobody else is using it, it
+//	stays cached (unless it was invalidated), but may be thrown out
+//	to make room.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Release(FileHeader *hdr)
+{
+    CachedHeader *entry, *prev = NULL;
+
+    for (entry = first; entry != NULL; prev = entry, entry = entry->next)
+	if (&entry->hdr == hdr)
+	    break;
+    ASSERT(entry != NULL && entry->refCount > 0);
+    if (--entry->refCount > 0)
+	return;
+    if (entry->sector == -1)		// removed while it was open
+	delete Unlink(prev, entry);
+    else {
+	numUnused++;
+	Trim();
+    }
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Invalidate
+// 	The header in "sector" is no longer valid (the file was removed,
+//	or a new header was written there).  Forget the cached copy; if
+//	someone still has it, they keep it until they Release it.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Invalidate(int sector)
+{
+    CachedHeader *entry, *prev = NULL;
+
+    for (entry = first; entry != NULL; prev = entry, entry = entry->next)
+	if (entry->sector == sector)
+	    break;
+    if (entry == NULL)
+	return;
+    if (entry->refCount > 0)
+	entry->sector = -1;		// delete it on the last Release
+    else {
+	numUnused--;
+	delete Unlink(prev, entry);
+    }
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Trim
+// 	Throw out the least recently used unreferenced headers, until
+//	there are no more than maxUnused of them.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Trim()
+{
+    CachedHeader *entry, *prev, *victim, *victimPrev;
+
+    while (numUnused > maxUnused) {
+	victim = victimPrev = NULL;
+	for (prev = NULL, entry = first; entry != NULL;
+					prev = entry, entry = entry->next)
+	    if (entry->refCount == 0) {
+		victim = entry;
+		victimPrev = prev;
+	    }
+	ASSERT(victim != NULL);
+	delete Unlink(victimPrev, victim);
+	numUnused--;
+    }
+}
@@ -0,0 +1,107 @@
+// fscache.h
+//	Data structures to let the file system avoid going back to disk
+//	for metadata it has looked at recently:
+//
+//	   NameCache -- remembers which file header sector a name in a
+//		given directory refers to (in UNIX, the "dentry" cache),
+//		so a path can be resolved without reading any directories
+//
+//	   HeaderCache -- keeps file headers in memory, one copy per
+//		file, shared by every OpenFile on that file (in UNIX, the
+//		"inode" cache), so re-opening a file doesn't re-read its
+//		header
+//
+//	Only names that exist are cached; a miss just means "go look in
+//	the directory".  So the file system only has to tell the caches
+//	when a file goes away (or a header sector is reused).
+//
+//      We assume mutual exclusion is provided by the caller.
+
+#include "copyright.h"
+
+#ifndef FSCACHE_H
+#define FSCACHE_H
+
+#include "filehdr.h"
+#include "directory.h"
+
+#define NameCacheSize		128	// # of slots in the name cache
+#define HeaderCacheSize		32	// # of headers kept around after
+					// their last OpenFile is closed
+
+// One slot of the name cache: <directory, name> -> file header sector.
+
+class NameCacheEntry {
+  public:
+    bool valid;				// Does this slot hold anything?
+    int dirSector;			// Header sector of the directory
+    char name[FileNameMaxLen + 1];	// Name of the file in it
+    int sector;				// Header sector of the file
+    bool isDir;				// Is the file a directory?
+};
+
+// The following class defines the name cache.  It's a direct-mapped
+// hash table: each <directory, name> pair can only live in one slot,
+// and a new pair simply replaces whatever was there.
+
+class NameCache {
+  public:
+    NameCache(int size);		// Initialize an empty cache
+    ~NameCache();			// De-allocate the cache
+
+    int Find(int dirSector, char *name, bool *isDir);
+					// Return the header sector of "name"
+					// in the given directory, or -1 if
+					// it isn't cached
+    void Add(int dirSector, char *name, int sector, bool isDir);
+					// Remember where "name" is
+    void Remove(int dirSector, char *name);
+					// Forget "name" -- it's been deleted
+
+  private:
+    int tableSize;			// Number of slots
+    NameCacheEntry *table;		// The slots
+
+    int Hash(int dirSector, char *name);	// Which slot the pair goes in
+};
+
+// An in-memory file header, plus the bookkeeping the cache needs.
+
+class CachedHeader {
+  public:
+    FileHeader hdr;			// The header itself
+    int sector;				// Where it is on disk; -1 if it has
+					// been invalidated while in use
+    int refCount;			// Number of OpenFiles using it
+    CachedHeader *next;			// Next entry, in LRU order
+};
+
+// The following class defines the header cache.  Headers in use are
+// always kept; of the ones not in use, the HeaderCacheSize most
+// recently used are kept as well.
+
+class HeaderCache {
+  public:
+    HeaderCache(int size);		// Initialize an empty cache
+    ~HeaderCache();			// De-allocate the cache
+
+    FileHeader *Acquire(int sector);	// Return the header stored in
+					// "sector", reading it in if it's
+					// not cached; must be Released
+    void Release(FileHeader *hdr);	// Done with a header from Acquire
+
+    void Invalidate(int sector);	// The header in "sector" has been
+					// freed or rewritten on disk
+
+  private:
+    int maxUnused;			// Max # of unreferenced headers kept
+    int numUnused;			// Current # of unreferenced headers
+    CachedHeader *first;		// Most recently used header
+
+    CachedHeader *Unlink(CachedHeader *prev, CachedHeader *entry);
+					// Take "entry" off the list
+    void Trim();			// Throw out LRU unreferenced headers
+					// until there are at most maxUnused
+};
+
+#endif // FSCACHE_H
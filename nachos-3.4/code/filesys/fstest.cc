@@ -7,6 +7,13 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   DirectoryTest -- create, look up and remove lots of files
+//		spread over a few directories, and report the cost of each
+//	   CreateRemoveTest -- many threads creating and removing files
+//		at once, to measure metadata update throughput
+//	   WriteTest -- lots of small writes to lots of small files,
+//		to compare write throughput with and without a 
+//		log-structured disk (-lfs)
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,6 +27,7 @@
 #include "thread.h"
 #include "disk.h"
 #include "stats.h"
+#include "synch.h"
 
 #define TransferSize 	10 	// make it small, just to be difficult
 
@@ -106,6 +114,9 @@ Print(char *name)
 //	  FileWrite -- write the file
 //	  FileRead -- read the file
 //	  PerformanceTest -- overall control, and print out performance #'s
+//
+//	Also prints how long the test took the host to run, per disk
+//	request, to measure the simulator itself (cf. disk.h).
 //----------------------------------------------------------------------
 
 #define FileName 	"TestFile"
@@ -172,14 +183,275 @@ FileRead()
 void
 PerformanceTest()
 {
+    double start;
+    int requests;
+
     printf("Starting file system performance test:\n");
     stats->Print();
+    requests = stats->numDiskReads + stats->numDiskWrites;
+    start = HostTime();
     FileWrite();
     FileRead();
     if (!fileSystem->Remove(FileName)) {
       printf("Perf test: unable to remove %s\n", FileName);
       return;
     }
+    start = HostTime() - start;
+    requests = stats->numDiskReads + stats->numDiskWrites - requests;
     stats->Print();
+    printf("Host time %.3f seconds, %d disk requests", start, requests);
+    if (requests > 0)
+	printf(", %.2f microseconds each", start * 1000000 / requests);
+    printf("\n");
+}
+
+
+// Directory test: the files go in subdirectories of DirTestName, 
+// FilesPerDir to a subdirectory, so no directory table gets more than 
+// about two-thirds full.  (Each subdirectory costs 19 sectors and each 
+// empty file one, so the default-sized disk holds about 600 files.)
+
+#define DirTestName	"/dirtest"
+#define FilesPerDir	40
+
+static void
+DirTestPath(char *path, int i)
+{
+    sprintf(path, "%s/d%d/file%d", DirTestName, i / FilesPerDir, i);
+}
+
+static void
+DirTestReport(char *what, int numFiles, Statistics *before)
+{
+    printf("%s %d files: %d ticks, %d disk reads, %d disk writes\n", what,
+	numFiles, stats->totalTicks - before->totalTicks, 
+	stats->numDiskReads - before->numDiskReads,
+	stats->numDiskWrites - before->numDiskWrites);
+    *before = *stats;
+}
+
+//----------------------------------------------------------------------
+// DirectoryTest
+// 	Create "numFiles" empty files, open each one by name, and then
+//	remove them all (and their directories), printing the time and 
+//	disk traffic for each phase.
+//----------------------------------------------------------------------
+
+void
+DirectoryTest(int numFiles)
+{
+    char path[100];
+    Statistics before = *stats;
+    OpenFile *openFile;
+    int i;
+
+    printf("Starting directory performance test, %d files:\n", numFiles);
+    if (!fileSystem->CreateDirectory(DirTestName)) {
+	printf("Dir test: can't create %s\n", DirTestName);
+	return;
+    }
+    for (i = 0; i < numFiles; i++) {
+	if (i % FilesPerDir == 0) {
+	    sprintf(path, "%s/d%d", DirTestName, i / FilesPerDir);
+	    if (!fileSystem->CreateDirectory(path)) {
+		printf("Dir test: can't create %s\n", path);
+		return;
+	    }
+	}
+	DirTestPath(path, i);
+	if (!fileSystem->Create(path, 0)) {
+	    printf("Dir test: can't create %s\n", path);
+	    return;
+	}
+    }
+    DirTestReport("Created", numFiles, &before);
+
+    for (i = 0; i < numFiles; i++) {
+	DirTestPath(path, i);
+	if ((openFile = fileSystem->Open(path)) == NULL) {
+	    printf("Dir test: unable to open %s\n", path);
+	    return;
+	}
+	delete openFile;
+    }
+    DirTestReport("Looked up", numFiles, &before);
+
+    for (i = 0; i < numFiles; i++) {
+	DirTestPath(path, i);
+	if (!fileSystem->Remove(path)) {
+	    printf("Dir test: unable to remove %s\n", path);
+	    return;
+	}
+	if (i % FilesPerDir == FilesPerDir - 1 || i == numFiles - 1) {
+	    sprintf(path, "%s/d%d", DirTestName, i / FilesPerDir);
+	    if (!fileSystem->Remove(path)) {
+		printf("Dir test: unable to remove %s\n", path);
+		return;
+	    }
+	}
+    }
+    if (!fileSystem->Remove(DirTestName))
+	printf("Dir test: unable to remove %s\n", DirTestName);
+    DirTestReport("Removed", numFiles, &before);
+}
+
+// Create/remove test: each thread creates and then removes files of
+// its own, CreateRemoveRounds times over, in the root directory.
+
+#define CreateRemoveRounds	20
+
+static Semaphore *createRemoveDone;
+
+static void
+CreateRemoveThread(int which)
+{
+    char name[FileNameMaxLen + 1];
+
+    for (int i = 0; i < CreateRemoveRounds; i++) {
+	sprintf(name, "cr%d.%d", which, i);
+	if (!fileSystem->Create(name, 0) || !fileSystem->Remove(name)) {
+	    printf("Create/remove test: thread %d failed on %s\n", which, name);
+	    break;
+	}
+    }
+    createRemoveDone->V();
 }
 
+//----------------------------------------------------------------------
+// CreateRemoveTest
+// 	Fork "numThreads" threads that each create and remove files, wait
+//	for all of them, and report how many creates we got per million
+//	ticks, and how many disk writes they took.
+//----------------------------------------------------------------------
+
+void
+CreateRemoveTest(int numThreads)
+{
+    Statistics before = *stats;
+    int i, ticks, creates = numThreads * CreateRemoveRounds;
+
+    printf("Starting create/remove test, %d threads:\n", numThreads);
+    createRemoveDone = new Semaphore("create/remove done", 0);
+    for (i = 0; i < numThreads; i++) {
+	Thread *t = new Thread("create/remove");
+
+	t->Fork(CreateRemoveThread, i);
+    }
+    for (i = 0; i < numThreads; i++)
+	createRemoveDone->P();
+    delete createRemoveDone;
+
+    ticks = stats->totalTicks - before.totalTicks;
+    printf("%d creates and %d removes: %d ticks, %d disk reads, "
+	"%d disk writes\n", creates, creates, ticks,
+	stats->numDiskReads - before.numDiskReads,
+	stats->numDiskWrites - before.numDiskWrites);
+    if (ticks > 0)
+	printf("%d creates per million ticks\n", 
+				(int) (creates * 1000000.0 / ticks));
+}
+
+// Write test: fill "numFiles" small files a sector at a time, and then
+// overwrite sectors chosen at random among them.  All the files are in
+// the root directory, so there can't be more than about 60.
+
+#define WriteTestFileSize	(8 * SectorSize)
+#define WriteTestOverwrites	400
+
+static void
+WriteTestReport(char *what, int bytes, Statistics *before)
+{
+    int ticks = stats->totalTicks - before->totalTicks;
+
+    printf("%s: %d bytes, %d ticks, %d disk reads, %d disk writes, "
+	"%d seeks\n", what, bytes, ticks,
+	stats->numDiskReads - before->numDiskReads,
+	stats->numDiskWrites - before->numDiskWrites,
+	stats->numDiskSeeks - before->numDiskSeeks);
+    if (ticks > 0)
+	printf("%d bytes written per million ticks\n", 
+				(int) (bytes * 1000000.0 / ticks));
+    *before = *stats;
+}
+
+//----------------------------------------------------------------------
+// WriteTest
+// 	Create "numFiles" files and write them, then do random overwrites,
+//	printing the write throughput of each phase.  Run it on a disk
+//	formatted with -f, and again with -f -lfs, to compare the two
+//	layouts.
+//----------------------------------------------------------------------
+
+void
+WriteTest(int numFiles)
+{
+    char name[FileNameMaxLen + 1], data[SectorSize];
+    OpenFile **files = new OpenFile *[numFiles];
+    Statistics before = *stats;
+    int i, j, numSectors = WriteTestFileSize / SectorSize;
+
+    printf("Starting write test, %d files of %d bytes:\n", numFiles,
+							WriteTestFileSize);
+    for (i = 0; i < SectorSize; i++)
+	data[i] = 'a' + i % 26;
+    for (i = 0; i < numFiles; i++) {
+	sprintf(name, "wt%d", i);
+	if (!fileSystem->Create(name, WriteTestFileSize)
+		|| (files[i] = fileSystem->Open(name)) == NULL) {
+	    printf("Write test: couldn't create %s\n", name);
+	    break;
+	}
+	for (j = 0; j < numSectors; j++)
+	    files[i]->WriteAt(data, SectorSize, j * SectorSize);
+    }
+    if (i == numFiles) {
+	synchDisk->Sync();
+	WriteTestReport("Create and write", numFiles * WriteTestFileSize,
+								&before);
+	for (j = 0; j < WriteTestOverwrites; j++)
+	    files[Random() % numFiles]->WriteAt(data, SectorSize,
+				(Random() % numSectors) * SectorSize);
+	synchDisk->Sync();
+	WriteTestReport("Random overwrites", WriteTestOverwrites * SectorSize,
+								&before);
+    }
+
+    while (--i >= 0) {
+	delete files[i];
+	sprintf(name, "wt%d", i);
+	fileSystem->Remove(name);
+    }
+    delete [] files;
+}
+
+//----------------------------------------------------------------------
+// StripeTest
+// 	Read the whole disk, in order, "sectorsPerRead" sectors at a time,
+//	and print the read throughput.  Run it with -disks 1, 2, 4 ... to
+//	see how striping (cf. synchdisk.h) scales large sequential reads.
+//----------------------------------------------------------------------
+
+void
+StripeTest(int sectorsPerRead)
+{
+    int total = synchDisk->TotalSectors();
+    char *buffer = new char[sectorsPerRead * SectorSize];
+    Statistics before = *stats;
+    int first, count, ticks;
+
+    printf("Starting stripe test, %d disks, stripe unit %d sectors:\n",
+		synchDisk->NumDisks(), synchDisk->StripeUnit());
+    for (first = 0; first < total; first += count) {
+	count = (total - first < sectorsPerRead) ? total - first
+							: sectorsPerRead;
+	synchDisk->ReadSectors(first, count, buffer);
+    }
+    ticks = stats->totalTicks - before.totalTicks;
+    printf("Read %d sectors, %d at a time: %d ticks, %d disk reads\n",
+		total, sectorsPerRead, ticks,
+		stats->numDiskReads - before.numDiskReads);
+    if (ticks > 0)
+	printf("%d bytes read per million ticks\n",
+			(int) (total * SectorSize * 1000000.0 / ticks));
+    delete [] buffer;
+}
@@ -0,0 +1,509 @@
+// journal.cc
+//	Routines to log file system metadata updates ahead of writing
+//	them in place, so that each operation is atomic with respect to
+//	crashes.  See journal.h for the overall scheme.
+//
+//	An operation's writes are collected in the running transaction.
+//	When a thread finishes an operation and wants it durable, if no
+//	one else is already writing the log, it becomes the committer:
+//	it yields once so that other threads can add their operations to
+//	the same transaction, waits for the ones in progress to finish,
+//	and then appends the whole batch to the log.  Threads that finish
+//	while that write is going on form the next batch.
+//
+//	Committed images stay in memory (and in the log) until the log
+//	has no room for the next transaction; then all of them are
+//	written to their home locations in one sweep across the disk, and
+//	the log is emptied.  The one exception is a sector that is about
+//	to be overwritten with file data (because it was freed and then
+//	reused): its logged image must not be replayed over the new data,
+//	so we checkpoint right away.
+
+#include "copyright.h"
+#include "journal.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SectorMap::SectorMap
+// 	Initialize an empty set of sector images.
+//
+//	"size" -- the most sectors the set can hold
+//----------------------------------------------------------------------
+
+SectorMap::SectorMap(int size)
+{
+    maxCount = size;
+    count = 0;
+    sectors = new int[size];
+    images = new char[size * SectorSize];
+}
+
+//----------------------------------------------------------------------
+// SectorMap::~SectorMap
+// 	De-allocate the set.
+//----------------------------------------------------------------------
+
+SectorMap::~SectorMap()
+{
+    delete [] sectors;
+    delete [] images;
+}
+
+//----------------------------------------------------------------------
+// SectorMap::Find
+// 	Return the image of "sector", or NULL if it isn't in the set.
+//----------------------------------------------------------------------
+
+char *
+SectorMap::Find(int sector)
+{
+    for (int i = 0; i < count; i++)
+	if (sectors[i] == sector)
+	    return Image(i);
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SectorMap::Put
+// 	Return where to store a new image of "sector".  If the sector is
+//	already in the set, the new image replaces the old one.
+//----------------------------------------------------------------------
+
+char *
+SectorMap::Put(int sector)
+{
+    char *image = Find(sector);
+
+    if (image != NULL)
+	return image;
+    ASSERT(count < maxCount);
+    sectors[count] = sector;
+    return Image(count++);
+}
+
+//----------------------------------------------------------------------
+// SectorMap::Remove
+// 	Take "sector" out of the set, if it's there.  The last entry
+//	moves into its place.
+//----------------------------------------------------------------------
+
+void
+SectorMap::Remove(int sector)
+{
+    for (int i = 0; i < count; i++)
+	if (sectors[i] == sector) {
+	    count--;
+	    sectors[i] = sectors[count];
+	    bcopy(Image(count), Image(i), SectorSize);
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// SectorMap::Clear
+// 	Empty the set.
+//----------------------------------------------------------------------
+
+void
+SectorMap::Clear()
+{
+    count = 0;
+}
+
+//----------------------------------------------------------------------
+// Checksum
+// 	Return a checksum of a sector image, so recovery can tell a
+//	transaction that was completely written from one that wasn't.
+//----------------------------------------------------------------------
+
+static int
+Checksum(char *image)
+{
+    int *words = (int *) image;
+    int sum = 0;
+
+    for (unsigned int i = 0; i < SectorSize / sizeof(int); i++)
+	sum = (sum << 1 | ((unsigned int) sum >> 31)) + words[i];
+    return sum;
+}
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the in-memory state of the journal.  Call Format or
+//	Recover before using it.
+//----------------------------------------------------------------------
+
+Journal::Journal()
+{
+    ASSERT(sizeof(JournalRecord) <= SectorSize);
+    lock = new Lock("journal");
+    changed = new Condition("journal changed");
+    running = new SectorMap(JournalMaxSectors);
+    closing = new SectorMap(JournalMaxSectors);
+    committed = new SectorMap(JournalSectors);
+    runningTxn = 1;
+    committedTxn = 0;
+    activeOps = 0;
+    writer = NULL;
+    busy = draining = FALSE;
+    nextSeq = 1;
+    logEnd = 1;
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the journal.  Anything committed is still in the log,
+//	and will be written home when the disk is next mounted.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    delete running;
+    delete closing;
+    delete committed;
+    delete changed;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteSuperblock
+// 	Record on disk that the log starts with transaction nextSeq --
+//	i.e., that everything before it is safely home.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteSuperblock()
+{
+    JournalRecord super;
+
+    bzero((char *) &super, sizeof(super));
+    super.magic = JournalSuperMagic;
+    super.seq = nextSeq;
+    synchDisk->WriteSectorUnlogged(JournalStart, (char *) &super);
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Set up an empty log, on a disk that's being formatted.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    DEBUG('j', "Formatting journal, sectors %d-%d\n", JournalStart,
+				JournalStart + JournalSectors - 1);
+    nextSeq = 1;
+    logEnd = 1;
+    WriteSuperblock();
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Mount the log: read every complete transaction in it, in order,
+//	write their images home, and empty the log.  A transaction is
+//	complete if its descriptor and commit record both carry the
+//	sequence number we expect, and the checksum matches; we stop at
+//	the first one that isn't (that's where we crashed, or it's old
+//	data from before the last checkpoint).
+//----------------------------------------------------------------------
+
+void
+Journal::Recover()
+{
+    JournalRecord super, desc, commit;
+    SectorMap *txn = new SectorMap(JournalMaxSectors);
+    int offset = 1, replayed = 0, sum, i;
+
+    synchDisk->ReadSectorUnlogged(JournalStart, (char *) &super);
+    if (super.magic != JournalSuperMagic) {
+	printf("No journal on disk; starting an empty one (format with -f)\n");
+	Format();
+	delete txn;
+	return;
+    }
+    nextSeq = super.seq;
+    while (offset + 2 <= JournalSectors) {
+	synchDisk->ReadSectorUnlogged(JournalStart + offset, (char *) &desc);
+	if (desc.magic != JournalDescMagic || desc.seq != nextSeq
+		|| desc.count <= 0 || desc.count > (int) JournalMaxSectors
+		|| offset + desc.count + 2 > JournalSectors)
+	    break;
+	txn->Clear();
+	for (i = 0, sum = 0; i < desc.count; i++) {
+	    char *image = txn->Put(desc.sectors[i]);
+
+	    synchDisk->ReadSectorUnlogged(JournalStart + offset + 1 + i, image);
+	    sum += Checksum(image);
+	}
+	synchDisk->ReadSectorUnlogged(JournalStart + offset + 1 + desc.count,
+							(char *) &commit);
+	if (commit.magic != JournalCommitMagic || commit.seq != nextSeq
+		|| commit.count != desc.count || commit.checksum != sum)
+	    break;			// never committed
+	for (i = 0; i < txn->NumEntries(); i++)
+	    bcopy(txn->Image(i), committed->Put(txn->Sector(i)), SectorSize);
+	offset += desc.count + 2;
+	nextSeq++;
+	replayed++;
+    }
+    DEBUG('j', "Replaying %d transactions from the journal\n", replayed);
+    logEnd = offset;
+    Checkpoint();
+    delete txn;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start an operation on behalf of the current thread: its writes
+//	go into the running transaction from now until End.  The file
+//	system only lets one operation run at a time.
+//
+//	If the running transaction might not have room for everything
+//	this operation could write, wait for it to be committed first.
+//	An operation too big for even an empty transaction could never
+//	be logged, so we refuse to start it.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    ASSERT(JournalOpSectors <= JournalTxnSectors);
+    lock->Acquire();
+    while (draining
+	    || running->NumEntries() + JournalOpSectors > JournalTxnSectors)
+	changed->Wait(lock);
+    activeOps++;
+    writer = currentThread;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Finish the current thread's operation.  Return the id of the
+//	transaction it is part of, to pass to Commit.
+//----------------------------------------------------------------------
+
+int
+Journal::End()
+{
+    int txn;
+
+    lock->Acquire();
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    activeOps--;
+    txn = runningTxn;
+    changed->Broadcast(lock);
+    lock->Release();
+    return txn;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Wait until transaction "txn" is in the log.  If nobody is
+//	writing the log right now, we do it ourselves; otherwise we wait
+//	for them, since they may be writing our transaction anyway.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit(int txn)
+{
+    lock->Acquire();
+    while (committedTxn < txn) {
+	if (busy)
+	    changed->Wait(lock);
+	else
+	    CommitRunning();		// it must be ours
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::CommitRunning
+// 	Close the running transaction and append it to the log.  Called
+//	with the lock held, and when no one else is writing the log.
+//----------------------------------------------------------------------
+
+void
+Journal::CommitRunning()
+{
+    SectorMap *tmp;
+    int txn;
+
+    busy = TRUE;
+    lock->Release();
+    currentThread->Yield();		// let other threads join this batch
+    lock->Acquire();
+
+    draining = TRUE;			// no new operations; wait for the
+    while (activeOps > 0)		// ones in progress
+	changed->Wait(lock);
+    tmp = closing;
+    closing = running;
+    running = tmp;
+    txn = runningTxn++;
+    draining = FALSE;
+    changed->Broadcast(lock);
+    lock->Release();
+
+    WriteTransaction(closing);
+
+    lock->Acquire();
+    for (int i = 0; i < closing->NumEntries(); i++)
+	bcopy(closing->Image(i), committed->Put(closing->Sector(i)),
+								SectorSize);
+    closing->Clear();
+    committedTxn = txn;
+    busy = FALSE;
+    changed->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteTransaction
+// 	Append the sector images in "txn" to the log, as one transaction:
+//	a descriptor listing where they go, the images, and a commit
+//	record.  If the log is too full, checkpoint first.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteTransaction(SectorMap *txn)
+{
+    JournalRecord rec;
+    int n = txn->NumEntries(), sum = 0, i;
+
+    if (n == 0)
+	return;				// nothing changed
+    if (logEnd + n + 2 > JournalSectors)
+	Checkpoint();
+    ASSERT(logEnd + n + 2 <= JournalSectors);	// else we'd overrun the log
+
+    DEBUG('j', "Committing transaction %d, %d sectors, at log sector %d\n",
+					nextSeq, n, JournalStart + logEnd);
+    bzero((char *) &rec, sizeof(rec));
+    rec.magic = JournalDescMagic;
+    rec.seq = nextSeq;
+    rec.count = n;
+    for (i = 0; i < n; i++)
+	rec.sectors[i] = txn->Sector(i);
+    synchDisk->WriteSectorUnlogged(JournalStart + logEnd, (char *) &rec);
+    for (i = 0; i < n; i++) {
+	synchDisk->WriteSectorUnlogged(JournalStart + logEnd + 1 + i,
+							txn->Image(i));
+	sum += Checksum(txn->Image(i));
+    }
+    rec.magic = JournalCommitMagic;
+    rec.checksum = sum;
+    synchDisk->WriteSectorUnlogged(JournalStart + logEnd + 1 + n,
+							(char *) &rec);
+    synchDisk->Sync();			// in case the disk is log-structured
+    logEnd += n + 2;
+    nextSeq++;
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Write every committed image to its home location, in increasing
+//	sector order so the disk head sweeps across just once, and then
+//	mark the log empty.  Called when no one else is writing the log.
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint()
+{
+    int n = committed->NumEntries();
+    int *order = new int[n];
+    int i, j, k;
+
+    DEBUG('j', "Checkpointing %d sectors\n", n);
+    for (i = 0; i < n; i++) {		// insertion sort, by sector
+	k = i;
+	for (j = i; j > 0 && committed->Sector(order[j - 1]) >
+						committed->Sector(k); j--)
+	    order[j] = order[j - 1];
+	order[j] = k;
+    }
+    for (i = 0; i < n; i++)
+	synchDisk->WriteSectorUnlogged(committed->Sector(order[i]),
+					committed->Image(order[i]));
+    logEnd = 1;
+    WriteSuperblock();
+    delete [] order;
+
+    lock->Acquire();
+    committed->Clear();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Absorb
+// 	Called by SynchDisk for every write.  If the current thread is
+//	in the middle of an operation, keep the new contents in the
+//	running transaction instead of writing them, and return TRUE.
+//
+//	"sector" -- the sector being written
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+bool
+Journal::Absorb(int sector, char *data)
+{
+    bool absorbed = FALSE;
+
+    lock->Acquire();
+    if (writer != NULL && writer == currentThread) {
+	bcopy(data, running->Put(sector), SectorSize);
+	absorbed = TRUE;
+    }
+    lock->Release();
+    return absorbed;
+}
+
+//----------------------------------------------------------------------
+// Journal::Lookup
+// 	Called by SynchDisk for every read.  If the newest contents of
+//	"sector" are still in the journal, copy them to "data" and
+//	return TRUE.
+//----------------------------------------------------------------------
+
+bool
+Journal::Lookup(int sector, char *data)
+{
+    char *image;
+
+    lock->Acquire();
+    if ((image = running->Find(sector)) == NULL
+	    && (image = closing->Find(sector)) == NULL)
+	image = committed->Find(sector);
+    if (image != NULL)
+	bcopy(image, data, SectorSize);
+    lock->Release();
+    return (image != NULL);
+}
+
+//----------------------------------------------------------------------
+// Journal::Revoke
+// 	Called by SynchDisk before writing "sector" directly (it's file
+//	data, not part of an operation).  Any version we hold is now out
+//	of date.  If that version is in the log, it would be replayed
+//	over the new data after a crash, so checkpoint before returning.
+//----------------------------------------------------------------------
+
+void
+Journal::Revoke(int sector)
+{
+    lock->Acquire();
+    running->Remove(sector);
+    while (closing->Find(sector) != NULL || committed->Find(sector) != NULL) {
+	if (busy) {
+	    changed->Wait(lock);
+	    continue;
+	}
+	busy = TRUE;
+	lock->Release();
+	Checkpoint();
+	lock->Acquire();
+	busy = FALSE;
+	changed->Broadcast(lock);
+    }
+    lock->Release();
+}
@@ -0,0 +1,150 @@
+// journal.h
+//	Data structures for a write-ahead log of file system metadata.
+//
+//	Create and Remove each change several sectors (the free map, the
+//	directory, a file header); if Nachos stops between those writes,
+//	the disk is left inconsistent.  Instead, every sector a metadata
+//	operation writes is held in memory, and the whole set is first
+//	appended to a log on disk as one transaction, ending in a commit
+//	record.  Only after that is durable do the sectors go to their
+//	real ("home") locations, and only lazily, when the log fills up.
+//	If we crash, mounting the disk replays every committed transaction
+//	in the log, so each operation happens completely or not at all.
+//
+//	Operations from many threads are batched into the same
+//	transaction (group commit), so under load one log append covers
+//	many creates, and a sector changed by all of them (e.g., the free
+//	map) is logged once rather than once per operation.
+//
+//	The log occupies a fixed region of the disk: a superblock giving
+//	the sequence number of the first transaction still in the log,
+//	followed by transactions, each laid out as
+//		descriptor | sector images ... | commit record
+//
+//	The disk must be formatted (-f) for the log region to be set up.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+
+#define JournalStart		sectorsPerTrack	// log is on tracks 1 and 2,
+#define JournalSectors		(2 * sectorsPerTrack)	// next to the
+						// free map and root directory
+#define JournalOpSectors	32	// most sectors a single operation
+					// can change (mkdir: header, free
+					// map, directory table, parent;
+					// cf. FileSystemFits)
+
+#define JournalSuperMagic	0x4a524e4c
+#define JournalDescMagic	0x4a444553
+#define JournalCommitMagic	0x4a434d54
+
+// Max # of sectors in one transaction -- as many as fit in a descriptor
+#define JournalMaxSectors ((SectorSize - 4 * sizeof(int)) / sizeof(short))
+// ... and in the log, after the superblock, with a descriptor and commit
+#define JournalTxnSectors min((int) JournalMaxSectors, JournalSectors - 3)
+
+// The following class defines the on-disk format of the log's
+// superblock, and of each transaction's descriptor and commit record.
+// Each one takes a whole sector.
+
+class JournalRecord {
+  public:
+    int magic;				// Which kind of record it is
+    int seq;				// Superblock: first transaction in
+					//   the log.  Others: this transaction
+    int count;				// # of sector images in transaction
+    int checksum;			// (commit) sum of the images
+    short sectors[JournalMaxSectors];	// (descriptor) home of each image
+};
+
+// The following class defines a set of sector images, indexed by
+// sector number: the contents we want each sector to have.
+
+class SectorMap {
+  public:
+    SectorMap(int size);		// Initialize an empty set, with
+					// room for "size" sectors
+    ~SectorMap();			// De-allocate the set
+
+    char *Find(int sector);		// Return the image of "sector", or
+					// NULL if it's not in the set
+    char *Put(int sector);		// Return a place to store the image
+					// of "sector", adding it if need be
+    void Remove(int sector);		// Take "sector" out of the set
+    void Clear();			// Empty the set
+
+    int NumEntries() { return count; }
+    int Sector(int i) { return sectors[i]; }	// the ith sector, and
+    char *Image(int i) { return images + i * SectorSize; } // its image
+
+  private:
+    int maxCount;			// Room for this many sectors
+    int count;				// Number of sectors in the set
+    int *sectors;			// Their numbers
+    char *images;			// And their images
+};
+
+// The following class defines the journal.  The file system brackets
+// each operation that changes metadata with Begin/End, and then calls
+// Commit to wait until the operation is durable.  In between, SynchDisk
+// hands the journal every sector that operation writes (Absorb), and
+// asks it first on every read (Lookup), since the latest version of a
+// sector may not be at its home location yet.
+
+class Journal {
+  public:
+    Journal();				// Initialize the journal
+    ~Journal();				// De-allocate the journal
+
+    void Format();			// Set up an empty log on a new disk
+    void Recover();			// Replay committed transactions,
+					// after a crash or clean shutdown
+
+    void Begin();			// Start an operation, in the
+					// currently running transaction
+    int End();				// Finish the operation; return the
+					// transaction it's part of
+    void Commit(int txn);		// Wait until transaction "txn" is
+					// safely in the log
+
+    bool Absorb(int sector, char *data);// If the current thread is in an
+					// operation, take this write into
+					// the transaction and return TRUE
+    bool Lookup(int sector, char *data);// If we have a newer version of
+					// "sector" than the disk, copy it
+					// to "data" and return TRUE
+    void Revoke(int sector);		// "sector" is about to be written
+					// directly; forget our version
+
+  private:
+    Lock *lock;				// Protects everything below
+    Condition *changed;			// Signalled when any of it changes
+
+    SectorMap *running;			// Transaction operations are joining
+    SectorMap *closing;			// Transaction being written to log
+    SectorMap *committed;		// Images in the log, but not yet at
+					// their home locations
+    int runningTxn;			// Ids of the running transaction and
+    int committedTxn;			// the last one committed
+    int activeOps;			// # of operations in running txn
+    Thread *writer;			// Thread doing the current operation
+    bool busy;				// Is someone writing the log?
+    bool draining;			// Is the running txn about to close?
+
+    int nextSeq;			// Sequence # of the next log record
+    int logEnd;				// Where in the log it goes
+
+    void CommitRunning();		// Close the running txn, and write
+					// it to the log
+    void WriteTransaction(SectorMap *txn);	// Append "txn" to the log
+    void Checkpoint();			// Write the committed images home,
+					// and empty the log
+    void WriteSuperblock();		// Record where the log starts
+};
+
+#endif // JOURNAL_H
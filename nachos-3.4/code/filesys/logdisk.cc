@@ -0,0 +1,503 @@
+// logdisk.cc
+//	Routines to lay the disk out as a log.  See logdisk.h for the
+//	overall scheme.
+//
+//	A segment can't be written over as soon as nothing in it is
+//	live: after a crash, recovery rolls forward through every
+//	segment written since the last checkpoint, so a segment that
+//	recovery might still look at has to stay as it is until the next
+//	checkpoint.  Free segments are reused in order around the disk.
+//
+//	The cleaner picks the segments with the fewest live sectors
+//	(greedy), and holds the lock while it works, so writers wait for
+//	it rather than seeing a half-moved sector.  Since no more than
+//	LogicalSectors can ever be live, some segment always has dead
+//	space in it when free ones run short.
+
+#include "copyright.h"
+#include "logdisk.h"
+#include "system.h"
+
+// Where each copy of the checkpoint goes: a header, followed by the map
+#define CheckpointSector(i)	((i) * (sectorsPerTrack / 2))
+
+//----------------------------------------------------------------------
+// SlotSector, SectorSlot
+// 	Convert between a slot in a segment and the physical sector that
+//	holds it.  Slots alternate sectors, so that the disk has a sector
+//	time to take the next write before that slot comes around: slots
+//	0, 1, 2, ... are at sectors 0, 2, 4, ... of the track, and then
+//	1, 3, 5, ...  The summary, the last slot, ends up last on the track.
+//----------------------------------------------------------------------
+
+static int
+SlotSector(int segment, int slot)
+{
+    int half = SegmentSize / 2;
+
+    if (slot < half)
+	return segment * SegmentSize + 2 * slot;
+    return segment * SegmentSize + 2 * (slot - half) + 1;
+}
+
+static int
+SectorSlot(int sector)
+{
+    int offset = sector % SegmentSize;
+
+    if (offset % 2 == 0)
+	return offset / 2;
+    return offset / 2 + SegmentSize / 2;
+}
+
+//----------------------------------------------------------------------
+// LogCleaner
+// 	The cleaner thread.  Need this to be a C routine, because
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+LogCleaner(int arg)
+{
+    LogDisk *log = (LogDisk *) arg;
+
+    log->Clean();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::LogDisk
+// 	Initialize the in-memory state of the log.
+//----------------------------------------------------------------------
+
+LogDisk::LogDisk()
+{
+    ASSERT(sizeof(SegmentSummary) <= SectorSize);
+    lock = new Lock("log disk");
+    needClean = new Condition("log needs cleaning");
+    segmentFreed = new Condition("log segment freed");
+    map = new short[MapEntries];
+    for (int i = 0; i < (int) MapEntries; i++)
+	map[i] = -1;			// in case a checkpoint is short
+    live = new int[NumSegments];
+    segSeq = new int[NumSegments];
+    buffer = new char[SegmentSize * SectorSize];
+    summary = new SegmentSummary;
+    checkpointSeq = checkpointCount = 0;
+    current = -1;
+    used = flushed = 0;
+    nextSeq = 1;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::~LogDisk
+// 	De-allocate the log.
+//----------------------------------------------------------------------
+
+LogDisk::~LogDisk()
+{
+    delete summary;
+    delete [] buffer;
+    delete [] segSeq;
+    delete [] live;
+    delete [] map;
+    delete segmentFreed;
+    delete needClean;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// GeometryFits
+// 	Return TRUE if the disk's geometry (cf. -geometry) leaves room to
+//	list a whole segment in its summary sector, and to fit each copy
+//	of the checkpoint in half of track 0.
+//----------------------------------------------------------------------
+
+static bool
+GeometryFits()
+{
+    return (SegmentSlots <= (int) MaxSegmentSlots)
+		&& ((int) CheckpointMapSectors + 1 <= sectorsPerTrack / 2);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Format
+// 	Set up an empty log: nothing is mapped, and every segment is free.
+//	Old summaries are wiped, so recovery won't mistake them for new.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Format()
+{
+    char zero[SectorSize];
+    int i;
+
+    DEBUG('l', "Formatting log-structured disk\n");
+    ASSERT(GeometryFits());
+    bzero(zero, SectorSize);
+    lock->Acquire();
+    for (i = 0; i < LogicalSectors; i++)
+	map[i] = -1;
+    for (i = 0; i < NumSegments; i++) {
+	live[i] = 0;
+	segSeq[i] = -1;
+	if (i > 0)
+	    synchDisk->WritePhysical(SlotSector(i, SegmentSlots), zero);
+    }
+    WriteCheckpoint();
+    synchDisk->WritePhysical(CheckpointSector(1), zero);
+    NextSegment(FALSE);
+    lock->Release();
+
+    (new Thread("log cleaner"))->Fork(LogCleaner, (int) this);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Recover
+// 	Rebuild the map: start from the newer of the two checkpoints, and
+//	then apply the summary of each segment written since, oldest
+//	first.  Return FALSE if there's no checkpoint on the disk (or if
+//	a disk of this geometry couldn't have one).
+//----------------------------------------------------------------------
+
+bool
+LogDisk::Recover()
+{
+    char buf[SectorSize];
+    LogCheckpoint *cp = (LogCheckpoint *) buf;
+    SegmentSummary *sums;
+    int i, s, next, best = -1;
+
+    if (!GeometryFits())
+	return FALSE;
+    sums = new SegmentSummary[NumSegments];
+
+    for (i = 0; i < 2; i++) {
+	synchDisk->ReadPhysical(CheckpointSector(i), buf);
+	if (cp->magic == LogCheckpointMagic && cp->count > checkpointCount) {
+	    best = i;
+	    checkpointCount = cp->count;
+	    checkpointSeq = cp->seq;
+	}
+    }
+    if (best == -1) {
+	delete [] sums;
+	return FALSE;
+    }
+    DEBUG('l', "Recovering log from checkpoint %d\n", checkpointCount);
+
+    lock->Acquire();
+    for (i = 0; i < (int) CheckpointMapSectors; i++)
+	synchDisk->ReadPhysical(CheckpointSector(best) + 1 + i,
+					(char *) map + i * SectorSize);
+    nextSeq = checkpointSeq;
+    for (s = 1; s < NumSegments; s++) {
+	synchDisk->ReadPhysical(SlotSector(s, SegmentSlots), buf);
+	bcopy(buf, (char *) &sums[s], sizeof(SegmentSummary));
+	segSeq[s] = (sums[s].magic == LogSummaryMagic) ? sums[s].seq : -1;
+	if (segSeq[s] >= nextSeq)
+	    nextSeq = segSeq[s] + 1;
+    }
+
+    // roll forward, in the order the segments were written
+    for (i = checkpointSeq; ; i = segSeq[next] + 1) {
+	next = -1;
+	for (s = 1; s < NumSegments; s++)
+	    if (segSeq[s] >= i && (next == -1 || segSeq[s] < segSeq[next]))
+		next = s;
+	if (next == -1)
+	    break;
+	DEBUG('l', "Rolling forward segment %d, %d slots\n", next,
+							sums[next].count);
+	for (s = 0; s < sums[next].count; s++)
+	    map[sums[next].sectors[s]] = SlotSector(next, s);
+    }
+    delete [] sums;
+
+    for (s = 0; s < NumSegments; s++)
+	live[s] = 0;
+    for (i = 0; i < LogicalSectors; i++) {
+	if (map[i] < SegmentSize || map[i] >= NumSegments * SegmentSize)
+	    map[i] = -1;		// never written, or garbage
+	if (map[i] != -1)
+	    live[map[i] / SegmentSize]++;
+    }
+    WriteCheckpoint();			// so every free segment is reusable
+    NextSegment(FALSE);
+    lock->Release();
+
+    (new Thread("log cleaner"))->Fork(LogCleaner, (int) this);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::ReadSector
+// 	Read the latest version of logical sector "sector" -- from the
+//	segment being filled, if it's there.  A sector that was never
+//	written reads as zeroes.
+//----------------------------------------------------------------------
+
+void
+LogDisk::ReadSector(int sector, char *data)
+{
+    int where;
+
+    ASSERT(sector >= 0 && sector < LogicalSectors);
+    lock->Acquire();
+    where = map[sector];
+    if (where == -1)
+	bzero(data, SectorSize);
+    else if (where / SegmentSize == current)
+	bcopy(buffer + SectorSlot(where) * SectorSize, data, SectorSize);
+    else
+	synchDisk->ReadPhysical(where, data);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::WriteSector
+// 	Append a new version of logical sector "sector" to the log.
+//----------------------------------------------------------------------
+
+void
+LogDisk::WriteSector(int sector, char *data)
+{
+    ASSERT(sector >= 0 && sector < LogicalSectors);
+    lock->Acquire();
+    Append(sector, data, FALSE);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Sync
+// 	Make sure everything written so far is on disk.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Sync()
+{
+    lock->Acquire();
+    Flush();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Flush
+// 	Write the slots of the current segment that aren't on disk yet,
+//	followed by the summary.  Since the summary goes last, a crash in
+//	the middle loses those slots, but nothing else.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Flush()
+{
+    char buf[SectorSize];
+
+    if (flushed == used)
+	return;
+    DEBUG('l', "Writing slots %d to %d of segment %d\n", flushed, used - 1,
+								current);
+    for (; flushed < used; flushed++)
+	synchDisk->WritePhysical(SlotSector(current, flushed),
+					buffer + flushed * SectorSize);
+    summary->count = used;
+    bzero(buf, SectorSize);
+    bcopy((char *) summary, buf, sizeof(SegmentSummary));
+    synchDisk->WritePhysical(SlotSector(current, SegmentSlots), buf);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Append
+// 	Add a write of "sector" to the current segment.  If the sector
+//	is already there and hasn't gone to disk yet, just replace it.
+//	Called with the lock held.
+//
+//	"cleaning" -- is this the cleaner, moving a live sector?
+//----------------------------------------------------------------------
+
+void
+LogDisk::Append(int sector, char *data, bool cleaning)
+{
+    int old;
+
+    for (;;) {
+	old = map[sector];
+	if (old != -1 && old / SegmentSize == current
+					&& SectorSlot(old) >= flushed) {
+	    bcopy(data, buffer + SectorSlot(old) * SectorSize, SectorSize);
+	    return;
+	}
+	if (used < SegmentSlots)
+	    break;
+	NextSegment(cleaning);		// may wait for the cleaner
+    }
+    if (old != -1)
+	live[old / SegmentSize]--;
+    bcopy(data, buffer + used * SectorSize, SectorSize);
+    summary->sectors[used] = sector;
+    map[sector] = SlotSector(current, used);
+    live[current]++;
+    used++;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::StartSegment
+// 	Start filling "segment".
+//----------------------------------------------------------------------
+
+void
+LogDisk::StartSegment(int segment)
+{
+    DEBUG('l', "Starting segment %d, seq %d\n", segment, nextSeq);
+    current = segment;
+    used = flushed = 0;
+    segSeq[segment] = nextSeq++;
+    bzero((char *) summary, sizeof(SegmentSummary));
+    summary->magic = LogSummaryMagic;
+    summary->seq = segSeq[segment];
+}
+
+//----------------------------------------------------------------------
+// LogDisk::NextSegment
+// 	Finish writing the current segment, and move on to the next free
+//	one that can be reused.  Writers leave the last CleanReserve free
+//	segments to the cleaner, so it can always make progress; if that's
+//	all there is, they wait for it.
+//
+//	"cleaning" -- is this the cleaner?
+//----------------------------------------------------------------------
+
+void
+LogDisk::NextSegment(bool cleaning)
+{
+    int i, s, first, reusable;
+
+    Flush();
+    for (;;) {
+	first = -1;
+	reusable = 0;
+	for (i = 0; i < NumSegments - 1; i++) {
+	    s = 1 + ((current == -1 ? 0 : current) + i) % (NumSegments - 1);
+	    if (s != current && live[s] == 0 && segSeq[s] < checkpointSeq) {
+		reusable++;
+		if (first == -1)
+		    first = s;
+	    }
+	}
+	if (reusable > (cleaning ? 0 : CleanReserve)) {
+	    StartSegment(first);
+	    if (NumFree() < CleanLow)
+		needClean->Signal(lock);
+	    return;
+	}
+	if (NumFree() > reusable)
+	    WriteCheckpoint();		// makes the dead segments reusable
+	else {
+	    ASSERT(!cleaning);		// the log is full!
+	    needClean->Signal(lock);
+	    segmentFreed->Wait(lock);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// LogDisk::WriteCheckpoint
+// 	Save the map, and note that it covers everything in segments
+//	before the current one.  The two copies are used in turn; the
+//	header goes last, so that a checkpoint that is only half written
+//	is ignored.
+//----------------------------------------------------------------------
+
+void
+LogDisk::WriteCheckpoint()
+{
+    char buf[SectorSize];
+    LogCheckpoint *cp = (LogCheckpoint *) buf;
+    int where = CheckpointSector(checkpointCount % 2);
+
+    Flush();
+    checkpointCount++;
+    checkpointSeq = (current == -1) ? nextSeq : segSeq[current];
+    DEBUG('l', "Writing checkpoint %d, seq %d\n", checkpointCount,
+							checkpointSeq);
+    for (int i = 0; i < (int) CheckpointMapSectors; i++)
+	synchDisk->WritePhysical(where + 1 + i, (char *) map + i * SectorSize);
+    bzero(buf, SectorSize);
+    cp->magic = LogCheckpointMagic;
+    cp->count = checkpointCount;
+    cp->seq = checkpointSeq;
+    synchDisk->WritePhysical(where, buf);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::NumFree
+// 	Return the number of segments (other than the current one) with
+//	nothing live in them.
+//----------------------------------------------------------------------
+
+int
+LogDisk::NumFree()
+{
+    int count = 0;
+
+    for (int s = 1; s < NumSegments; s++)
+	if (s != current && live[s] == 0)
+	    count++;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Clean
+// 	The cleaner thread.  Whenever free segments run low, clean the
+//	emptiest segments until there are CleanHigh free, then checkpoint
+//	so the segments can be reused, and let any waiting writers go.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Clean()
+{
+    int s, victim;
+
+    lock->Acquire();
+    for (;;) {
+	while (NumFree() >= CleanLow)
+	    needClean->Wait(lock);
+	DEBUG('l', "Cleaner starting, %d free segments\n", NumFree());
+	while (NumFree() < CleanHigh) {
+	    victim = -1;
+	    for (s = 1; s < NumSegments; s++)
+		if (s != current && live[s] > 0 && live[s] < SegmentSlots
+			&& (victim == -1 || live[s] < live[victim]))
+		    victim = s;
+	    if (victim == -1)
+		break;			// nothing dead anywhere
+	    CleanSegment(victim);
+	}
+	WriteCheckpoint();
+	segmentFreed->Broadcast(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+// LogDisk::CleanSegment
+// 	Copy each live sector in "segment" to the end of the log.  A slot
+//	is live if the map still points to it.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+LogDisk::CleanSegment(int segment)
+{
+    char buf[SectorSize], data[SectorSize];
+    SegmentSummary *sum = (SegmentSummary *) buf;
+    int slot, sector;
+
+    DEBUG('l', "Cleaning segment %d, %d live\n", segment, live[segment]);
+    synchDisk->ReadPhysical(SlotSector(segment, SegmentSlots), buf);
+    for (slot = 0; slot < sum->count && live[segment] > 0; slot++) {
+	sector = sum->sectors[slot];
+	if (map[sector] != SlotSector(segment, slot))
+	    continue;			// overwritten since
+	synchDisk->ReadPhysical(SlotSector(segment, slot), data);
+	Append(sector, data, TRUE);
+    }
+    ASSERT(live[segment] == 0);
+}
@@ -0,0 +1,143 @@
+// logdisk.h
+//	Data structures for a log-structured layout of the disk.
+//
+//	Normally each sector the file system writes goes to a fixed place
+//	on disk, so a workload of small writes scattered over many files
+//	pays a seek and most of a rotation for every sector.  On a
+//	log-structured disk, the file system's sector numbers are only
+//	"logical": every write, of file data or file headers alike, is
+//	appended to the end of a log, and an in-memory map records where
+//	the latest copy of each logical sector is.  Since the map covers
+//	every file header sector, it plays the role of the inode map in
+//	Sprite LFS; since it covers everything else too, the file system
+//	above doesn't need to know which layout it is running on.
+//
+//	The log is written a segment (one track) at a time: writes are
+//	gathered in memory until the segment fills, or until someone asks
+//	for them to be made durable (Sync), and then written out in one
+//	pass.  Each segment ends with a summary, listing which logical
+//	sector is in each slot.  Consecutive slots are two sectors apart
+//	on the track, so that the disk doesn't have to wait a whole
+//	revolution between one write and the next.
+//
+//	Overwriting a sector leaves a dead copy behind in an older
+//	segment.  A cleaner thread reclaims space: when few segments are
+//	free, it copies the live sectors out of the emptiest segments to
+//	the end of the log, which frees the segments they were in.
+//
+//	The map is saved in a checkpoint region on track 0, alternating
+//	between two copies so that one is always complete.  Mounting the
+//	disk reads the newer checkpoint, and then rolls forward through
+//	the segments written since, using their summaries.
+//
+//	A disk is made log-structured when it is formatted (-f -lfs).
+
+#include "copyright.h"
+
+#ifndef LOGDISK_H
+#define LOGDISK_H
+
+#include "disk.h"
+#include "synch.h"
+
+#define SegmentSize		sectorsPerTrack	// a segment is one track
+#define SegmentSlots		(SegmentSize - 1)	// room for data; the
+							// last slot is the summary
+#define MaxSegmentSlots	((SectorSize - 4 * sizeof(int)) / sizeof(short))
+					// most slots a summary has room for
+#define NumSegments		numTracks	// segment 0 holds the checkpoints
+#define LogicalSectors		(NumSegments * 3 / 4 * SegmentSize)
+					// how big the disk looks to the
+					// file system -- the rest is slack
+					// for the cleaner
+#define CheckpointMapSectors	divRoundUp(LogicalSectors * sizeof(short), \
+								SectorSize)
+#define MapEntries		(CheckpointMapSectors * SectorSize / sizeof(short))
+					// the map, padded to whole sectors
+
+#define CleanLow		3	// wake the cleaner below this many
+#define CleanHigh		6	// free segments; it stops at this many
+#define CleanReserve		1	// free segments only the cleaner can use
+
+#define LogCheckpointMagic	0x4c434b50
+#define LogSummaryMagic		0x4c53554d
+
+// The following class defines the header of a checkpoint, written
+// after the map itself.
+
+class LogCheckpoint {
+  public:
+    int magic;				// Is this a checkpoint at all?
+    int count;				// Checkpoints written so far; the
+					// larger of the two copies wins
+    int seq;				// Segments with this sequence # or
+					// later were written after the map
+    int pad;
+};
+
+// The following class defines the summary at the end of each segment.
+
+class SegmentSummary {
+  public:
+    int magic;				// Is the summary valid?
+    int seq;				// When the segment was written
+    int count;				// # of slots in use
+    int pad;
+    short sectors[MaxSegmentSlots];	// Logical sector in each slot
+};
+
+// The following class defines the log-structured disk.  SynchDisk
+// sends every read and write through it when the disk is formatted
+// that way; the log itself uses SynchDisk's "Physical" routines to
+// get at the real sectors.
+
+class LogDisk {
+  public:
+    LogDisk();				// Initialize the log; call Format
+					// or Recover next
+    ~LogDisk();				// De-allocate the log
+
+    void Format();			// Set up an empty log on the disk
+    bool Recover();			// Read the map back in; return FALSE
+					// if the disk isn't log-structured
+
+    void ReadSector(int sector, char *data);	// Read/write a logical
+    void WriteSector(int sector, char *data);	// sector
+    void Sync();			// Write out the partial segment
+
+    void Clean();			// Body of the cleaner thread
+
+  private:
+    Lock *lock;				// Protects everything below
+    Condition *needClean;		// Wakes up the cleaner
+    Condition *segmentFreed;		// Wakes writers waiting for space
+
+    short *map;				// Where each logical sector is,
+					// or -1 if never written (or padding)
+    int *live;				// # of live sectors in each segment
+    int *segSeq;			// Sequence # each segment was last
+					// written with; -1 if never
+    int checkpointSeq;			// segSeq of segments written since
+					// the last checkpoint is >= this
+    int checkpointCount;		// # of checkpoints written
+
+    int current;			// Segment being filled
+    int used;				// # of its slots filled
+    int flushed;			// # of those already on disk
+    int nextSeq;			// Sequence # for the next segment
+    char *buffer;			// Contents of the current segment
+    SegmentSummary *summary;		// And its summary
+
+    void Flush();			// Sync, with the lock held
+    void Append(int sector, char *data, bool cleaning);
+					// Add a write to the current segment
+    void StartSegment(int segment);	// Start filling "segment"
+    void NextSegment(bool cleaning);	// Finish the current segment, and
+					// start filling a free one
+    void WriteCheckpoint();		// Save the map
+    void CleanSegment(int segment);	// Move the live sectors out of
+					// "segment"
+    int NumFree();			// # of segments with nothing live
+};
+
+#endif // LOGDISK_H
@@ -5,7 +5,10 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  The header comes from the header
+//	cache, so all the OpenFiles on one file share a single copy, and
+//	a recently closed file can be re-opened without reading its 
+//	header from disk again.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -22,26 +25,28 @@
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory (if it isn't already) while the file is open.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr = headerCache->Acquire(sector);
     seekPosition = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	If the disk is log-structured, what we wrote may still be in 
+//	memory; closing the file is when it has to reach the disk.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    headerCache->Release(hdr);
+    synchDisk->Sync();
 }
 
 //----------------------------------------------------------------------
@@ -99,7 +104,9 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   request, but we only copy the part we are interested in.  Sectors
+//	   that are together on disk are read together, so that striped
+//	   disks can all work on them at once (cf. SynchDisk::ReadSectors).
 //	For WriteAt:
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
@@ -117,7 +124,7 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, numSectors, sector, run;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
@@ -131,11 +138,20 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
+    // read in all the full and partial sectors that we need, a run of
+    // sectors that are together on disk at a time
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
+    for (i = firstSector; i <= lastSector; i += run) {
+	sector = hdr->ByteToSector(i * SectorSize);
+	for (run = 1; i + run <= lastSector; run++)
+	    if (hdr->ByteToSector((i + run) * SectorSize) != sector + run)
+		break;
+	if (run == 1)
+	    synchDisk->ReadSector(sector, &buf[(i - firstSector) * SectorSize]);
+	else
+	    synchDisk->ReadSectors(sector, run,
 					&buf[(i - firstSector) * SectorSize]);
+    }
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
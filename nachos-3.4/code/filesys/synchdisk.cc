@@ -8,7 +8,8 @@
 //	Use a semaphore to synchronize the interrupt handlers with the
 //	pending requests.  And, because the physical disk can only
 //	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	exclusion.  With several disks striped together, each has its
+//	own lock and semaphore.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +17,8 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "journal.h"
+#include "logdisk.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -26,25 +29,46 @@
 static void
 DiskRequestDone (int arg)
 {
-    SynchDisk* disk = (SynchDisk *)arg;
+    Spindle* spindle = (Spindle *)arg;
 
-    disk->RequestDone();
+    spindle->RequestDone();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
-// 	Initialize the synchronous interface to the physical disk, in turn
-//	initializing the physical disk.
+// 	Initialize the synchronous interface to the physical disks, in
+//	turn initializing the physical disks.
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
-//	   (usually, "DISK")
+//	   (usually, "DISK"); the second disk is in "name.1", and so on
+//	"n" -- how many disks to stripe the sectors across
+//	"unit" -- how many sectors in a row go on each disk
+//	"sync" -- when to wait for writes to reach the UNIX files
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, int n, int unit, DiskSync sync)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (int) this);
+    char *diskName = new char[strlen(name) + 8];
+
+    ASSERT((n > 0) && (n <= MaxDisks) && (unit > 0));
+    numDisks = n;
+    stripeUnit = unit;
+    for (int i = 0; i < numDisks; i++) {
+	if (i == 0)
+	    strcpy(diskName, name);
+	else
+	    sprintf(diskName, "%s.%d", name, i);
+	spindles[i].disk = new Disk(diskName, DiskRequestDone,
+						(int) &spindles[i], sync);
+	spindles[i].lock = new Lock("synch disk lock");
+	spindles[i].semaphore = new Semaphore("synch disk", 0);
+	spindles[i].done = FALSE;
+    }
+    delete [] diskName;
+    batchDone = new Semaphore("synch disk batch", 0);
+    batchLock = new Lock("synch disk batch lock");
+    journal = NULL;
+    log = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -55,15 +79,62 @@ SynchDisk::SynchDisk(char* name)
 
 SynchDisk::~SynchDisk()
 {
-    delete disk;
-    delete lock;
-    delete semaphore;
+    delete log;
+    for (int i = 0; i < numDisks; i++) {
+	delete spindles[i].disk;
+	delete spindles[i].lock;
+	delete spindles[i].semaphore;
+    }
+    delete batchLock;
+    delete batchDone;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Mount
+// 	Set up the disk's layout.  When formatting, lay it out as a log 
+//	if "logStructured", or else wipe out any checkpoint left by an 
+//	earlier log-structured format.  Otherwise, the disk is
+//	log-structured if the log finds a checkpoint on it.
+//
+//	Called before the file system is initialized.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Mount(bool format, bool logStructured)
+{
+    char zero[SectorSize];
+
+    log = new LogDisk;
+    if (format && logStructured)
+	log->Format();
+    else if (format || !log->Recover()) {
+	delete log;
+	log = NULL;
+	if (format) {
+	    bzero(zero, SectorSize);
+	    WritePhysical(0, zero);
+	    WritePhysical(sectorsPerTrack / 2, zero);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Capacity
+// 	Return how many sectors the file system can use: all of them, 
+//	unless the log needs some room to work in.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::Capacity()
+{
+    return (log != NULL) ? LogicalSectors : TotalSectors();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
 // 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+//	after the data has been read.  If the journal has a newer copy of
+//	the sector than the disk does, that's what we return.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -72,16 +143,54 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    if (journal != NULL && journal->Lookup(sectorNumber, data))
+	return;
+    ReadSectorUnlogged(sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read "count" consecutive sectors into a buffer, the way ReadSector
+//	would read each one, but with requests out to every disk the run
+//	is striped over at once.  Return only after all have been read.
+//
+//	Sectors the journal has a newer copy of come from the journal,
+//	checked first, as in ReadSector.  On a log-structured disk, the
+//	sectors aren't together on disk anyway, so read them one by one.
+//
+//	"first" -- the first sector to read
+//	"count" -- how many to read
+//	"data" -- the buffer to hold them, "count" sectors long
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int first, int count, char* data)
+{
+    bool *skip = NULL;
+    int i;
+
+    if (log != NULL) {
+	for (i = 0; i < count; i++)
+	    ReadSector(first + i, &data[i * SectorSize]);
+	return;
+    }
+    if (journal != NULL) {
+	skip = new bool[count];
+	for (i = 0; i < count; i++)
+	    skip[i] = journal->Lookup(first + i, &data[i * SectorSize]);
+    }
+    ReadPhysicalRun(first, count, data, skip);
+    delete [] skip;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
 // 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+//	after the data has been written.  
+//
+//	If the writing thread is in the middle of a file system 
+//	operation, the journal takes the write instead; it will reach
+//	the disk when the operation commits.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -90,20 +199,200 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    if (journal != NULL) {
+	if (journal->Absorb(sectorNumber, data))
+	    return;
+	journal->Revoke(sectorNumber);
+    }
+    WriteSectorUnlogged(sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectorUnlogged
+// 	Read a disk sector straight from the disk (or from wherever the
+//	log last put it).
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectorUnlogged(int sectorNumber, char* data)
+{
+    if (log != NULL)
+	log->ReadSector(sectorNumber, data);
+    else
+	ReadPhysical(sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectorUnlogged
+// 	Write a disk sector straight to the disk (or to the end of the
+//	log).
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectorUnlogged(int sectorNumber, char* data)
+{
+    if (log != NULL)
+	log->WriteSector(sectorNumber, data);
+    else
+	WritePhysical(sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Locate
+// 	Return the disk that sector "sectorNumber" is striped onto, and
+//	set "diskSector" to where on that disk it is.
+//----------------------------------------------------------------------
+
+Spindle *
+SynchDisk::Locate(int sectorNumber, int *diskSector)
+{
+    int stripe = sectorNumber / stripeUnit;
+
+    ASSERT((sectorNumber >= 0) && (sectorNumber < TotalSectors()));
+    *diskSector = (stripe / numDisks) * stripeUnit
+				+ sectorNumber % stripeUnit;
+    return &spindles[stripe % numDisks];
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadPhysical
+// 	Read a physical disk sector.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadPhysical(int sectorNumber, char* data)
+{
+    int diskSector;
+    Spindle *spindle = Locate(sectorNumber, &diskSector);
+
+    spindle->lock->Acquire();		// only one disk I/O at a time
+    spindle->notify = spindle->semaphore;
+    spindle->disk->ReadRequest(diskSector, data);
+    spindle->semaphore->P();		// wait for interrupt
+    spindle->done = FALSE;
+    spindle->lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WritePhysical
+// 	Write a physical disk sector.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WritePhysical(int sectorNumber, char* data)
+{
+    int diskSector;
+    Spindle *spindle = Locate(sectorNumber, &diskSector);
+
+    spindle->lock->Acquire();		// only one disk I/O at a time
+    spindle->notify = spindle->semaphore;
+    spindle->disk->WriteRequest(diskSector, data);
+    spindle->semaphore->P();		// wait for interrupt
+    spindle->done = FALSE;
+    spindle->lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadPhysicalRun
+// 	Read physical sectors "first" through "first + count - 1", except
+//	for those "skip" says not to (if it isn't NULL), keeping every
+//	disk busy: each disk is sent its next sector in the run as soon
+//	as it finishes the one before.
+//
+//	Only the disks the run touches are locked, so reads on other
+//	disks go on meanwhile.  If the run spans several disks, they all
+//	signal one semaphore, which only one run may use at a time.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadPhysicalRun(int first, int count, char *data, bool *skip)
+{
+    int next[MaxDisks];			// where each disk is in the run
+    bool mine[MaxDisks];		// does the run touch each disk?
+    int i, d, diskSector, touched = 0, outstanding = 0;
+    Semaphore *done = batchDone;
+    Spindle *spindle = NULL;
+
+    for (d = 0; d < numDisks; d++)
+	next[d] = count;
+    for (i = count - 1; i >= 0; i--)	// find each disk's first sector
+	if ((skip == NULL) || !skip[i]) {
+	    spindle = Locate(first + i, &diskSector);
+	    next[spindle - spindles] = i;
+	}
+    for (d = 0; d < numDisks; d++) {
+	mine[d] = (next[d] < count);
+	if (mine[d]) {
+	    touched++;
+	    spindle = &spindles[d];
+	}
+    }
+    if (touched == 0)
+	return;
+    if (touched == 1)
+	done = spindle->semaphore;	// it's the only one we wait for
+    else
+	batchLock->Acquire();
+    for (d = 0; d < numDisks; d++)
+	if (mine[d]) {
+	    spindles[d].lock->Acquire();	// in order, so no deadlock
+	    spindles[d].notify = done;
+	    Locate(first + next[d], &diskSector);
+	    spindles[d].disk->ReadRequest(diskSector,
+					&data[next[d] * SectorSize]);
+	    outstanding++;
+	}
+
+    while (outstanding > 0) {
+	done->P();			// one of them is done; which?
+	for (d = 0; !mine[d] || (next[d] >= count) || !spindles[d].done; d++)
+	    ;
+	spindles[d].done = FALSE;
+	outstanding--;
+	i = next[d];			// give it its next sector
+	do {
+	    if ((first + i + 1) % stripeUnit != 0)
+		i++;
+	    else			// on past the other disks' units
+		i += 1 + (numDisks - 1) * stripeUnit;
+	} while ((i < count) && (skip != NULL) && skip[i]);
+	next[d] = i;
+	if (i < count) {
+	    Locate(first + i, &diskSector);
+	    spindles[d].disk->ReadRequest(diskSector, &data[i * SectorSize]);
+	    outstanding++;
+	}
+    }
+
+    for (d = numDisks - 1; d >= 0; d--)
+	if (mine[d])
+	    spindles[d].lock->Release();
+    if (touched > 1)
+	batchLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Sync
+// 	Return once every write so far is on disk.  Only a log-structured
+//	disk holds on to writes; otherwise there's nothing to do.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Sync()
+{
+    if (log != NULL)
+	log->Sync();
 }
 
 //----------------------------------------------------------------------
-// SynchDisk::RequestDone
+// Spindle::RequestDone
 // 	Disk interrupt handler.  Wake up any thread waiting for the disk
 //	request to finish.
 //----------------------------------------------------------------------
 
 void
-SynchDisk::RequestDone()
+Spindle::RequestDone()
 { 
-    semaphore->V();
+    done = TRUE;
+    notify->V();
 }
@@ -14,6 +14,28 @@
 #include "disk.h"
 #include "synch.h"
 
+class Journal;
+class LogDisk;
+
+#define MaxDisks	8	// most disks the sectors can be striped over
+#define DefaultStripeUnit 8	// sectors in a row on one disk, unless
+				// -stripe says otherwise
+
+// The following class defines one of the disks, and the request it
+// is working on, if any.
+
+class Spindle {
+  public:
+    Disk *disk;			// The disk itself
+    Lock *lock;			// Held while a request is outstanding
+    Semaphore *semaphore;	// For a lone request to wait on
+    Semaphore *notify;		// Who to tell when the request is done:
+				// "semaphore", or a whole batch's
+    bool done;			// Set when it is
+
+    void RequestDone();		// Called by the disk interrupt handler
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -24,11 +46,40 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// Once the file system attaches its journal, reads and writes go by
+// the journal first (cf. journal.h); the journal itself uses the
+// "Unlogged" versions to get at the disk.
+//
+// If the disk is log-structured (cf. logdisk.h), the sector numbers
+// the file system uses are mapped to wherever the log put them; the
+// log itself uses the "Physical" versions.
+//
+// The "disk" may in fact be several Disks (-disks), with the sectors
+// striped across them (RAID-0): the first "stripeUnit" sectors are on
+// the first disk, the next "stripeUnit" on the second, and so on,
+// round and round.  Each disk takes one request at a time, but the
+// disks work at once: threads whose sectors are on different disks
+// don't wait for each other, and ReadSectors keeps every disk with
+// sectors in the run busy.
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
-					// by initializing the raw Disk.
+    SynchDisk(char* name, int numDisks, int stripeUnit, DiskSync sync);
+					// Initialize a synchronous disk,
+					// by initializing the raw Disks:
+					// "name", then "name.1", "name.2" ...
     ~SynchDisk();			// De-allocate the synch disk data
+
+    void Mount(bool format, bool logStructured);
+					// Find out (or, when formatting,
+					// decide) whether the disk is 
+					// log-structured
+    int Capacity();			// # of sectors the file system 
+					// may use
+    int TotalSectors() { return numDisks * NumSectors; }
+					// # of sectors on all the disks
+    int NumDisks() { return numDisks; }
+    int StripeUnit() { return stripeUnit; }
     
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
@@ -37,17 +88,39 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
-    
-    void RequestDone();			// Called by the disk device interrupt
-					// handler, to signal that the
-					// current disk operation is complete.
+    void ReadSectors(int first, int count, char* data);
+    					// Read "count" sectors, starting at
+					// "first", from all the disks at once
+
+    void ReadSectorUnlogged(int sectorNumber, char* data);
+    void WriteSectorUnlogged(int sectorNumber, char* data);
+    					// Read/write a sector, bypassing
+					// the journal
+    void ReadPhysical(int sectorNumber, char* data);
+    void WritePhysical(int sectorNumber, char* data);
+    					// Read/write a physical sector,
+					// bypassing the log as well
+    void Sync();			// Make sure every write so far has 
+					// reached the disk
+    void SetJournal(Journal *j) { journal = j; }
 
   private:
-    Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    Spindle spindles[MaxDisks];		// The raw disk devices
+    int numDisks;
+    int stripeUnit;			// Sectors in a row on one disk
+    Semaphore *batchDone;		// For ReadSectors to wait on, for
+					// any of its requests to finish
+    Lock *batchLock;			// Only one ReadSectors at a time
+    Journal *journal;			// Metadata log, or NULL if none
+    LogDisk *log;			// Log-structured layout, or NULL
+					// if sectors are written in place
+
+    Spindle *Locate(int sectorNumber, int *diskSector);
+					// Which disk "sectorNumber" is on,
+					// and where on it
+    void ReadPhysicalRun(int first, int count, char *data, bool *skip);
+					// ReadSectors, straight from the
+					// disks, except sectors in "skip"
 };
 
 #endif // SYNCHDISK_H
@@ -54,6 +54,7 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     handlerArg = callArg;
     putBusy = FALSE;
     incoming = EOF;
+    WatchFile(readFileNo);		// so an idle Nachos waits for input
 
     // start polling for incoming packets
     interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, ConsoleReadInt);
@@ -66,6 +67,7 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
 
 Console::~Console()
 {
+    UnwatchFile(readFileNo);
     if (readFileNo != 0)
 	Close(readFileNo);
     if (writeFileNo != 1)
@@ -92,12 +94,24 @@ Console::CheckCharAvail()
     interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, 
 			ConsoleReadInt);
 
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
-	return;	  
-
-    // otherwise, read character and tell user about it
-    Read(readFileNo, &c, sizeof(char));
+    // do nothing if character is already buffered
+    if (incoming != EOF)
+	return;
+
+    if (replayLog != NULL && replayLog->IsReplaying()) {
+	// take the character typed at this time in the recorded run
+	if (!replayLog->ReplayChar(&c))
+	    return;
+    } else {
+	// do nothing if none to be read
+	if (!PollFile(readFileNo))
+	    return;
+	Read(readFileNo, &c, sizeof(char));
+	if (replayLog != NULL)
+	    replayLog->RecordChar(c);
+    }
+
+    // tell user about it
     incoming = c ;
     stats->numConsoleCharsRead++;
     (*readHandler)(handlerArg);	
@@ -114,7 +128,7 @@ void
 Console::WriteDone()
 {
     putBusy = FALSE;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += putCount;
     (*writeHandler)(handlerArg);
 }
 
@@ -145,6 +159,30 @@ Console::PutChar(char ch)
     ASSERT(putBusy == FALSE);
     WriteFile(writeFileNo, &ch, sizeof(char));
     putBusy = TRUE;
+    putCount = 1;
+    stats->numConsoleWrites++;
     interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
 					ConsoleWriteInt);
 }
+
+//----------------------------------------------------------------------
+// Console::PutChars()
+// 	Write a burst of characters to the simulated display, with a 
+//	single UNIX write, schedule one interrupt for when they are all
+//	done, and return.  The first character takes as long as PutChar;
+//	each one after that only ConsoleByteTime more, as with a device 
+//	that takes its output from memory, rather than from the CPU a 
+//	character at a time.
+//----------------------------------------------------------------------
+
+void
+Console::PutChars(char *data, int length)
+{
+    ASSERT((putBusy == FALSE) && (length > 0));
+    WriteFile(writeFileNo, data, length);
+    putBusy = TRUE;
+    putCount = length;
+    stats->numConsoleWrites++;
+    interrupt->Schedule(ConsoleWriteDone, (int)this, 
+		ConsoleTime + (length - 1) * ConsoleByteTime, ConsoleWriteInt);
+}
@@ -1,6 +1,7 @@
 // disk.cc 
 //	Routines to simulate a physical disk device; reading and writing
-//	to the disk is simulated as reading and writing to a UNIX file.
+//	to the disk is simulated as copying to and from a UNIX file,
+//	mapped into memory.
 //	See disk.h for details about the behavior of disks (and
 //	therefore about the behavior of this simulation).
 //
@@ -25,6 +26,9 @@
 
 #define DiskSize 	(MagicSize + (NumSectors * SectorSize))
 
+int sectorsPerTrack = DefaultSectorsPerTrack;	// set before the first
+int numTracks = DefaultNumTracks;		// Disk is made
+
 // dummy procedure because we can't take a pointer of a member function
 static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 
@@ -32,15 +36,17 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's 
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  Then map it into memory.
 //
 //	"name" -- text name of the file simulating the Nachos disk
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes
 //	"callArg" -- argument to pass the interrupt handler
+//	"syncWhen" -- when to wait for writes to get to the file
 //----------------------------------------------------------------------
 
-Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
+Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg,
+							DiskSync syncWhen)
 {
     int magicNum;
     int tmp = 0;
@@ -49,6 +55,7 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
     handler = callWhenDone;
     handlerArg = callArg;
     lastSector = 0;
+    bufferTrack = 0;			// the head starts on track 0
     bufferInit = 0;
     
     fileno = OpenForReadWrite(name, FALSE);
@@ -59,22 +66,32 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
         fileno = OpenForWrite(name);
 	magicNum = MagicNumber;  
 	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+    }
 
-	// need to write at end of file, so that reads will not return EOF
+    // need to write at end of file, so that the mapping doesn't run off
+    // the end -- for an old file, only if -geometry made the disk bigger
+    Lseek(fileno, 0, 2);
+    if (Tell(fileno) < (int) DiskSize) {
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+    image = MapFileShared(fileno, 0, DiskSize) + MagicSize;
+    sync = syncWhen;
     active = FALSE;
 }
 
 //----------------------------------------------------------------------
 // Disk::~Disk()
 // 	Clean up disk simulation, by closing the UNIX file representing the
-//	disk.
+//	disk -- first waiting for everything written to get there, if
+//	asked to.
 //----------------------------------------------------------------------
 
 Disk::~Disk()
 {
+    if (sync != SyncNever)
+	SyncMappedFile(image - MagicSize, DiskSize);
+    UnmapFile(image - MagicSize, DiskSize);
     Close(fileno);
 }
 
@@ -100,7 +117,7 @@ PrintSector (bool writing, int sector, char *data)
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
 // 	Simulate a request to read/write a single disk sector
-//	   Do the read/write immediately to the UNIX file
+//	   Do the read/write immediately to the UNIX file's mapping
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
 //	      the operation has completed.
@@ -121,14 +138,20 @@ Disk::ReadRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    bcopy(&image[SectorSize * sectorNumber], data, SectorSize);
     if (DebugIsEnabled('d'))
 	PrintSector(FALSE, sectorNumber, data);
+#ifndef NOTRACKBUF
+    if (BufferLatency(sectorNumber) >= 0)
+	stats->numTrackBufferHits++;
+#endif
     
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskReads++;
+    if (trace != NULL)
+	trace->Span(DiskTrack, "disk", "read", stats->totalTicks, ticks,
+							sectorNumber);
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
@@ -141,14 +164,18 @@ Disk::WriteRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    bcopy(data, &image[SectorSize * sectorNumber], SectorSize);
+    if (sync == SyncEachWrite)
+	SyncMappedFile(&image[SectorSize * sectorNumber], SectorSize);
     if (DebugIsEnabled('d'))
 	PrintSector(TRUE, sectorNumber, data);
     
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskWrites++;
+    if (trace != NULL)
+	trace->Span(DiskTrack, "disk", "write", stats->totalTicks, ticks,
+							sectorNumber);
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
@@ -179,8 +206,8 @@ Disk::HandleInterrupt ()
 int
 Disk::TimeToSeek(int newSector, int *rotation) 
 {
-    int newTrack = newSector / SectorsPerTrack;
-    int oldTrack = lastSector / SectorsPerTrack;
+    int newTrack = newSector / sectorsPerTrack;
+    int oldTrack = lastSector / sectorsPerTrack;
     int seek = abs(newTrack - oldTrack) * SeekTime;
 				// how long will seek take?
     int over = (stats->totalTicks + seek) % RotationTime; 
@@ -202,10 +229,10 @@ Disk::TimeToSeek(int newSector, int *rotation)
 int 
 Disk::ModuloDiff(int to, int from)
 {
-    int toOffset = to % SectorsPerTrack;
-    int fromOffset = from % SectorsPerTrack;
+    int toOffset = to % sectorsPerTrack;
+    int fromOffset = from % sectorsPerTrack;
 
-    return ((toOffset - fromOffset) + SectorsPerTrack) % SectorsPerTrack;
+    return ((toOffset - fromOffset) + sectorsPerTrack) % sectorsPerTrack;
 }
 
 //----------------------------------------------------------------------
@@ -224,9 +251,9 @@ Disk::ModuloDiff(int to, int from)
 //
 //   	The disk also has a "track buffer"; the disk continuously reads
 //   	the contents of the current disk track into the buffer.  This allows 
-//   	read requests to the current track to be satisfied more quickly.
-//   	The contents of the track buffer are discarded after every seek to 
-//   	a new track.
+//   	read requests to the current track to be satisfied more quickly
+//	(cf. BufferLatency).  The contents of the track buffer are 
+//	discarded after every seek to a new track.
 //----------------------------------------------------------------------
 
 int
@@ -238,11 +265,12 @@ Disk::ComputeLatency(int newSector, bool writing)
 
 #ifndef NOTRACKBUF	// turn this on if you don't want the track buffer stuff
     // check if track buffer applies
-    if ((writing == FALSE) && (seek == 0) 
-		&& (((timeAfter - bufferInit) / RotationTime) 
-	     		> ModuloDiff(newSector, bufferInit / RotationTime))) {
-        DEBUG('d', "Request latency = %d\n", RotationTime);
-	return RotationTime; // time to transfer sector from the track buffer
+    int buffered = writing ? -1 : BufferLatency(newSector);
+
+    if (buffered >= 0) {
+        DEBUG('d', "Request latency = %d, from the track buffer\n",
+								buffered);
+	return buffered;
     }
 #endif
 
@@ -252,10 +280,46 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::BufferLatency
+//	Return how long it takes to read "newSector" out of the track
+//	buffer, or -1 if the buffer doesn't have it, and won't until the
+//	disk comes round to it again.
+//
+//	The buffer has the sectors that have passed all the way under the
+//	head since it arrived on the track (all of them, after a whole
+//	revolution); those take one sector's transfer time.  The sector
+//	under the head now is going into the buffer as we speak, if the
+//	head was there when it began: that one is ready when the head
+//	gets to its end.
+//----------------------------------------------------------------------
+
+int
+Disk::BufferLatency(int newSector)
+{
+    int now = stats->totalTicks;
+    int under = now / RotationTime;	// sectors gone by since time 0
+
+    if (newSector / sectorsPerTrack != bufferTrack)
+	return -1;
+    if ((now - bufferInit) / RotationTime
+			> ModuloDiff(newSector, bufferInit / RotationTime))
+	return RotationTime;		// in the buffer already
+    if ((ModuloDiff(newSector, under) == 0)
+			&& (bufferInit <= under * RotationTime))
+	return (under + 1) * RotationTime - now;	// on its way in
+    return -1;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
-//	what is in the track buffer.
+//	what is in the track buffer: if the head had to move, the buffer
+//	starts over, with the new track, once the head is there.  Also
+//	count the request as a seek, if the head had to move to get there.
+//
+//	Writes don't disturb the buffer: they go through it, so it keeps
+//	the new data.
 //----------------------------------------------------------------------
 
 void
@@ -264,8 +328,11 @@ Disk::UpdateLast(int newSector)
     int rotate;
     int seek = TimeToSeek(newSector, &rotate);
     
-    if (seek != 0)
+    if (seek != 0) {
+	bufferTrack = newSector / sectorsPerTrack;
 	bufferInit = stats->totalTicks + seek + rotate;
+	stats->numDiskSeeks++;
+    }
     lastSector = newSector;
     DEBUG('d', "Updating last sector = %d, %d\n", lastSector, bufferInit);
 }
@@ -26,13 +26,18 @@
 // sector has the same number of bytes of storage).  
 //
 // Addressing is by sector number -- each sector on the disk is given
-// a unique number: track * SectorsPerTrack + offset within a track.
+// a unique number: track * sectorsPerTrack + offset within a track.
 //
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
 // and an interrupt is invoked later to signal that the operation completed.
 //
-// The physical disk is in fact simulated via operations on a UNIX file.
+// The physical disk is in fact simulated via a UNIX file, mapped into
+// memory, so that a request is just a copy to or from the mapping.
+// The host writes changes back to the file when it likes; "sync"
+// (-dsync) says whether to wait for them to get there when Nachos
+// halts, or after every write, for when the simulated disk must
+// survive the host going down too.
 //
 // To make life a little more realistic, the simulated time for
 // each operation reflects a "track buffer" -- RAM to store the contents
@@ -44,17 +49,35 @@
 // quickly, because its contents are in the track buffer.  Most 
 // disks these days now come with a track buffer.
 //
+// The buffer holds one track: the one the head is on.  It starts
+// filling when the head arrives on the track, a sector at a time as
+// each one passes under the head, and is full after one revolution.
+// A read of a sector already in the buffer takes just the time to
+// transfer it; a read of the sector being read into the buffer right
+// now finishes when the head gets to the end of it.  Writes go
+// through to the disk, and leave the buffer holding the new data.
+// Moving the head to another track throws the buffer away.  Reads
+// the buffer serves are counted in stats->numTrackBufferHits.
+//
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
 
 #define SectorSize 		128	// number of bytes per disk sector
-#define SectorsPerTrack 	32	// number of sectors per disk track 
-#define NumTracks 		32	// number of tracks per disk
-#define NumSectors 		(SectorsPerTrack * NumTracks)
+#define DefaultSectorsPerTrack 	32	// number of sectors per disk track,
+#define DefaultNumTracks 	32	// and tracks per disk, unless
+					// -geometry says otherwise
+#define NumSectors 		(sectorsPerTrack * numTracks)
 					// total # of sectors per disk
 
+extern int sectorsPerTrack;		// the disk's geometry; set before
+extern int numTracks;			// the first Disk is made
+
+// When to make sure what's been written to the disk is in the UNIX file
+enum DiskSync { SyncNever, SyncOnHalt, SyncEachWrite };
+
 class Disk {
   public:
-    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg);
+    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg,
+							DiskSync sync);
     					// Create a simulated disk.  
 					// Invoke (*callWhenDone)(callArg) 
 					// every time a request completes.
@@ -77,16 +100,21 @@ class Disk {
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    char *image;			// The file, mapped into memory
+    DiskSync sync;			// When to wait for writes to get to it
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     int handlerArg;			// Argument to interrupt handler 
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
+    int bufferTrack;			// The track in the track buffer
     int bufferInit;			// When the track buffer started 
 					// being loaded
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
+    int BufferLatency(int newSector);	// how long the track buffer takes
+					// to supply newSector; -1 if it can't
     void UpdateLast(int newSector);
 };
 
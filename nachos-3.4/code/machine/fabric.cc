@@ -0,0 +1,106 @@
+// fabric.cc
+//	Routines to simulate a network of machines within one Nachos,
+//	delivering packets between their Network devices with simulated
+//	interrupts.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+
+#include "copyright.h"
+#include "system.h"
+
+// Dummy function because C++ can't call member functions indirectly
+static void FabricArrive(int arg)
+{ fabric->Arrive((Packet *)arg); }
+
+// Initialize the fabric
+//   nNodes machines, with addresses 0 through nNodes - 1
+//   reliability is the default chance that a link delivers a packet
+Fabric::Fabric(int nNodes, double reliability)
+{
+    int i;
+
+    numNodes = nNodes;
+    nodes = new Network *[numNodes];
+    for (i = 0; i < numNodes; i++)
+	nodes[i] = NULL;
+    links = new Link[numNodes * numNodes];
+    SetLink(-1, -1, FabricLatency, FabricBandwidth, reliability);
+}
+
+Fabric::~Fabric()
+{
+    delete [] nodes;
+    delete [] links;
+}
+
+// change the characteristics of one link, or (with -1 as "from" or
+// "to") of many links at once
+void
+Fabric::SetLink(NetworkAddress from, NetworkAddress to, int latency,
+				int bandwidth, double reliability)
+{
+    int i, j;
+
+    ASSERT((from >= -1) && (from < numNodes) && (to >= -1) && (to < numNodes));
+    ASSERT((latency >= 0) && (bandwidth > 0));
+    if (reliability < 0) reliability = 0;
+    else if (reliability > 1) reliability = 1;
+
+    for (i = 0; i < numNodes; i++)
+	for (j = 0; j < numNodes; j++)
+	    if ((from == -1 || from == i) && (to == -1 || to == j)) {
+		links[i * numNodes + j].latency = latency;
+		links[i * numNodes + j].bandwidth = bandwidth;
+		links[i * numNodes + j].reliability = reliability;
+	    }
+}
+
+void
+Fabric::Attach(NetworkAddress addr, Network *net)
+{
+    ASSERT((addr >= 0) && (addr < numNodes) && (nodes[addr] == NULL));
+    nodes[addr] = net;
+}
+
+void
+Fabric::Detach(NetworkAddress addr)
+{
+    ASSERT((addr >= 0) && (addr < numNodes));
+    nodes[addr] = NULL;
+}
+
+// put a packet on the link to its destination, and schedule an
+// interrupt for when it arrives there -- unless the link loses it
+int
+Fabric::Transmit(Packet *pkt)
+{
+    PacketHeader *hdr = pkt->Header();
+    Link *link;
+    int sendTime;
+
+    ASSERT((hdr->to >= 0) && (hdr->to < numNodes));
+    link = &links[hdr->from * numNodes + hdr->to];
+    sendTime = (hdr->length + sizeof(PacketHeader)) * 1000 / link->bandwidth;
+    if (sendTime < 1)
+	sendTime = 1;
+
+    if (Random() % 100 >= link->reliability * 100) { // emulate a lost packet
+	DEBUG('n', "oops, lost it!\n");
+	packetPool->Free(pkt);
+    } else
+	interrupt->Schedule(FabricArrive, (int)pkt, sendTime + link->latency,
+							NetworkRecvInt);
+    return sendTime;
+}
+
+// hand an arriving packet to its destination's network device
+void
+Fabric::Arrive(Packet *pkt)
+{
+    Network *net = nodes[pkt->Header()->to];
+
+    if (net == NULL)			// nobody there any more
+	packetPool->Free(pkt);
+    else
+	net->Deliver(pkt);
+}
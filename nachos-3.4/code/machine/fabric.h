@@ -0,0 +1,79 @@
+// fabric.h
+//	Data structures to emulate a whole network of machines inside one
+//	Nachos process.
+//
+//	Normally each simulated machine is a separate UNIX process, and
+//	packets travel between them over UNIX sockets, so a run with many
+//	machines is slow to start, and what happens depends on how the
+//	host schedules the processes.  With a fabric (nachos -nodes <n>),
+//	all n machines' Network devices live in this process, and a packet
+//	sent by one is handed to another by a simulated interrupt, at a
+//	time decided by the link between them.  Everything runs off the
+//	one simulated clock (and the one random number generator), so a
+//	run is repeatable.
+//
+//	Each link (from one machine to another) has its own latency,
+//	bandwidth, and reliability.  Sending a packet keeps the sender's
+//	network device busy while the packet is transmitted (its size
+//	divided by the bandwidth); the packet arrives "latency" ticks
+//	after that, unless the link loses it.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+
+#include "copyright.h"
+
+#ifndef FABRIC_H
+#define FABRIC_H
+
+#include "network.h"
+
+// Default link characteristics: about one packet per NetworkTime, like
+// the socket emulation, with another NetworkTime of latency.
+#define FabricLatency		NetworkTime
+#define FabricBandwidth		(MaxWireSize * 1000 / NetworkTime)
+					// bytes per 1000 ticks
+
+// The following class defines the characteristics of one link.
+
+class Link {
+  public:
+    int latency;		// ticks from end of transmission to arrival
+    int bandwidth;		// bytes per 1000 ticks
+    double reliability;		// chance a packet gets through
+};
+
+// The following class defines the fabric connecting the machines.
+
+class Fabric {
+  public:
+    Fabric(int nNodes, double reliability);
+				// Connect "nNodes" machines, with default
+				// links that lose packets with probability
+				// 1 - "reliability"
+    ~Fabric();			// De-allocate the fabric
+
+    int NumNodes() { return numNodes; }
+
+    void SetLink(NetworkAddress from, NetworkAddress to, int latency,
+				int bandwidth, double reliability);
+				// Change the link from "from" to "to"; -1
+				// for either means all machines
+
+    void Attach(NetworkAddress addr, Network *net);
+				// Plug a machine's network device in
+    void Detach(NetworkAddress addr);	// And unplug it
+
+    int Transmit(Packet *pkt);	// Start a packet on its way, taking over
+				// its buffer; return how long the sender
+				// is busy sending it
+    void Arrive(Packet *pkt);	// Interrupt handler, called when a
+				// packet reaches the other end of its link
+
+  private:
+    int numNodes;		// Number of machines
+    Network **nodes;		// Their network devices; NULL if not
+				// (or no longer) attached
+    Link *links;		// Link from i to j is links[i*numNodes + j]
+};
+
+#endif // FABRIC_H
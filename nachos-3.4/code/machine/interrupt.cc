@@ -156,9 +156,11 @@ Interrupt::OneTick()
     if (status == SystemMode) {
         stats->totalTicks += SystemTick;
 	stats->systemTicks += SystemTick;
+	currentThread->account->systemTicks += SystemTick;
     } else {					// USER_PROGRAM
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
+	currentThread->account->userTicks += UserTick;
     }
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
@@ -166,16 +168,19 @@ Interrupt::OneTick()
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
 					// (interrupt handlers run with
 					// interrupts disabled)
-    while (CheckIfDue(FALSE))		// check for pending interrupts
-	;
+    if ((smp == NULL) || (smp->CurrentId() == 0))
+	while (CheckIfDue(FALSE))	// check for pending interrupts
+	    ;				// (devices only interrupt CPU 0)
     ChangeLevel(IntOff, IntOn);		// re-enable interrupts
     if (yieldOnReturn) {		// if the timer device handler asked 
 					// for a context switch, ok to do it now
 	yieldOnReturn = FALSE;
  	status = SystemMode;		// yield is a kernel routine
-	currentThread->Yield();
+	currentThread->Yield(TRUE);
 	status = old;
     }
+    if (smp != NULL)			// on a multiprocessor, has this
+	smp->CheckSlice();		// CPU had its turn?
 }
 
 //----------------------------------------------------------------------
@@ -204,14 +209,28 @@ Interrupt::YieldOnReturn()
 //	on the ready queue, the only thing to do is to advance 
 //	simulated time until the next scheduled hardware interrupt.
 //
+//	If the next interrupt is just the console or the network checking 
+//	for input, first wait for some input to actually show up (or for 
+//	IdleWaitTime to pass), so that we don't spin, and so that other
+//	Nachos on the network get a chance to run.
+//
 //	If there are no pending interrupts, stop.  There's nothing
 //	more for us to do.
 //----------------------------------------------------------------------
 void
 Interrupt::Idle()
 {
+    PendingInterrupt *next = (PendingInterrupt *) pending->Front();
+
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+    if (trace != NULL)
+	trace->Running(NULL);
+    if (next != NULL && (next->type == ConsoleReadInt 
+				|| next->type == NetworkRecvInt)
+		&& (replayLog == NULL || !replayLog->IsReplaying()))
+	(void) WaitForInput(IdleWaitTime);	// (on replay, input comes
+						// from the log instead)
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
 	    ;				// interrupts
@@ -233,6 +252,32 @@ Interrupt::Idle()
     Halt();
 }
 
+//----------------------------------------------------------------------
+// Interrupt::IdleUntil
+// 	Like Idle, for one CPU of a multiprocessor that has nothing to
+//	do, but only as far as time "when": if an interrupt is due by
+//	then, roll time forward to it, and fire it (and any others due
+//	then).  Return FALSE if nothing was.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::IdleUntil(int when)
+{
+    PendingInterrupt *next = (PendingInterrupt *) pending->Front();
+    bool fired;
+
+    if ((next == NULL) || (next->when > when))
+	return FALSE;
+    status = IdleMode;
+    fired = CheckIfDue(TRUE);
+    if (fired)
+	while (CheckIfDue(FALSE))
+	    ;
+    yieldOnReturn = FALSE;		// nothing to yield to
+    status = SystemMode;
+    return fired;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
@@ -242,6 +287,9 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+    if (smp != NULL)
+	smp->Print();
+    accounting->Print();
     Cleanup();     // Never returns.
 }
 
@@ -324,6 +372,9 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (machine != NULL)
     	machine->DelayedLoad(0, 0);
 #endif
+    if (trace != NULL)
+	trace->Instant(InterruptTrack, "interrupt",
+				intTypeNames[toOccur->type], 0);
     inHandler = TRUE;
     status = SystemMode;			// whatever we were doing,
 						// we are now going to be
@@ -367,3 +418,48 @@ Interrupt::DumpState()
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
+
+//----------------------------------------------------------------------
+// IsPending
+// 	Return TRUE if an interrupt of kind "type" is scheduled to occur.
+//	Mapcar has no way to pass along anything but the element, so
+//	CheckPending looks at (and sets) these statics.
+//----------------------------------------------------------------------
+
+static IntType lookingFor;
+static bool found;
+
+static void
+CheckPending(int arg)
+{
+    PendingInterrupt *pend = (PendingInterrupt *)arg;
+
+    if (pend->type == lookingFor)
+	found = TRUE;
+}
+
+bool
+Interrupt::IsPending(IntType type)
+{
+    lookingFor = type;
+    found = FALSE;
+    pending->Mapcar(CheckPending);
+    return found;
+}
+
+//----------------------------------------------------------------------
+// NextDue
+// 	Return TRUE if any interrupt is scheduled to occur, and set "when"
+//	to the time the first one is due.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::NextDue(int *when)
+{
+    PendingInterrupt *next = (PendingInterrupt *) pending->Front();
+
+    if (next == NULL)
+	return FALSE;
+    *when = next->when;
+    return TRUE;
+}
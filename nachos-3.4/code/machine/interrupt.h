@@ -52,6 +52,11 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 				NetworkSendInt, NetworkRecvInt};
 
+// When there is nothing to do but poll the console or the network for
+// input, the idle loop waits (in real time) for input to arrive, but
+// no longer than this many milliseconds.
+#define IdleWaitTime	20
+
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
@@ -89,6 +94,8 @@ class Interrupt {
     void Idle(); 			// The ready queue is empty, roll 
 					// simulated time forward until the 
 					// next interrupt
+    bool IdleUntil(int when);		// Likewise, but no further than
+					// "when" (cf. cpu.h)
 
     void Halt(); 			// quit and print out stats
     
@@ -99,6 +106,10 @@ class Interrupt {
     void setStatus(MachineStatus st) { status = st; }
 
     void DumpState();			// Print interrupt state
+    bool IsPending(IntType type);	// Is an interrupt of this kind
+					// scheduled to happen?
+    bool NextDue(int *when);		// When is the next interrupt due?
+					// FALSE if none is scheduled
     
 
     // NOTE: the following are internal to the hardware simulation code.
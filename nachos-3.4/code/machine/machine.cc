@@ -44,6 +44,8 @@ void CheckEndian()
 #endif
 }
 
+int numPhysPages = DefaultPhysPages;	// set before the Machine is made
+
 //----------------------------------------------------------------------
 // Machine::Machine
 // 	Initialize the simulation of user program execution.
@@ -72,9 +74,37 @@ Machine::Machine(bool debug)
 #endif
 
     singleStep = debug;
+    memoryMapped = FALSE;
+    sharedMemory = FALSE;
+    runningAhead = FALSE;
     CheckEndian();
 }
 
+//----------------------------------------------------------------------
+// Machine::Machine
+// 	Initialize another CPU to run user code on, for a multiprocessor
+//	running its CPUs on several host threads (cf. cpu.h).  It has
+//	registers of its own, but "host"'s main memory; the kernel points
+//	it at a TLB or page table before each run.
+//
+//	"host" -- the machine the kernel runs on
+//----------------------------------------------------------------------
+
+Machine::Machine(Machine *host)
+{
+    for (int i = 0; i < NumTotalRegs; i++)
+        registers[i] = 0;
+    mainMemory = host->mainMemory;
+    tlb = NULL;
+    pageTable = NULL;
+    pageTableSize = 0;
+
+    singleStep = FALSE;
+    memoryMapped = FALSE;
+    sharedMemory = TRUE;
+    runningAhead = FALSE;
+}
+
 //----------------------------------------------------------------------
 // Machine::~Machine
 // 	De-allocate the data structures used to simulate user program execution.
@@ -82,11 +112,37 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
-    delete [] mainMemory;
+    if (sharedMemory)
+	return;				// none of it is ours
+    if (memoryMapped)
+	UnmapFile(mainMemory, MemorySize);
+    else
+	delete [] mainMemory;
     if (tlb != NULL)
         delete [] tlb;
 }
 
+//----------------------------------------------------------------------
+// Machine::MapMemory
+// 	Replace main memory with the contents of a file, mapped
+//	copy-on-write, so that each page is only read in from the file
+//	when the program touches it (cf. checkpoint.h).
+//
+//	"fd" -- the open file
+//	"offset" -- where in the file memory starts; page aligned
+//----------------------------------------------------------------------
+
+void
+Machine::MapMemory(int fd, int offset)
+{
+    if (memoryMapped)
+	UnmapFile(mainMemory, MemorySize);
+    else
+	delete [] mainMemory;
+    mainMemory = MapFile(fd, offset, MemorySize);
+    memoryMapped = TRUE;
+}
+
 //----------------------------------------------------------------------
 // Machine::RaiseException
 // 	Transfer control to the Nachos kernel from user mode, because
@@ -95,11 +151,22 @@ Machine::~Machine()
 //
 //	"which" -- the cause of the kernel trap
 //	"badVaddr" -- the virtual address causing the trap, if appropriate
+//
+//	When running ahead (cf. RunAhead), there is no kernel to trap to:
+//	just note the trap, and leave everything as it was, so that the
+//	instruction runs again, for real, when the CPU's turn comes.
 //----------------------------------------------------------------------
 
 void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
+    int start = stats->totalTicks;
+    int type = registers[2];		// which syscall, if it is one
+
+    if (runningAhead) {
+	trapped = TRUE;
+	return;
+    }
     DEBUG('m', "Exception: %s\n", exceptionNames[which]);
     
 //  ASSERT(interrupt->getStatus() == UserMode);
@@ -108,6 +175,10 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
     interrupt->setStatus(UserMode);
+    if (trace != NULL)
+	trace->Span(trace->ThreadTrack(currentThread), "exception",
+		exceptionNames[which], start, stats->totalTicks - start,
+		(which == SyscallException) ? type : badVAddr);
 }
 
 //----------------------------------------------------------------------
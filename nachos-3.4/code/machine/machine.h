@@ -32,10 +32,13 @@
 					// the disk sector size, for
 					// simplicity
 
-#define NumPhysPages    32
-#define MemorySize 	(NumPhysPages * PageSize)
+#define DefaultPhysPages 32		// pages of main memory, unless -mem
+					// says otherwise
+#define MemorySize 	(numPhysPages * PageSize)
 #define TLBSize		4		// if there is a TLB, make it small
 
+extern int numPhysPages;		// pages of main memory
+
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
 		     PageFaultException,    // No valid translation found
@@ -108,16 +111,25 @@ class Machine {
   public:
     Machine(bool debug);	// Initialize the simulation of the hardware
 				// for running user programs
+    Machine(Machine *host);	// Another CPU to run user code on, ahead
+				// of time, sharing "host"'s main memory
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
     void Run();	 		// Run a user program
+    int RunAhead(int ticks);	// Run user instructions for less than
+				// "ticks", stopping short of any that
+				// would trap; return the time they took
 
     int ReadRegister(int num);	// read the contents of a CPU register
 
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    void MapMemory(int fd, int offset);
+				// take main memory from a file, reading
+				// in pages only as they are touched
+
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
@@ -187,6 +199,10 @@ class Machine {
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    bool memoryMapped;		// is mainMemory mapped from a file?
+    bool sharedMemory;		// is mainMemory another Machine's?
+    bool runningAhead;		// in RunAhead?  Then traps don't go to
+    bool trapped;		// the kernel; they just set "trapped"
 };
 
 extern void ExceptionHandler(ExceptionType which);
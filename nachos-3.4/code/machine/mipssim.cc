@@ -17,6 +17,7 @@
 #include "system.h"
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
+static bool IsConditionalBranch(int opCode);
 
 //----------------------------------------------------------------------
 // Machine::Run
@@ -38,12 +39,48 @@ Machine::Run()
     interrupt->setStatus(UserMode);
     for (;;) {
         OneInstruction(instr);
+	if (profiler != NULL)
+	    profiler->Tick();
 	interrupt->OneTick();
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
+	if ((checkpointName != NULL) && (checkpointTime <= stats->totalTicks)
+					&& TakeCheckpoint(checkpointName))
+	  checkpointName = NULL;		// only once
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::RunAhead
+// 	Run user instructions for a CPU of a multiprocessor, on a host
+//	thread of its own, before its turn comes (cf. cpu.h).  There is
+//	no kernel here, nor any interrupts: stop at the first instruction
+//	that would trap, leaving it to be run again when the CPU's turn
+//	comes, and stop short of "ticks" from now, so that whatever is
+//	due to happen then happens during the turn, just as it would have.
+//
+//	Returns the time the instructions took.  The caller must charge
+//	it to the CPU; nothing else here touches the clock or statistics.
+//----------------------------------------------------------------------
+
+int
+Machine::RunAhead(int ticks)
+{
+    Instruction instr;
+    int done = 0;
+
+    runningAhead = TRUE;
+    trapped = FALSE;
+    while (done + UserTick < ticks) {
+	OneInstruction(&instr);
+	if (trapped)
+	    break;
+	done += UserTick;
+    }
+    runningAhead = FALSE;
+    return done;
+}
+
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -99,10 +136,12 @@ Machine::OneInstruction(Instruction *instr)
 				// in the future
 
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
+    if (!ReadMem(registers[PCReg], 4, &raw))
 	return;			// exception occurred
     instr->value = raw;
     instr->Decode();
+    if (stats->histograms)
+	stats->opcodeCounts[instr->opCode]++;
 
     if (DebugIsEnabled('m')) {
        struct OpString *str = &opStrings[instr->opCode];
@@ -116,6 +155,7 @@ Machine::OneInstruction(Instruction *instr)
     
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
+    bool taken = FALSE;			// was it a branch, taken?
     int sum, diff, tmp, value;
     unsigned int rs, rt, imm;
 
@@ -159,37 +199,49 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_BEQ:
-	if (registers[instr->rs] == registers[instr->rt])
+	if (registers[instr->rs] == registers[instr->rt]) {
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	    taken = TRUE;
+	}
 	break;
 	
       case OP_BGEZAL:
 	registers[R31] = registers[NextPCReg] + 4;
       case OP_BGEZ:
-	if (!(registers[instr->rs] & SIGN_BIT))
+	if (!(registers[instr->rs] & SIGN_BIT)) {
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	    taken = TRUE;
+	}
 	break;
 	
       case OP_BGTZ:
-	if (registers[instr->rs] > 0)
+	if (registers[instr->rs] > 0) {
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	    taken = TRUE;
+	}
 	break;
 	
       case OP_BLEZ:
-	if (registers[instr->rs] <= 0)
+	if (registers[instr->rs] <= 0) {
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	    taken = TRUE;
+	}
 	break;
 	
       case OP_BLTZAL:
 	registers[R31] = registers[NextPCReg] + 4;
       case OP_BLTZ:
-	if (registers[instr->rs] & SIGN_BIT)
+	if (registers[instr->rs] & SIGN_BIT) {
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	    taken = TRUE;
+	}
 	break;
 	
       case OP_BNE:
-	if (registers[instr->rs] != registers[instr->rt])
+	if (registers[instr->rs] != registers[instr->rt]) {
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	    taken = TRUE;
+	}
 	break;
 	
       case OP_DIV:
@@ -218,12 +270,22 @@ Machine::OneInstruction(Instruction *instr)
 	
       case OP_JAL:
 	registers[R31] = registers[NextPCReg] + 4;
+	pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+	if ((profiler != NULL) && !runningAhead)
+	    profiler->Call(registers[PCReg], pcAfter);
+	break;
+
       case OP_J:
 	pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
 	break;
 	
       case OP_JALR:
 	registers[instr->rd] = registers[NextPCReg] + 4;
+	pcAfter = registers[instr->rs];
+	if ((profiler != NULL) && !runningAhead)
+	    profiler->Call(registers[PCReg], pcAfter);
+	break;
+
       case OP_JR:
 	pcAfter = registers[instr->rs];
 	break;
@@ -231,7 +293,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LB:
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
-	if (!machine->ReadMem(tmp, 1, &value))
+	if (!ReadMem(tmp, 1, &value))
 	    return;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
@@ -249,7 +311,7 @@ Machine::OneInstruction(Instruction *instr)
 	    RaiseException(AddressErrorException, tmp);
 	    return;
 	}
-	if (!machine->ReadMem(tmp, 2, &value))
+	if (!ReadMem(tmp, 2, &value))
 	    return;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
@@ -271,7 +333,7 @@ Machine::OneInstruction(Instruction *instr)
 	    RaiseException(AddressErrorException, tmp);
 	    return;
 	}
-	if (!machine->ReadMem(tmp, 4, &value))
+	if (!ReadMem(tmp, 4, &value))
 	    return;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
@@ -285,7 +347,7 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem(tmp, 4, &value))
+	if (!ReadMem(tmp, 4, &value))
 	    return;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
@@ -316,7 +378,7 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem(tmp, 4, &value))
+	if (!ReadMem(tmp, 4, &value))
 	    return;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
@@ -381,13 +443,13 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SB:
-	if (!machine->WriteMem((unsigned) 
+	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
 	    return;
 	break;
 	
       case OP_SH:
-	if (!machine->WriteMem((unsigned) 
+	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
 	    return;
 	break;
@@ -469,7 +531,7 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SW:
-	if (!machine->WriteMem((unsigned) 
+	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
 	    return;
 	break;
@@ -481,7 +543,7 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
+	if (!ReadMem((tmp & ~0x3), 4, &value))
 	    return;
 	switch (tmp & 0x3) {
 	  case 0:
@@ -500,7 +562,7 @@ Machine::OneInstruction(Instruction *instr)
 					    0xff);
 	    break;
 	}
-	if (!machine->WriteMem((tmp & ~0x3), 4, value))
+	if (!WriteMem((tmp & ~0x3), 4, value))
 	    return;
 	break;
     	
@@ -511,7 +573,7 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
+	if (!ReadMem((tmp & ~0x3), 4, &value))
 	    return;
 	switch (tmp & 0x3) {
 	  case 0:
@@ -527,7 +589,7 @@ Machine::OneInstruction(Instruction *instr)
 	    value = registers[instr->rt];
 	    break;
 	}
-	if (!machine->WriteMem((tmp & ~0x3), 4, value))
+	if (!WriteMem((tmp & ~0x3), 4, value))
 	    return;
 	break;
     	
@@ -554,6 +616,13 @@ Machine::OneInstruction(Instruction *instr)
     
     // Now we have successfully executed the instruction.
     
+    if (stats->histograms && IsConditionalBranch(instr->opCode)) {
+	if (taken)
+	    stats->numBranchesTaken++;
+	else
+	    stats->numBranchesNotTaken++;
+    }
+
     // Do any delayed load operation
     DelayedLoad(nextLoadReg, nextLoadValue);
     
@@ -690,3 +759,27 @@ Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
     *hiPtr = (int) hi;
     *loPtr = (int) lo;
 }
+
+//----------------------------------------------------------------------
+// IsConditionalBranch
+// 	Return TRUE if "opCode" is a branch that may or may not be taken,
+//	for counting which way it went (cf. Statistics).
+//----------------------------------------------------------------------
+
+static bool
+IsConditionalBranch(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ:
+      case OP_BGEZ:
+      case OP_BGEZAL:
+      case OP_BGTZ:
+      case OP_BLEZ:
+      case OP_BLTZ:
+      case OP_BLTZAL:
+      case OP_BNE:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
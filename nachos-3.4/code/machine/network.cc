@@ -2,6 +2,9 @@
 //	Routines to simulate a network interface, using UNIX sockets
 //	to deliver packets between multiple invocations of nachos.
 //
+//	With -nodes, the machines all live in this Nachos instead, and
+//	the fabric (cf. fabric.h) carries packets between them.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -37,12 +40,20 @@ Network::Network(NetworkAddress addr, double reliability,
     readHandler = readAvail;
     handlerArg = callArg;
     sendBusy = FALSE;
-    inHdr.length = 0;
+    ringHead = ringCount = 0;
+    backlogHead = backlogTail = NULL;
+
+    if (fabric != NULL) {	// no socket; the fabric brings us packets
+	sock = -1;
+	fabric->Attach(addr, this);
+	return;
+    }
     
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", (int)addr);
     AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
 						 // in the current directory.
+    WatchFile(sock);
 
     // start polling for incoming packets
     interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
@@ -50,40 +61,71 @@ Network::Network(NetworkAddress addr, double reliability,
 
 Network::~Network()
 {
-    CloseSocket(sock);
-    DeAssignNameToSocket(sockName);
+    Packet *pkt;
+
+    if (fabric != NULL)
+	fabric->Detach(ident);
+    else {
+	UnwatchFile(sock);
+	CloseSocket(sock);
+	DeAssignNameToSocket(sockName);
+    }
+    while ((pkt = ReceivePacket()) != NULL)
+	packetPool->Free(pkt);
 }
 
-// if a packet is already buffered, we simply delay reading 
-// the incoming packet.  In real life, the incoming 
-// packet might be dropped if we can't read it in time.
+
+// read in every packet that has arrived since the last poll, as long
+// as there's room in the ring; they are read in batches, straight into
+// packet buffers, which are then handed up to the post office as is.
+// If the ring is full, we simply delay reading the rest.  In real life,
+// the incoming packets might be dropped if we can't read them in time.
 void
 Network::CheckPktAvail()
 {
+    Packet *fresh[NetworkRingSize];
+    char *wires[NetworkRingSize];
+    int room, n, i;
+    PacketHeader *hdr;
+
     // schedule the next time to poll for a packet
     interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
 
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
-	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
-
-    // otherwise, read packet in
-    char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    while (ringCount < NetworkRingSize) {
+	room = NetworkRingSize - ringCount;
+	for (i = 0; i < room; i++) {
+	    fresh[i] = packetPool->Alloc();
+	    wires[i] = fresh[i]->wire;
+	}
+	if (replayLog != NULL && replayLog->IsReplaying()) {
+	    // take the packets read at this time in the recorded run
+	    for (n = 0; n < room; n++)
+		if (!replayLog->ReplayPacket(wires[n], MaxWireSize))
+		    break;
+	} else {
+	    n = ReadPacketsFromSocket(sock, wires, MaxWireSize, room);
+	    for (i = 0; replayLog != NULL && i < n; i++)
+		replayLog->RecordPacket(wires[i], sizeof(PacketHeader)
+					+ ((PacketHeader *) wires[i])->length);
+	}
+	for (i = n; i < room; i++)	// didn't need these after all
+	    packetPool->Free(fresh[i]);
 
-    // divide packet into header and data
-    inHdr = *(PacketHeader *)buffer;
-    ASSERT((inHdr.to == ident) && (inHdr.length <= MaxPacketSize));
-    bcopy(buffer + sizeof(PacketHeader), inbox, inHdr.length);
-    delete []buffer ;
-
-    DEBUG('n', "Network received packet from %d, length %d...\n",
-	  				(int) inHdr.from, inHdr.length);
-    stats->numPacketsRecvd++;
+	for (i = 0; i < n; i++) {
+	    hdr = fresh[i]->Header();
+	    ASSERT((hdr->to == ident) && (hdr->length <= MaxPacketSize));
+	    DEBUG('n', "Network received packet from %d, length %d...\n",
+	  				(int) hdr->from, hdr->length);
+	    stats->numPacketsRecvd++;
+	    ring[(ringHead + ringCount) % NetworkRingSize] = fresh[i];
+	    ringCount++;
 
-    // tell post office that the packet has arrived
-    (*readHandler)(handlerArg);	
+	    // tell post office that the packet has arrived
+	    (*readHandler)(handlerArg);	
+	}
+	if (n < room)		// nothing more waiting
+	    break;
+    }
 }
 
 // notify user that another packet can be sent
@@ -97,43 +139,155 @@ Network::SendDone()
 
 // send a packet by concatenating hdr and data, and schedule
 // an interrupt to tell the user when the next packet can be sent 
+void
+Network::Send(PacketHeader hdr, char* data)
+{
+    Packet *pkt = packetPool->Alloc();
+
+    ASSERT(hdr.length <= MaxPacketSize);
+    *pkt->Header() = hdr;
+    bcopy(data, pkt->Payload(), hdr.length);
+    stats->numPayloadCopies++;
+    Send(pkt);
+}
+
+// send a packet that is already in a packet buffer, and give the 
+// buffer back to the pool once it's in the socket
 //
 // Note we always pad out a packet to MaxWireSize before putting it into
 // the socket, because it's simpler at the receive end.
 void
-Network::Send(PacketHeader hdr, char* data)
+Network::Send(Packet *pkt)
 {
+    PacketHeader *hdr = pkt->Header();
     char toName[32];
 
-    sprintf(toName, "SOCKET_%d", (int)hdr.to);
+    sprintf(toName, "SOCKET_%d", (int)hdr->to);
     
-    ASSERT((sendBusy == FALSE) && (hdr.length > 0) 
-		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
-    DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
+    ASSERT((sendBusy == FALSE) && (hdr->length > 0) 
+		&& (hdr->length <= MaxPacketSize) && (hdr->from == ident));
+    DEBUG('n', "Sending to addr %d, %d bytes... ", hdr->to, hdr->length);
+
+    if (fabric != NULL) {	// the link decides how long sending takes,
+				// and whether the packet is lost
+	interrupt->Schedule(NetworkSendDone, (int)this, fabric->Transmit(pkt),
+							NetworkSendInt);
+	return;
+    }
 
     interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
 
     if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
 	DEBUG('n', "oops, lost it!\n");
-	return;
-    }
-
-    // concatenate hdr and data into a single buffer, and send it out
-    char *buffer = new char[MaxWireSize];
-    *(PacketHeader *)buffer = hdr;
-    bcopy(data, buffer + sizeof(PacketHeader), hdr.length);
-    SendToSocket(sock, buffer, MaxWireSize, toName);
-    delete []buffer;
+    } else if (replayLog != NULL && replayLog->IsReplaying()) {
+	// nobody is listening; their replies are in the log
+    } else
+	SendToSocket(sock, pkt->wire, MaxWireSize, toName);
+    packetPool->Free(pkt);
 }
 
-// read a packet, if one is buffered
+// read the oldest packet, if one is buffered
 PacketHeader
 Network::Receive(char* data)
 {
-    PacketHeader hdr = inHdr;
+    Packet *pkt = ReceivePacket();
+    PacketHeader hdr;
 
-    inHdr.length = 0;
-    if (hdr.length != 0)
-    	bcopy(inbox, data, hdr.length);
+    if (pkt == NULL) {
+	hdr.length = 0;
+	return hdr;
+    }
+    hdr = *pkt->Header();
+    bcopy(pkt->Payload(), data, hdr.length);
+    stats->numPayloadCopies++;
+    packetPool->Free(pkt);
     return hdr;
 }
+
+// hand over the oldest packet, if one is buffered
+Packet *
+Network::ReceivePacket()
+{
+    Packet *pkt;
+
+    if (ringCount == 0)
+	return NULL;
+    pkt = ring[ringHead];
+    ringHead = (ringHead + 1) % NetworkRingSize;
+    ringCount--;
+    if (backlogHead != NULL) {	// there's room for one more in the ring
+	ring[(ringHead + ringCount) % NetworkRingSize] = backlogHead;
+	ringCount++;
+	backlogHead = backlogHead->next;
+    }
+    return pkt;
+}
+
+// a packet has come in over the fabric; since it can't be left in a 
+// socket, hold on to it even if the ring is full, so that the fabric
+// only loses packets when it's told to
+void
+Network::Deliver(Packet *pkt)
+{
+    PacketHeader *hdr = pkt->Header();
+
+    ASSERT((hdr->to == ident) && (hdr->length <= MaxPacketSize));
+    DEBUG('n', "Network received packet from %d, length %d...\n",
+	  				(int) hdr->from, hdr->length);
+    stats->numPacketsRecvd++;
+    if (ringCount < NetworkRingSize) {
+	ring[(ringHead + ringCount) % NetworkRingSize] = pkt;
+	ringCount++;
+    } else {
+	pkt->next = NULL;
+	if (backlogHead == NULL)
+	    backlogHead = pkt;
+	else
+	    backlogTail->next = pkt;
+	backlogTail = pkt;
+    }
+
+    // tell post office that the packet has arrived
+    (*readHandler)(handlerArg);	
+}
+
+// the pool starts out empty, and grows to however many buffers are
+// in use at once
+PacketPool::PacketPool()
+{
+    freeList = NULL;
+}
+
+PacketPool::~PacketPool()
+{
+    Packet *pkt;
+
+    while (freeList != NULL) {
+	pkt = freeList;
+	freeList = pkt->next;
+	delete pkt;
+    }
+}
+
+// Nachos threads can only be switched when interrupts are enabled, 
+// so the free list needs no lock, even though interrupt handlers 
+// use it too
+Packet *
+PacketPool::Alloc()
+{
+    Packet *pkt = freeList;
+
+    if (pkt == NULL) {
+	stats->numPacketBuffers++;
+	return new Packet;
+    }
+    freeList = pkt->next;
+    return pkt;
+}
+
+void
+PacketPool::Free(Packet *pkt)
+{
+    pkt->next = freeList;
+    freeList = pkt;
+}
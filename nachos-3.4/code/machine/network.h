@@ -37,9 +37,50 @@ class PacketHeader {
 				// MailHeader prepended by the post office)
 };
 
-#define MaxWireSize 	64	// largest packet that can go out on the wire
+#ifndef MaxWireSize		// can be set at compile time, e.g. with
+#define MaxWireSize 	64	// -DMaxWireSize=1024; every Nachos on the
+#endif				// network has to agree
+				// largest packet that can go out on the wire
 #define MaxPacketSize 	(MaxWireSize - sizeof(struct PacketHeader))	
 				// data "payload" of the largest packet
+#define NetworkRingSize	16	// arrived packets the network device can
+				// hold before the post office takes them
+
+// The following class defines a packet buffer: room for a whole packet
+// as it goes out on (or comes in off) the wire -- the PacketHeader, then
+// the payload, with the MailHeader of the post office at the front of
+// the payload.  Outgoing mail is built right in a packet buffer, and 
+// incoming mail stays in the buffer it arrived in until the receiver 
+// copies it out, so the data is copied once on each side.
+//
+// Whoever holds a buffer owns it: handing one to Network::Send, or 
+// getting one back from Network::ReceivePacket, passes it along.  When
+// done, the owner gives it back to the pool.
+
+class Packet {
+  public:
+    PacketHeader *Header() { return (PacketHeader *) wire; }
+    char *Payload() { return wire + sizeof(PacketHeader); }
+
+    char wire[MaxWireSize];	// The packet, just as it is on the wire
+    Packet *next;		// Next buffer on the pool's free list
+};
+
+// The following class defines a pool of packet buffers, so that 
+// sending and receiving don't have to allocate them over and over.
+
+class PacketPool {
+  public:
+    PacketPool();		// Initialize an empty pool
+    ~PacketPool();		// De-allocate the pool, and the buffers in it
+
+    Packet *Alloc();		// Get a buffer; from the free list, if
+				// there are any on it
+    void Free(Packet *pkt);	// Put a buffer back on the free list
+
+  private:
+    Packet *freeList;		// Buffers not in use
+};
 
 
 // The following class defines a physical network device.  The network
@@ -68,17 +109,25 @@ class Network {
 				// dropped, and note that the "from" field of 
 				// the PacketHeader is filled in automatically 
 				// by Send().
+    void Send(Packet *pkt);	// Same, but for a packet already built in
+				// a packet buffer, with its header filled
+				// in; we take over the buffer
 
     PacketHeader Receive(char* data);
     				// Poll the network for incoming messages.  
 				// If there is a packet waiting, copy the 
-				// packet into "data" and return the header.
-				// If no packet is waiting, return a header 
-				// with length 0.
+				// oldest one into "data" and return the 
+				// header.  If no packet is waiting, return 
+				// a header with length 0.
+    Packet *ReceivePacket();	// Same, but hand over the packet buffer 
+				// itself; NULL if no packet is waiting
 
     void SendDone();		// Interrupt handler, called when message is 
 				// sent
-    void CheckPktAvail();	// Check if there is an incoming packet
+    void CheckPktAvail();	// Check for incoming packets, and read
+				// in as many as there's room for
+    void Deliver(Packet *pkt);	// Called by the fabric (cf. fabric.h), 
+				// when a packet arrives
 
   private:
     NetworkAddress ident;	// This machine's network address
@@ -94,8 +143,12 @@ class Network {
     bool sendBusy;		// Packet is being sent.
     bool packetAvail;		// Packet has arrived, can be pulled off of
 				//   network
-    PacketHeader inHdr;		// Information about arrived packet
-    char inbox[MaxPacketSize];  // Data for arrived packet
+    Packet *ring[NetworkRingSize];
+				// Arrived packets, oldest first, 
+    int ringHead;		//   starting at ringHead
+    int ringCount;
+    Packet *backlogHead;	// Packets the fabric delivered while the 
+    Packet *backlogTail;	//   ring was full, oldest first
 };
 
 #endif // NETWORK_H
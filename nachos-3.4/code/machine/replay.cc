@@ -0,0 +1,224 @@
+// replay.cc
+//	Routines to record the nondeterministic inputs to a run of Nachos,
+//	and to play them back.  See replay.h for what goes in the log.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+
+#include "copyright.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ReplayLog::ReplayLog
+// 	Open a log for recording or for replay.  The log starts with the
+//	random number seed, and whether random yields are on.
+//
+//	"name" -- UNIX file holding the log
+//	"record" -- TRUE to record, FALSE to replay
+//	"seed", "randomYield" -- saved in the log when recording; set from
+//	   it when replaying
+//----------------------------------------------------------------------
+
+ReplayLog::ReplayLog(char *name, bool record, unsigned *seed,
+							bool *randomYield)
+{
+    recording = record;
+    count = pos = 0;
+    lastTime = 0;
+    nextType = NoEvent;
+
+    if (recording) {
+	fd = OpenForWrite(name);
+	PutNumber(ReplayMagic);
+	PutNumber(*seed);
+	PutByte(*randomYield);
+    } else {
+	fd = OpenForReadWrite(name, TRUE);
+	ASSERT(GetNumber() == ReplayMagic);
+	*seed = GetNumber();
+	*randomYield = (GetByte() > 0);
+	ReadNextEvent();
+    }
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::~ReplayLog
+// 	Finish up.  When recording, write out the rest of the log.
+//----------------------------------------------------------------------
+
+ReplayLog::~ReplayLog()
+{
+    if (recording && count > 0)
+	WriteFile(fd, buffer, count);
+    Close(fd);
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::PutByte, ReplayLog::GetByte
+// 	Add a byte to the log, or take the next one from it, a buffer
+//	full at a time.  GetByte returns -1 at the end of the log.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::PutByte(int b)
+{
+    if (count == ReplayBufferSize) {
+	WriteFile(fd, buffer, count);
+	count = 0;
+    }
+    buffer[count++] = (char) b;
+}
+
+int
+ReplayLog::GetByte()
+{
+    if (pos == count) {
+	count = ReadPartial(fd, buffer, ReplayBufferSize);
+	pos = 0;
+	if (count <= 0) {
+	    count = 0;
+	    return -1;
+	}
+    }
+    return (unsigned char) buffer[pos++];
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::PutNumber, ReplayLog::GetNumber
+// 	Add a number to the log, or take one from it: 7 bits to a byte,
+//	low bits first, with the top bit set in every byte but the last.
+//	Most times between events fit in one or two bytes.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::PutNumber(unsigned n)
+{
+    while (n >= 0x80) {
+	PutByte((n & 0x7f) | 0x80);
+	n >>= 7;
+    }
+    PutByte(n);
+}
+
+unsigned
+ReplayLog::GetNumber()
+{
+    unsigned n = 0;
+    int b, shift = 0;
+
+    do {
+	b = GetByte();
+	if (b < 0)
+	    return 0;			// cut short; the caller will see
+					// the end of the log next
+	n |= (unsigned) (b & 0x7f) << shift;
+	shift += 7;
+    } while (b & 0x80);
+    return n;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::StartEvent
+// 	Log the kind of an event, and how long after the last one it
+//	happened.  Its data follows.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::StartEvent(ReplayEventType type)
+{
+    PutByte(type);
+    PutNumber(stats->totalTicks - lastTime);
+    lastTime = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::ReadNextEvent
+// 	Read the kind and time of the next event in the log, leaving its
+//	data to be read when it is played back.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::ReadNextEvent()
+{
+    int type = GetByte();
+
+    if (type < 0) {			// end of the log
+	nextType = NoEvent;
+	return;
+    }
+    nextType = (ReplayEventType) type;
+    nextTime = lastTime + GetNumber();
+    lastTime = nextTime;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::IsNext
+// 	Return TRUE if the next event in the log is of kind "type", and
+//	happened now.  If it should have been played back already, the
+//	replay no longer matches the run that was recorded; give up.
+//----------------------------------------------------------------------
+
+bool
+ReplayLog::IsNext(ReplayEventType type)
+{
+    if (nextType == NoEvent)
+	return FALSE;
+    if (nextTime < stats->totalTicks) {
+	printf("Replay diverged from the log at time %d\n",
+						stats->totalTicks);
+	ASSERT(FALSE);
+    }
+    return (nextType == type) && (nextTime == stats->totalTicks);
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::RecordChar, ReplayLog::ReplayChar
+// 	Log a character read from the console; or play back the one read
+//	now, if there was one.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::RecordChar(char ch)
+{
+    StartEvent(ConsoleEvent);
+    PutByte(ch);
+}
+
+bool
+ReplayLog::ReplayChar(char *ch)
+{
+    if (!IsNext(ConsoleEvent))
+	return FALSE;
+    *ch = (char) GetByte();
+    ReadNextEvent();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::RecordPacket, ReplayLog::ReplayPacket
+// 	Log a packet read from the network (only the bytes that matter,
+//	not the padding); or play back the next one read now, if any.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::RecordPacket(char *data, int length)
+{
+    StartEvent(PacketEvent);
+    PutNumber(length);
+    for (int i = 0; i < length; i++)
+	PutByte(data[i]);
+}
+
+bool
+ReplayLog::ReplayPacket(char *data, int maxLength)
+{
+    int length, i;
+
+    if (!IsNext(PacketEvent))
+	return FALSE;
+    length = GetNumber();
+    ASSERT(length <= maxLength);
+    for (i = 0; i < length; i++)
+	data[i] = (char) GetByte();
+    ReadNextEvent();
+    return TRUE;
+}
@@ -0,0 +1,83 @@
+// replay.h
+//	Data structures for recording the inputs that make one run of
+//	Nachos differ from the next, and for playing them back, so that a
+//	run can be reproduced tick for tick (-record and -replay).
+//
+//	Everything else Nachos does follows from these inputs and the
+//	simulated time, so the log only holds:
+//	   the random number seed, and whether -rs was given -- the
+//		random numbers (including the timer's) all follow from
+//		the seed, so they aren't logged one by one
+//	   each character read from the console, and the time it was read
+//	   each packet read from the network socket, and the time
+//
+//	Each event is a byte for its kind, the ticks since the event
+//	before (in as few bytes as it takes), and its data.  Events are
+//	only logged when a device's polling routine takes in input --
+//	never on a plain tick -- and are buffered, so recording costs next
+//	to nothing while user code runs.
+//
+//	On replay, the console and the network take their input from the
+//	log instead of from UNIX: each time a device polls, it gets
+//	whatever was logged at that time.  Packets a replayed Nachos sends
+//	go nowhere; whatever came back the first time is in the log.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+
+#include "copyright.h"
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#define ReplayMagic		0x4e524c47	// "NRLG"
+#define ReplayBufferSize	65536		// bytes of log read or
+						// written at a time
+
+// The kinds of events in the log.
+enum ReplayEventType { NoEvent, ConsoleEvent, PacketEvent };
+
+// The following class defines a log being recorded or played back.
+
+class ReplayLog {
+  public:
+    ReplayLog(char *name, bool record, unsigned *seed, bool *randomYield);
+				// Start recording to "name", saving the
+				// random seed and whether -rs was given; or
+				// start replaying "name", setting them
+    ~ReplayLog();		// Write out whatever is still buffered
+
+    bool IsReplaying() { return !recording; }
+
+    void RecordChar(char ch);	// Log a character read from the console
+    void RecordPacket(char *data, int length);
+				// Log a packet read from the network
+
+    bool ReplayChar(char *ch);	// Play back the character read from the
+				// console now; FALSE if there wasn't one
+    bool ReplayPacket(char *data, int maxLength);
+				// Likewise, the next packet read now
+
+  private:
+    bool recording;		// Recording, or replaying?
+    int fd;			// UNIX file holding the log
+    char buffer[ReplayBufferSize];
+    int count;			// Bytes in the buffer
+    int pos;			// When replaying, the next byte to use
+    int lastTime;		// Time of the last event
+
+    ReplayEventType nextType;	// When replaying, the next event --
+    int nextTime;		//   already read, but not yet played back
+
+    void PutByte(int b);	// Add a byte to the log
+    int GetByte();		// Next byte of the log; -1 at the end
+    void PutNumber(unsigned n);	// Add a number, 7 bits per byte
+    unsigned GetNumber();
+
+    void StartEvent(ReplayEventType type);
+				// Log the kind and time of an event
+    void ReadNextEvent();	// Read the kind and time of the next one
+    bool IsNext(ReplayEventType type);
+				// Is an event of this kind logged now?
+};
+
+#endif // REPLAY_H
@@ -10,6 +10,25 @@
 #include "copyright.h"
 #include "utility.h"
 #include "stats.h"
+#ifdef USER_PROGRAM
+#include "machine.h"
+#include "mipssim.h"
+#include "syscall.h"
+
+// Names for the histograms.  An opcode's name is the start of its
+// entry in opStrings (cf. mipssim.h), up to the first space.
+
+#define OpcodeNameSize	16	// longest opcode name, plus one
+
+static char *syscallNames[] = { "Halt", "Exit", "Exec", "Join", "Create",
+	"Open", "Read", "Write", "Close", "Fork", "Yield", "Seek",
+	"GetUsage" };
+#define NumSyscallNames	(int) (sizeof(syscallNames) / sizeof(char *))
+
+static char *exceptionNames[] = { "none", "syscall", "page fault",
+	"read-only", "bus error", "address error", "overflow",
+	"illegal instruction" };
+#endif
 
 //----------------------------------------------------------------------
 // Statistics::Statistics
@@ -19,9 +38,48 @@
 Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
-    numDiskReads = numDiskWrites = 0;
-    numConsoleCharsRead = numConsoleCharsWritten = 0;
+    numDiskReads = numDiskWrites = numDiskSeeks = numTrackBufferHits = 0;
+    numConsoleCharsRead = numConsoleCharsWritten = numConsoleWrites = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPacketBuffers = numPayloadCopies = 0;
+
+    histograms = FALSE;
+    for (int i = 0; i < NumOpcodeCounts; i++)
+	opcodeCounts[i] = 0;
+    numBranchesTaken = numBranchesNotTaken = 0;
+    for (int i = 0; i < NumSyscallCounts; i++)
+	syscallCounts[i] = 0;
+    for (int i = 0; i < NumExceptionCounts; i++)
+	exceptionCounts[i] = 0;
+    pageAccesses = NULL;
+    numPages = 0;
+    csvName = NULL;
+}
+
+//----------------------------------------------------------------------
+// Statistics::KeepHistograms
+// 	Start keeping histograms of what user programs do, as well as
+//	the counts.
+//
+//	"pages" -- how many pages of main memory there are
+//	"fileName" -- where to write the histograms, as CSV, when Nachos
+//		halts; NULL to print them with everything else
+//----------------------------------------------------------------------
+
+void
+Statistics::KeepHistograms(int pages, char *fileName)
+{
+#ifdef USER_PROGRAM
+    ASSERT((MaxOpcode < NumOpcodeCounts)
+		&& (NumExceptionTypes <= NumExceptionCounts)
+		&& (NumSyscallNames < NumSyscallCounts));
+#endif
+    histograms = TRUE;
+    numPages = pages;
+    pageAccesses = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+	pageAccesses[i] = 0;
+    csvName = fileName;
 }
 
 //----------------------------------------------------------------------
@@ -35,10 +93,156 @@ Statistics::Print()
 {
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
-    printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
-    printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
-	numConsoleCharsWritten);
+    printf("Disk I/O: reads %d, writes %d, seeks %d, track buffer hits %d\n",
+	numDiskReads, numDiskWrites, numDiskSeeks, numTrackBufferHits);
+    printf("Console I/O: reads %d, writes %d (in %d bursts)\n", 
+	numConsoleCharsRead, numConsoleCharsWritten, numConsoleWrites);
     printf("Paging: faults %d\n", numPageFaults);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    printf("Network buffers: allocated %d, payload copies %d\n", 
+	numPacketBuffers, numPayloadCopies);
+    if (histograms && (csvName != NULL))
+	WriteHistograms();
+    else if (histograms)
+	PrintHistograms();
+}
+
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// OpcodeName
+// 	Return the name of opcode "op", in "name" (OpcodeNameSize long).
+//----------------------------------------------------------------------
+
+static char *
+OpcodeName(int op, char *name)
+{
+    char *s = opStrings[op].string;
+    int i;
+
+    for (i = 0; (s[i] != '\0') && (s[i] != ' ') && (i < OpcodeNameSize - 1);
+									i++)
+	name[i] = s[i];
+    name[i] = '\0';
+    return name;
+}
+
+//----------------------------------------------------------------------
+// Loads, Stores
+// 	Return how many of the instructions counted were loads, or stores.
+//----------------------------------------------------------------------
+
+static int
+Loads(int *counts)
+{
+    return counts[OP_LB] + counts[OP_LBU] + counts[OP_LH] + counts[OP_LHU]
+	+ counts[OP_LW] + counts[OP_LWL] + counts[OP_LWR];
+}
+
+static int
+Stores(int *counts)
+{
+    return counts[OP_SB] + counts[OP_SH] + counts[OP_SW] + counts[OP_SWL]
+	+ counts[OP_SWR];
+}
+#endif
+
+//----------------------------------------------------------------------
+// Statistics::PrintHistograms
+// 	Print the histograms: the opcodes, busiest first, with the share
+//	of all the instructions each had; then the loads and stores, the
+//	branches, the system calls and exceptions that happened, and the
+//	pages that were touched.
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintHistograms()
+{
+#ifdef USER_PROGRAM
+    int order[NumOpcodeCounts];
+    int i, j, op, total = 0, n;
+    char name[OpcodeNameSize];
+
+    for (i = 0; i < NumOpcodeCounts; i++) {	// busiest first
+	total += opcodeCounts[i];
+	for (j = i; (j > 0) && (opcodeCounts[order[j - 1]] < opcodeCounts[i]);
+									j--)
+	    order[j] = order[j - 1];
+	order[j] = i;
+    }
+    printf("Instructions: %d\n", total);
+    for (i = 0, n = 0; (i < NumOpcodeCounts) && (opcodeCounts[order[i]] > 0);
+								i++) {
+	op = order[i];
+	printf("  %-8s %9d %5.1f%%%s", OpcodeName(op, name),
+		opcodeCounts[op], 100.0 * opcodeCounts[op] / total,
+		(++n % 3 == 0) ? "\n" : "   ");
+    }
+    if (n % 3 != 0)
+	printf("\n");
+    printf("Memory: loads %d, stores %d\n", Loads(opcodeCounts),
+						Stores(opcodeCounts));
+    printf("Branches: taken %d, not taken %d\n", numBranchesTaken,
+						numBranchesNotTaken);
+    printf("System calls:");
+    for (i = 0; i < NumSyscallCounts; i++)
+	if (syscallCounts[i] > 0) {
+	    if (i < NumSyscallNames)
+		printf(" %s %d", syscallNames[i], syscallCounts[i]);
+	    else
+		printf(" #%d%s %d", i, (i == NumSyscallCounts - 1) ? "+" : "",
+							syscallCounts[i]);
+	}
+    printf("\nExceptions:");
+    for (i = 0; i < NumExceptionTypes; i++)
+	if (exceptionCounts[i] > 0)
+	    printf(" %s %d", exceptionNames[i], exceptionCounts[i]);
+    printf("\nMemory accesses, by physical page:\n");
+    for (i = 0, n = 0; i < numPages; i++)
+	if (pageAccesses[i] > 0)
+	    printf("  %5d: %9d%s", i, pageAccesses[i],
+					(++n % 5 == 0) ? "\n" : "");
+    if (n % 5 != 0)
+	printf("\n");
+#endif
+}
+
+//----------------------------------------------------------------------
+// Statistics::WriteHistograms
+// 	Write the histograms to csvName, one count to a line, as
+//	"histogram,name,count" -- e.g. "opcode,ADDIU,1234", "page,7,890".
+//	Every opcode and page is there, even those with no count.
+//----------------------------------------------------------------------
+
+void
+Statistics::WriteHistograms()
+{
+#ifdef USER_PROGRAM
+    FILE *f = fopen(csvName, "w");
+    char name[OpcodeNameSize];
+    int i;
+
+    if (f == NULL) {
+	printf("Unable to write histograms to %s\n", csvName);
+	return;
+    }
+    fprintf(f, "histogram,name,count\n");
+    for (i = 1; i <= MaxOpcode; i++)
+	fprintf(f, "opcode,%s,%d\n", OpcodeName(i, name), opcodeCounts[i]);
+    fprintf(f, "memory,loads,%d\n", Loads(opcodeCounts));
+    fprintf(f, "memory,stores,%d\n", Stores(opcodeCounts));
+    fprintf(f, "branch,taken,%d\n", numBranchesTaken);
+    fprintf(f, "branch,not taken,%d\n", numBranchesNotTaken);
+    for (i = 0; i < NumSyscallCounts; i++)
+	if (i < NumSyscallNames)
+	    fprintf(f, "syscall,%s,%d\n", syscallNames[i], syscallCounts[i]);
+	else if (syscallCounts[i] > 0)
+	    fprintf(f, "syscall,%d,%d\n", i, syscallCounts[i]);
+    for (i = 0; i < NumExceptionTypes; i++)
+	fprintf(f, "exception,%s,%d\n", exceptionNames[i], exceptionCounts[i]);
+    for (i = 0; i < numPages; i++)
+	fprintf(f, "page,%d,%d\n", i, pageAccesses[i]);
+    fclose(f);
+    printf("Histograms written to %s\n", csvName);
+#endif
 }
@@ -13,10 +13,23 @@
 
 #include "copyright.h"
 
+#define NumOpcodeCounts		64	// MaxOpcode + 1 (cf. mipssim.h)
+#define NumSyscallCounts	32	// syscall numbers counted; the rest
+					// are counted as the last
+#define NumExceptionCounts	8	// NumExceptionTypes (cf. machine.h)
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
 //
+// With -hist (or -histcsv), it also keeps histograms of what user
+// programs do: the instructions they run, by opcode (which also gives
+// loads and stores); how often their conditional branches are taken;
+// their system calls, by number, and exceptions, by type; and how
+// often each page of main memory is touched by user instructions
+// (fetches, loads and stores).  Instructions are counted as userTicks
+// counts them: one that faults is counted again when it is retried.
+//
 // The fields in this class are public to make it easier to update.
 
 class Statistics {
@@ -30,15 +43,49 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskSeeks;		// number of disk requests that had to
+				// move the head to another track
+    int numTrackBufferHits;	// number of disk reads the track buffer
+				// served, without waiting for the disk
+				// to come round
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
+    int numConsoleWrites;	// number of writes to the display (each
+				// of one or more characters)
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numPacketBuffers;	// number of packet buffers allocated
+    int numPayloadCopies;	// number of times network data was copied
+
+    bool histograms;		// keeping the histograms below?
+    int opcodeCounts[NumOpcodeCounts];	// user instructions, by opcode
+    int numBranchesTaken;	// conditional branches that were taken,
+    int numBranchesNotTaken;	//   and that weren't
+    int syscallCounts[NumSyscallCounts];	// system calls, by number
+    int exceptionCounts[NumExceptionCounts];	// exceptions, by type
+    int *pageAccesses;		// user memory accesses, by physical page
+    int numPages;		//   (there are this many)
+    char *csvName;		// file to write them to, or NULL to print
 
     Statistics(); 		// initialize everything to zero
+				// (no destructor: checkpoints copy
+				// Statistics, cf. checkpoint.h)
+
+    void KeepHistograms(int pages, char *fileName);
+				// start keeping histograms, for "pages"
+				// pages of memory; write them to
+				// "fileName" if not NULL
+    void CountSyscall(int type) {	// a system call of type "type"
+	syscallCounts[((unsigned int) type < NumSyscallCounts) ? type
+						: NumSyscallCounts - 1]++;
+    }
 
     void Print();		// print collected statistics
+
+  private:
+    void PrintHistograms();	// print the histograms,
+    void WriteHistograms();	// or write them out as CSV
 };
 
 // Constants used to reflect the relative time an operation would
@@ -54,6 +101,8 @@ class Statistics {
 #define RotationTime 	500 	// time disk takes to rotate one sector
 #define SeekTime 	500    	// time disk takes to seek past one track
 #define ConsoleTime 	100	// time to read or write one character
+#define ConsoleByteTime	1	// time for each further character written
+				// in the same burst
 #define NetworkTime 	100   	// time to send or receive one packet
 #define TimerTicks 	100    	// (average) time between timer interrupts
 
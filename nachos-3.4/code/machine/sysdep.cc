@@ -36,6 +36,11 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <errno.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 #ifdef HOST_i386
 #include <unistd.h>
 #include <sys/time.h>
@@ -107,13 +112,8 @@ void abort();
 //	characters that can be read immediately.  If so, read them
 //	in, and return TRUE.
 //
-//	In the network case, if there are no threads for us to run,
-//	and no characters to be read,
-//	we need to give the other side a chance to get our host's CPU
-//	(otherwise, we'll go really slowly, since UNIX time-slices
-//	infrequently, and this would be like busy-waiting).  So we
-//	delay for a short fixed time, before allowing ourselves to be
-//	re-scheduled (sort of like a Yield, but cast in terms of UNIX).
+//	This never waits; when there are no threads for us to run,
+//	Interrupt::Idle waits for input with WaitForInput instead.
 //
 //	"fd" -- the file descriptor of the file to be polled
 //----------------------------------------------------------------------
@@ -124,12 +124,8 @@ PollFile(int fd)
     int rfd = (1 << fd), wfd = 0, xfd = 0, retVal;
     struct timeval pollTime;
 
-// decide how long to wait if there are no characters on the file
     pollTime.tv_sec = 0;
-    if (interrupt->getStatus() == IdleMode)
-        pollTime.tv_usec = 20000;              	// delay to let other nachos run
-    else
-        pollTime.tv_usec = 0;                 	// no delay
+    pollTime.tv_usec = 0;                 	// no delay
 
 // poll file or socket
 #if (defined(HOST_i386) || defined(HOST_SPARC)) 
@@ -144,6 +140,105 @@ PollFile(int fd)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// WatchFile, UnwatchFile, WaitForInput
+// 	Wait for input on any of the files and sockets the simulated 
+//	devices read from.  If there are no threads for us to run, and 
+//	nothing to read, we need to give the other side a chance to get 
+//	our host's CPU (otherwise, we'll go really slowly, since UNIX 
+//	time-slices infrequently, and this would be like busy-waiting).
+//	Rather than sleep for a fixed time, we block until something 
+//	arrives, or the time is up, whichever is first.
+//
+//	On Linux, the files are kept in an epoll set; elsewhere, we use
+//	select.  Ordinary files can't be waited for, but there is always
+//	something to read from them (or EOF), so we don't wait at all.
+//
+//	"fd" -- the file descriptor of the file to be watched
+//	"milliseconds" -- the longest to wait
+//----------------------------------------------------------------------
+
+#define MaxWatched	8
+
+static int watched[MaxWatched];		// files being watched
+static int numWatched = 0;
+static int numAlwaysReady = 0;		// # of them that are ordinary files
+#ifdef __linux__
+static int epollFd = -1;
+#endif
+
+void
+WatchFile(int fd)
+{
+    ASSERT(numWatched < MaxWatched);
+#ifdef __linux__
+    struct epoll_event event;
+
+    if (epollFd < 0) {
+	epollFd = epoll_create(MaxWatched);
+	ASSERT(epollFd >= 0);
+    }
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+	ASSERT(errno == EPERM);			// an ordinary file
+	numAlwaysReady++;
+	return;
+    }
+#else
+    if (lseek(fd, 0, SEEK_CUR) >= 0) {		// seekable: an ordinary file
+	numAlwaysReady++;
+	return;
+    }
+#endif
+    watched[numWatched++] = fd;
+}
+
+void
+UnwatchFile(int fd)
+{
+    int i;
+
+    for (i = 0; i < numWatched && watched[i] != fd; i++)
+	;
+    if (i == numWatched) {			// was an ordinary file
+	ASSERT(numAlwaysReady > 0);
+	numAlwaysReady--;
+	return;
+    }
+    watched[i] = watched[--numWatched];
+#ifdef __linux__
+    (void) epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+}
+
+bool
+WaitForInput(int milliseconds)
+{
+    if (numAlwaysReady > 0)
+	return TRUE;
+    if (numWatched == 0)
+	return FALSE;
+#ifdef __linux__
+    struct epoll_event events[MaxWatched];
+
+    return (epoll_wait(epollFd, events, MaxWatched, milliseconds) > 0);
+#else
+    fd_set rfds;
+    struct timeval waitTime;
+    int i, maxFd = 0;
+
+    FD_ZERO(&rfds);
+    for (i = 0; i < numWatched; i++) {
+	FD_SET(watched[i], &rfds);
+	maxFd = max(maxFd, watched[i]);
+    }
+    waitTime.tv_sec = 0;
+    waitTime.tv_usec = milliseconds * 1000;
+    return (select(maxFd + 1, &rfds, NULL, NULL, &waitTime) > 0);
+#endif
+}
+
 //----------------------------------------------------------------------
 // OpenForWrite
 // 	Open a file for writing.  Create it if it doesn't exist; truncate it 
@@ -375,6 +470,48 @@ ReadFromSocket(int sockID, char *buffer, int packetSize)
     ASSERT(retVal == packetSize);
 }
 
+//----------------------------------------------------------------------
+// ReadPacketsFromSocket
+// 	Read as many fixed size packets as are waiting on the IPC port,
+//	up to "maxPackets", one into each of "buffers".  Never
+//	waits; returns the number read.  On Linux, one recvmmsg call 
+//	reads the whole batch.
+//----------------------------------------------------------------------
+
+#define MaxPacketBatch	32
+
+int
+ReadPacketsFromSocket(int sockID, char **buffers, int packetSize, int maxPackets)
+{
+    int n;
+
+#ifdef __linux__
+    struct mmsghdr msgs[MaxPacketBatch];
+    struct iovec iov[MaxPacketBatch];
+    int i;
+
+    maxPackets = min(maxPackets, MaxPacketBatch);
+    for (i = 0; i < maxPackets; i++) {
+	iov[i].iov_base = buffers[i];
+	iov[i].iov_len = packetSize;
+	memset(&msgs[i], 0, sizeof(struct mmsghdr));
+	msgs[i].msg_hdr.msg_iov = &iov[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    n = recvmmsg(sockID, msgs, maxPackets, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+	ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+	return 0;
+    }
+    for (i = 0; i < n; i++)
+	ASSERT((int) msgs[i].msg_len == packetSize);
+#else
+    for (n = 0; n < maxPackets && PollSocket(sockID); n++)
+	ReadFromSocket(sockID, buffers[n], packetSize);
+#endif
+    return n;
+}
+
 //----------------------------------------------------------------------
 // SendToSocket
 // 	Transmit a fixed size packet to another Nachos' IPC port.
@@ -463,6 +600,163 @@ Random()
     return rand();
 }
 
+//----------------------------------------------------------------------
+// MapFile
+// 	Map "length" bytes of an open file, starting at "offset", into
+//	memory, privately: the pages are read in when first touched, and
+//	writes to them go to private copies.  Abort on error.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int offset, int length)
+{
+    char *p = (char *) mmap(NULL, length, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE, fd, offset);
+
+    ASSERT(p != (char *) MAP_FAILED);
+    return p;
+}
+
+//----------------------------------------------------------------------
+// MapFileShared
+// 	Like MapFile, but writes to the memory go to the file (whenever
+//	the host gets round to it; cf. SyncMappedFile).
+//----------------------------------------------------------------------
+
+char *
+MapFileShared(int fd, int offset, int length)
+{
+    char *p = (char *) mmap(NULL, length, PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, offset);
+
+    ASSERT(p != (char *) MAP_FAILED);
+    return p;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Wait until "length" bytes at "p", in memory mapped by
+//	MapFileShared, have been written back to the file.  "p" need not
+//	be page aligned.
+//----------------------------------------------------------------------
+
+void
+SyncMappedFile(char *p, int length)
+{
+    long pageSize = getpagesize();
+    char *start = (char *) ((unsigned long) p & ~(pageSize - 1));
+
+    ASSERT(msync(start, length + (p - start), MS_SYNC) == 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *p, int length)
+{
+    munmap(p, length);
+}
+
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the host's wall-clock time, in seconds, for timing how
+//	long the simulation itself takes.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+// The host threads RunOnHostThreads hands work to.  They are started
+// as they are first needed, and then wait for more work.
+
+static pthread_mutex_t hostLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hostWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t hostDone = PTHREAD_COND_INITIALIZER;
+static int hostThreads = 0;		// host threads started so far
+static VoidFunctionPtr hostFunc;	// what to call,
+static int hostNext = 0, hostCount = 0;	// with which arguments
+static int hostLeft = 0;		// calls not yet finished
+
+//----------------------------------------------------------------------
+// HostWork
+// 	Make calls to hostFunc, with the arguments no one has taken yet,
+//	until there are none left.  Called with hostLock held, and
+//	returns with it held.
+//----------------------------------------------------------------------
+
+static void
+HostWork()
+{
+    int arg;
+
+    while (hostNext < hostCount) {
+	arg = hostNext++;
+	pthread_mutex_unlock(&hostLock);
+	(*hostFunc)(arg);
+	pthread_mutex_lock(&hostLock);
+	if (--hostLeft == 0)
+	    pthread_cond_signal(&hostDone);
+    }
+}
+
+//----------------------------------------------------------------------
+// HostThread
+// 	What each of RunOnHostThreads' host threads runs: wait for work,
+//	and do it, forever.
+//----------------------------------------------------------------------
+
+static void *
+HostThread(void *arg)
+{
+    pthread_mutex_lock(&hostLock);
+    for (;;) {
+	while (hostNext >= hostCount)
+	    pthread_cond_wait(&hostWork, &hostLock);
+	HostWork();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// RunOnHostThreads
+// 	Call "func" with each of 0 .. n-1 as its argument, on as many
+//	host threads at once, and return when all the calls have.  The
+//	caller makes some of the calls itself.
+//
+//	"func" must not touch anything the other calls might, since
+//	nothing stops them running at the same time.
+//----------------------------------------------------------------------
+
+void
+RunOnHostThreads(VoidFunctionPtr func, int n)
+{
+    pthread_t thread;
+
+    pthread_mutex_lock(&hostLock);
+    for (; hostThreads < n - 1; hostThreads++) {
+	ASSERT(pthread_create(&thread, NULL, HostThread, NULL) == 0);
+	pthread_detach(thread);
+    }
+    hostFunc = func;
+    hostNext = 0;
+    hostCount = n;
+    hostLeft = n;
+    pthread_cond_broadcast(&hostWork);
+    HostWork();
+    while (hostLeft > 0)
+	pthread_cond_wait(&hostDone, &hostLock);
+    pthread_mutex_unlock(&hostLock);
+}
+
 //----------------------------------------------------------------------
 // AllocBoundedArray
 // 	Return an array, with the two pages just before 
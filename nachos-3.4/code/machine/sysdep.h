@@ -17,6 +17,14 @@
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
+// Keep track of the files and sockets that simulated devices read from,
+// so that an idle Nachos can wait for input on any of them, instead of
+// spinning.  WaitForInput returns TRUE if there is something to read,
+// waiting at most "milliseconds" for it.
+extern void WatchFile(int fd);
+extern void UnwatchFile(int fd);
+extern bool WaitForInput(int milliseconds);
+
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
 extern int OpenForWrite(char *name);
@@ -29,6 +37,25 @@ extern int Tell(int fd);
 extern void Close(int fd);
 extern bool Unlink(char *name);
 
+// Map part of an open file into memory, copy-on-write: each page is
+// read in from the file the first time it is touched, and changes to
+// it are never written back.  "offset" must be a multiple of the host
+// page size.
+extern char *MapFile(int fd, int offset, int length);
+extern void UnmapFile(char *p, int length);
+
+// Likewise, but shared: changes go back to the file.  SyncMappedFile
+// waits until they have.
+extern char *MapFileShared(int fd, int offset, int length);
+extern void SyncMappedFile(char *p, int length);
+
+// Host wall-clock time, in seconds, for timing the simulation itself.
+extern double HostTime();
+
+// Call a function, with each of 0 .. n-1 as its argument, on as many
+// host threads at once; return when all the calls have.
+extern void RunOnHostThreads(VoidFunctionPtr func, int n);
+
 // Interprocess communication operations, for simulating the network
 extern int OpenSocket();
 extern void CloseSocket(int sockID);
@@ -36,6 +63,8 @@ extern void AssignNameToSocket(char *socketName, int sockID);
 extern void DeAssignNameToSocket(char *socketName);
 extern bool PollSocket(int sockID);
 extern void ReadFromSocket(int sockID, char *buffer, int packetSize);
+extern int ReadPacketsFromSocket(int sockID, char **buffers, int packetSize,
+							int maxPackets);
 extern void SendToSocket(int sockID, char *buffer, int packetSize,char *toName);
 
 // Process control: abort, exit, and sleep
@@ -95,22 +95,24 @@ Machine::ReadMem(int addr, int size, int *value)
     
     exception = Translate(addr, &physicalAddress, size, FALSE);
     if (exception != NoException) {
-	machine->RaiseException(exception, addr);
+	RaiseException(exception, addr);
 	return FALSE;
     }
+    if (stats->histograms)
+	stats->pageAccesses[physicalAddress / PageSize]++;
     switch (size) {
       case 1:
-	data = machine->mainMemory[physicalAddress];
+	data = mainMemory[physicalAddress];
 	*value = data;
 	break;
 	
       case 2:
-	data = *(unsigned short *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned short *) &mainMemory[physicalAddress];
 	*value = ShortToHost(data);
 	break;
 	
       case 4:
-	data = *(unsigned int *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned int *) &mainMemory[physicalAddress];
 	*value = WordToHost(data);
 	break;
 
@@ -144,21 +146,23 @@ Machine::WriteMem(int addr, int size, int value)
 
     exception = Translate(addr, &physicalAddress, size, TRUE);
     if (exception != NoException) {
-	machine->RaiseException(exception, addr);
+	RaiseException(exception, addr);
 	return FALSE;
     }
+    if (stats->histograms)
+	stats->pageAccesses[physicalAddress / PageSize]++;
     switch (size) {
       case 1:
-	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
+	mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
 	break;
 
       case 2:
-	*(unsigned short *) &machine->mainMemory[physicalAddress]
+	*(unsigned short *) &mainMemory[physicalAddress]
 		= ShortToMachine((unsigned short) (value & 0xffff));
 	break;
       
       case 4:
-	*(unsigned int *) &machine->mainMemory[physicalAddress]
+	*(unsigned int *) &mainMemory[physicalAddress]
 		= WordToMachine((unsigned int) value);
 	break;
 	
@@ -241,8 +245,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
-	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
+    if (pageFrame >= (unsigned) numPhysPages) { 
+	DEBUG('a', "*** frame %d > %d!\n", pageFrame, numPhysPages);
 	return BusErrorException;
     }
     entry->use = TRUE;		// set the use, dirty bits
@@ -12,6 +12,35 @@
 //	     implementation.  The Post Office won't work without
 //	     a correct implementation of condition variables.
 //
+//	TransportTest measures a bulk transfer over a reliable connection
+//	(cf. transport.h).  To see how it copes with loss, run it at 
+//	several reliabilities, e.g.:
+//		for l in 1 0.95 0.9 0.8; do
+//		    ./nachos -m 0 -l $l -tr 1 8 > log0 &
+//		    ./nachos -m 1 -l $l -tr 0 8 > log1; wait
+//		done
+//
+//	MessageTest measures sending messages much bigger than a packet,
+//	which the Post Office splits into fragments.  Since losing any
+//	fragment loses the message, it needs a reliable network (the 
+//	default).  To see what a bigger MTU buys, build with, e.g., 
+//	-DMaxWireSize=1024 added to DEFINES, and run:
+//		./nachos -m 0 -tm 1 > log0 &
+//		./nachos -m 1 -tm 0 > log1; wait
+//
+//	PingPongTest bounces small messages back and forth, and counts the
+//	packet buffers allocated and the copies made of the data along the
+//	way.  It too needs a reliable network.
+//
+//	FabricTest runs MailTest between every pair of a whole network of
+//	machines, simulated in one Nachos (cf. machine/fabric.h):
+//		./nachos -nodes 64 -tf
+//
+//	RpcTest measures remote procedure calls (cf. rpc.h), with more and
+//	more client threads calling at once:
+//		./nachos -m 0 -trpc 1 16 > log0 &
+//		./nachos -m 1 -trpc 0 16 > log1; wait
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -21,6 +50,9 @@
 #include "system.h"
 #include "network.h"
 #include "post.h"
+#include "transport.h"
+#include "fabric.h"
+#include "rpc.h"
 #include "interrupt.h"
 
 // Test out message delivery, by doing the following:
@@ -70,3 +102,422 @@ MailTest(int farAddr)
     // Then we're done!
     interrupt->Halt();
 }
+
+// Bulk transfer test: the machine with the lower address sends
+// TransportBytes to the other over a reliable connection between their
+// mailboxes TransportBox, and each reports how long it took.  Neither
+// halts right away: the other end may still be resending data (or ACKs
+// to it) that it doesn't know got through.
+
+#define TransportBytes	16384
+#define TransportBox	2
+#define LingerTime	(1000 * NetworkTime)
+
+static void
+PauseDone(int arg)
+{
+    Semaphore *done = (Semaphore *) arg;
+
+    done->V();
+}
+
+static void
+Pause(int ticks)
+{
+    Semaphore *done = new Semaphore("pause", 0);
+
+    interrupt->Schedule(PauseDone, (int) done, ticks, NetworkRecvInt);
+    done->P();
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// TransportTest
+// 	Transfer TransportBytes from the lower numbered machine to the
+//	other, with at most "window" messages outstanding, and print the
+//	goodput (data delivered per million ticks) and the work the
+//	connection did to get it there.
+//
+//	"farAddr" -- the other machine
+//	"window" -- size of the sliding window
+//----------------------------------------------------------------------
+
+void
+TransportTest(int farAddr, int window)
+{
+    Connection *conn = new Connection(TransportBox, farAddr, TransportBox,
+								window);
+    char buffer[MaxSegmentSize];
+    int start = stats->totalTicks, done, n, i, ticks;
+
+    if (postOffice->Address() < farAddr) {
+	printf("Sending %d bytes to %d, window %d\n", TransportBytes,
+							farAddr, window);
+	for (done = 0; done < TransportBytes; done += n) {
+	    n = min(TransportBytes - done, (int) MaxSegmentSize);
+	    for (i = 0; i < n; i++)
+		buffer[i] = (char) (done + i);
+	    conn->Send(buffer, n);
+	}
+	conn->Flush();
+    } else {
+	printf("Receiving %d bytes from %d, window %d\n", TransportBytes,
+							farAddr, window);
+	for (done = 0; done < TransportBytes; done += n) {
+	    n = conn->Receive(buffer);
+	    for (i = 0; i < n; i++)
+		if (buffer[i] != (char) (done + i)) {
+		    printf("Transport test: bad data at byte %d\n", done + i);
+		    interrupt->Halt();
+		}
+	}
+    }
+    ticks = stats->totalTicks - start;
+    printf("%d bytes in %d ticks: %d bytes per million ticks\n", done, ticks,
+				(int) (done * 1000000.0 / ticks));
+    conn->PrintStats();
+    fflush(stdout);
+
+    Pause(LingerTime);
+    interrupt->Halt();
+}
+
+// Large message test: the machine with the lower address sends 
+// MessageCount messages of each size in messageSizes to the other's 
+// mailbox MessageBox, waiting for a short reply to each before sending
+// the next one.
+
+#define MessageBox	3
+#define MessageCount	2
+
+static int messageSizes[] = { 1024, 64 * 1024, MaxMessageSize };
+
+//----------------------------------------------------------------------
+// MessageTest
+// 	Send messages of 1KB, 64KB, and 1MB from the lower numbered machine
+//	to the other, and print, for each size, the throughput and how
+//	many packets it took.  The receiver checks every byte.
+//
+//	"farAddr" -- the other machine
+//----------------------------------------------------------------------
+
+void
+MessageTest(int farAddr)
+{
+    PacketHeader outPktHdr, inPktHdr;
+    MailHeader outMailHdr, inMailHdr;
+    char *buffer = new char[MaxMessageSize];
+    char *ack = "Got it!";
+    int numSizes = sizeof(messageSizes) / sizeof(int);
+    int s, m, i, size, start, packets, ticks;
+    bool sender = (postOffice->Address() < farAddr);
+
+    printf("%s messages, %d bytes per packet\n", 
+		sender ? "Sending" : "Receiving", (int) MaxMailSize);
+    for (s = 0; s < numSizes; s++) {
+	size = messageSizes[s];
+	start = stats->totalTicks;
+	packets = stats->numPacketsSent + stats->numPacketsRecvd;
+	for (m = 0; m < MessageCount; m++) {
+	    if (sender) {
+		for (i = 0; i < size; i++)
+		    buffer[i] = (char) (i * 7 + m);
+		outPktHdr.to = farAddr;
+		outMailHdr.to = MessageBox;
+		outMailHdr.from = MessageBox;
+		outMailHdr.length = size;
+		postOffice->Send(outPktHdr, outMailHdr, buffer);
+		postOffice->Receive(MessageBox, &inPktHdr, &inMailHdr, buffer);
+	    } else {
+		postOffice->Receive(MessageBox, &inPktHdr, &inMailHdr, buffer);
+		ASSERT((int) inMailHdr.length == size);
+		for (i = 0; i < size; i++)
+		    if (buffer[i] != (char) (i * 7 + m)) {
+			printf("Message test: bad data at byte %d\n", i);
+			interrupt->Halt();
+		    }
+		outPktHdr.to = inPktHdr.from;
+		outMailHdr.to = inMailHdr.from;
+		outMailHdr.from = MessageBox;
+		outMailHdr.length = strlen(ack) + 1;
+		postOffice->Send(outPktHdr, outMailHdr, ack);
+	    }
+	}
+	ticks = stats->totalTicks - start;
+	packets = stats->numPacketsSent + stats->numPacketsRecvd - packets;
+	printf("%d x %d bytes: %d ticks, %d packets, "
+		"%d bytes per million ticks\n", MessageCount, size, ticks,
+		packets, (int) (MessageCount * (double) size * 1000000.0 / ticks));
+    }
+    fflush(stdout);
+    delete [] buffer;
+    interrupt->Halt();
+}
+
+// Ping-pong test: the machine with the lower address sends PingPongCount
+// messages, one at a time, to the other's mailbox PingPongBox, and the
+// other sends each one straight back.
+
+#define PingPongCount	1000
+#define PingPongBox	4
+
+//----------------------------------------------------------------------
+// PingPongTest
+// 	Bounce PingPongCount single-packet messages off the other machine,
+//	and print the round trip time, and the packet buffers allocated 
+//	and copies of the data made on this machine, per message sent or
+//	received.
+//
+//	"farAddr" -- the other machine
+//----------------------------------------------------------------------
+
+void
+PingPongTest(int farAddr)
+{
+    PacketHeader outPktHdr, inPktHdr;
+    MailHeader outMailHdr, inMailHdr;
+    char buffer[MaxMailSize];
+    int start = stats->totalTicks;
+    int buffers = stats->numPacketBuffers;
+    int copies = stats->numPayloadCopies;
+    int i, ticks, messages = 2 * PingPongCount;
+    bool pinger = (postOffice->Address() < farAddr);
+
+    for (i = 0; i < (int) MaxMailSize; i++)
+	buffer[i] = (char) i;
+    outPktHdr.to = farAddr;
+    outMailHdr.to = PingPongBox;
+    outMailHdr.from = PingPongBox;
+    outMailHdr.length = MaxMailSize;
+    for (i = 0; i < PingPongCount; i++) {
+	if (pinger)
+	    postOffice->Send(outPktHdr, outMailHdr, buffer);
+	postOffice->Receive(PingPongBox, &inPktHdr, &inMailHdr, buffer);
+	ASSERT(inMailHdr.length == MaxMailSize);
+	if (!pinger)
+	    postOffice->Send(outPktHdr, outMailHdr, buffer);
+    }
+    ticks = stats->totalTicks - start;
+    buffers = stats->numPacketBuffers - buffers;
+    copies = stats->numPayloadCopies - copies;
+
+    printf("%d round trips of %d bytes: %d ticks per round trip\n", 
+		PingPongCount, (int) MaxMailSize, ticks / PingPongCount);
+    printf("Per message: %.3f buffers allocated, %.3f copies of the data\n",
+		(double) buffers / messages, (double) copies / messages);
+    fflush(stdout);
+    interrupt->Halt();
+}
+
+// Fabric test: every machine sends a message to mailbox 0 on every 
+// other machine, and acknowledges each message it gets, to mailbox 1 on
+// the sender.  The machines all run in this Nachos, each with its own
+// post office, and a thread that plays its part.
+
+static PostOffice **offices;		// each machine's post office
+static Semaphore *nodesDone;		// V'ed as each machine finishes
+
+//----------------------------------------------------------------------
+// FabricNode
+// 	Play one machine's part in the fabric test.
+//
+//	"addr" -- which machine
+//----------------------------------------------------------------------
+
+static void
+FabricNode(int addr)
+{
+    PostOffice *po = offices[addr];
+    int numNodes = fabric->NumNodes();
+    PacketHeader outPktHdr, inPktHdr;
+    MailHeader outMailHdr, inMailHdr;
+    char *data = "Hello there!";
+    char *ack = "Got it!";
+    char buffer[MaxMailSize];
+    int i;
+
+    outMailHdr.to = 0;
+    outMailHdr.from = 1;
+    outMailHdr.length = strlen(data) + 1;
+    for (i = 0; i < numNodes; i++)
+	if (i != addr) {
+	    outPktHdr.to = i;
+	    po->Send(outPktHdr, outMailHdr, data);
+	}
+
+    for (i = 0; i < numNodes - 1; i++) {
+	po->Receive(0, &inPktHdr, &inMailHdr, buffer);
+	ASSERT(!strcmp(buffer, data));
+	outPktHdr.to = inPktHdr.from;
+	outMailHdr.to = inMailHdr.from;
+	outMailHdr.length = strlen(ack) + 1;
+	po->Send(outPktHdr, outMailHdr, ack);
+    }
+
+    for (i = 0; i < numNodes - 1; i++) {
+	po->Receive(1, &inPktHdr, &inMailHdr, buffer);
+	ASSERT(!strcmp(buffer, ack));
+    }
+    nodesDone->V();
+}
+
+//----------------------------------------------------------------------
+// FabricTest
+// 	Set up a post office for every machine on the fabric (besides
+//	ours, which Initialize already set up), run the fabric test on
+//	all of them at once, and print how long it took.  Since the run
+//	is deterministic, the tick count is the same every time, for the
+//	same random seed.
+//----------------------------------------------------------------------
+
+void
+FabricTest()
+{
+    int numNodes, i, messages;
+    Thread *t;
+
+    if (fabric == NULL) {
+	printf("The fabric test needs -nodes\n");
+	return;
+    }
+    numNodes = fabric->NumNodes();
+    ASSERT(postOffice->Address() < numNodes);
+    offices = new PostOffice *[numNodes];
+    for (i = 0; i < numNodes; i++)
+	if (i == postOffice->Address())
+	    offices[i] = postOffice;
+	else
+	    offices[i] = new PostOffice(i, 1, 10);
+    nodesDone = new Semaphore("nodes done", 0);
+
+    for (i = 0; i < numNodes; i++) {
+	t = new Thread("fabric node");
+	t->Fork(FabricNode, i);
+    }
+    for (i = 0; i < numNodes; i++)
+	nodesDone->P();
+
+    messages = 2 * numNodes * (numNodes - 1);
+    printf("%d machines exchanged %d messages in %d ticks\n", numNodes,
+					messages, stats->totalTicks);
+    fflush(stdout);
+    interrupt->Halt();
+}
+
+// RPC test: the machine with the higher address is the server, with
+// RpcWorkers worker threads; each call takes it RpcServiceTime to serve.
+// The other machine makes RpcTestCalls calls with one client thread,
+// then again with 2, 4, and so on up to the number asked for, and then
+// tells the server to quit.
+
+#define RpcServiceBox	5
+#define RpcReplyBox	6
+#define RpcWorkers	4
+#define RpcServiceTime	(2 * NetworkTime)
+#define RpcTestCalls	256
+
+enum { RpcAdd, RpcQuit };
+
+static Semaphore *rpcQuit;		// V'ed when the client says to quit
+static RpcClient *rpcClient;
+static Semaphore *rpcThreadDone;	// V'ed as each client thread finishes
+static int rpcLatency;			// Total ticks the calls took
+
+//----------------------------------------------------------------------
+// RpcTestHandler
+// 	Serve a call: RpcAdd adds up the integers it is given, after a
+//	while; RpcQuit tells the test to stop.
+//----------------------------------------------------------------------
+
+static int
+RpcTestHandler(int proc, char *args, int length, char *result)
+{
+    int sum = 0;
+
+    switch (proc) {
+      case RpcAdd:
+	for (int i = 0; i < length / (int) sizeof(int); i++)
+	    sum += ((int *) args)[i];
+	Pause(RpcServiceTime);
+	bcopy((char *) &sum, result, sizeof(int));
+	return sizeof(int);
+      case RpcQuit:
+	rpcQuit->V();
+	return 0;
+      default:
+	ASSERT(FALSE);
+	return 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// RpcTestThread
+// 	One client thread: make "calls" calls, one after another, checking
+//	each result, and add up how long they took.
+//----------------------------------------------------------------------
+
+static void
+RpcTestThread(int calls)
+{
+    int args[2], sum, start;
+
+    for (int i = 0; i < calls; i++) {
+	args[0] = i;
+	args[1] = 1000 * calls;
+	start = stats->totalTicks;
+	ASSERT(rpcClient->Call(RpcAdd, (char *) args, sizeof(args),
+					(char *) &sum) == sizeof(int));
+	ASSERT(sum == args[0] + args[1]);
+	rpcLatency += stats->totalTicks - start;
+    }
+    rpcThreadDone->V();
+}
+
+//----------------------------------------------------------------------
+// RpcTest
+// 	Run the RPC test, as the server or the client, and print, for
+//	each number of client threads, the average latency of a call and
+//	the throughput.
+//
+//	"farAddr" -- the other machine
+//	"maxThreads" -- most client threads to try
+//----------------------------------------------------------------------
+
+void
+RpcTest(int farAddr, int maxThreads)
+{
+    RpcServer *server;
+    int threads, i, start, ticks;
+    char result[MaxRpcData];
+
+    if (postOffice->Address() > farAddr) {
+	rpcQuit = new Semaphore("rpc quit", 0);
+	server = new RpcServer(RpcServiceBox, RpcWorkers, RpcTestHandler);
+	printf("Serving calls, with %d workers\n", RpcWorkers);
+	rpcQuit->P();
+	Pause(LingerTime);			// let the last reply out
+	server->PrintStats();
+	fflush(stdout);
+	interrupt->Halt();
+    }
+
+    rpcClient = new RpcClient(RpcReplyBox, farAddr, RpcServiceBox);
+    rpcThreadDone = new Semaphore("rpc thread done", 0);
+    for (threads = 1; threads <= maxThreads; threads *= 2) {
+	start = stats->totalTicks;
+	rpcLatency = 0;
+	for (i = 0; i < threads; i++)
+	    (new Thread("rpc client"))->Fork(RpcTestThread, 
+						RpcTestCalls / threads);
+	for (i = 0; i < threads; i++)
+	    rpcThreadDone->P();
+	ticks = stats->totalTicks - start;
+	printf("%d client threads: %d calls in %d ticks, latency %d ticks, "
+		"%d calls per million ticks\n", threads, RpcTestCalls, ticks,
+		rpcLatency / RpcTestCalls, 
+		(int) (RpcTestCalls * 1000000.0 / ticks));
+    }
+    rpcClient->Call(RpcQuit, NULL, 0, result);
+    fflush(stdout);
+    interrupt->Halt();
+}
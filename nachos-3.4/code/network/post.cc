@@ -12,12 +12,18 @@
 // 	The implementation synchronizes incoming messages with threads
 //	waiting for those messages.
 //
+//	Messages bigger than one packet are sent as a series of fragments,
+//	each with its own MailHeader saying which message it belongs to
+//	and where in the message it goes.  The receiving mailbox holds
+//	on to the fragments until it has all of them.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "post.h"
+#include "system.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
@@ -28,16 +34,50 @@
 //
 //	"pktH" -- source, destination machine ID's
 //	"mailH" -- source, destination mailbox ID's
-//	"data" -- payload data
+//	"data" -- payload data, or NULL if it will be filled in later
 //----------------------------------------------------------------------
 
 Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 {
-    ASSERT(mailH.length <= MaxMailSize);
+    ASSERT(mailH.length <= MaxMessageSize);
 
     pktHdr = pktH;
     mailHdr = mailH;
-    bcopy(msgData, data, mailHdr.length);
+    data = new char[mailHdr.length];
+    packet = NULL;
+    if (msgData != NULL) {
+	bcopy(msgData, data, mailHdr.length);
+	stats->numPayloadCopies++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Mail::Mail
+//      Initialize a mail message that arrived in a single packet.  The
+//	data stays in the packet buffer until someone asks for it.
+//
+//	"pkt" -- the packet, with both headers still on the front
+//----------------------------------------------------------------------
+
+Mail::Mail(Packet *pkt)
+{
+    pktHdr = *pkt->Header();
+    mailHdr = *(MailHeader *) pkt->Payload();
+    data = pkt->Payload() + sizeof(MailHeader);
+    packet = pkt;
+}
+
+//----------------------------------------------------------------------
+// Mail::~Mail
+//      De-allocate a mail message.
+//----------------------------------------------------------------------
+
+Mail::~Mail()
+{
+    if (packet != NULL)
+	packetPool->Free(packet);
+    else
+	delete [] data;
 }
 
 //----------------------------------------------------------------------
@@ -52,6 +92,9 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 MailBox::MailBox()
 { 
     messages = new SynchList(); 
+    for (int i = 0; i < MaxReassembly; i++)
+	partial[i].mail = NULL;
+    partialBytes = 0;
 }
 
 //----------------------------------------------------------------------
@@ -64,6 +107,9 @@ MailBox::MailBox()
 
 MailBox::~MailBox()
 { 
+    for (int i = 0; i < MaxReassembly; i++)
+	if (partial[i].mail != NULL)
+	    FreePartial(&partial[i]);
     delete messages; 
 }
 
@@ -88,24 +134,125 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 // 	Add a message to the mailbox.  If anyone is waiting for message
 //	arrival, wake them up!
 //
-//	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	The Mail message wraps the packet the message arrived in, to 
+//	simplify queueing the message on the SynchList, without copying
+//	the data.
 //
-//	"pktHdr" -- source, destination machine ID's
-//	"mailHdr" -- source, destination mailbox ID's
-//	"data" -- payload message data
+//	"pkt" -- the packet, with its PacketHeader and MailHeader
+//
+//	If the message came in fragments, this is only one of them: 
+//	copy it into the partly reassembled message, and only queue the
+//	message once every fragment is in.  Fragments may arrive in any
+//	order.  Only the postal worker calls Put, so the reassemblies 
+//	need no lock of their own.
 //----------------------------------------------------------------------
 
 void 
-MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
+MailBox::Put(Packet *pkt)
 { 
-    Mail *mail = new Mail(pktHdr, mailHdr, data); 
+    PacketHeader pktHdr = *pkt->Header();
+    MailHeader mailHdr = *(MailHeader *) pkt->Payload();
+    int size = pktHdr.length - sizeof(MailHeader);	// of this fragment
+    Reassembly *r;
+    Mail *mail;
+    int fragment;
+
+    if (mailHdr.offset == 0 && size == (int) mailHdr.length) {
+	mail = new Mail(pkt);				// the whole thing
+    } else {
+	r = FindPartial(pktHdr, mailHdr);
+	fragment = mailHdr.offset / MaxMailSize;
+	if (!r->have[fragment]) {
+	    bcopy(pkt->Payload() + sizeof(MailHeader), 
+				r->mail->data + mailHdr.offset, size);
+	    stats->numPayloadCopies++;
+	    r->have[fragment] = TRUE;
+	    r->received++;
+	}					// else already got this one
+	packetPool->Free(pkt);
+	if (r->received < r->numFragments)
+	    return;				// still waiting for more
+	mail = r->mail;
+	r->mail = NULL;				// so FreePartial keeps it
+	FreePartial(r);
+    }
 
     messages->Append((void *)mail);	// put on the end of the list of 
 					// arrived messages, and wake up 
 					// any waiters
 }
 
+//----------------------------------------------------------------------
+// MailBox::FindPartial
+// 	Return the reassembly of the message that a fragment belongs to.
+//	If this is the first fragment of the message to arrive, start a
+//	new reassembly, first throwing out the oldest incomplete 
+//	messages if they leave no room for it.
+//
+//	"pktHdr", "mailHdr" -- headers of the fragment
+//----------------------------------------------------------------------
+
+Reassembly *
+MailBox::FindPartial(PacketHeader pktHdr, MailHeader mailHdr)
+{
+    Reassembly *r, *unused, *oldest;
+    int i;
+
+    for (i = 0; i < MaxReassembly; i++) {
+	r = &partial[i];
+	if (r->mail != NULL && r->mail->pktHdr.from == pktHdr.from
+				&& r->mail->mailHdr.id == mailHdr.id)
+	    return r;
+    }
+
+    for (;;) {
+	unused = oldest = NULL;
+	for (i = 0; i < MaxReassembly; i++) {
+	    r = &partial[i];
+	    if (r->mail == NULL) {
+		if (unused == NULL)
+		    unused = r;
+	    } else if (oldest == NULL || r->started < oldest->started)
+		oldest = r;
+	}
+	if (unused != NULL 
+		&& partialBytes + mailHdr.length <= MaxReassemblyBytes)
+	    break;
+	DEBUG('n', "Dropping incomplete message %d from %d\n", 
+			oldest->mail->mailHdr.id, oldest->mail->pktHdr.from);
+	FreePartial(oldest);
+    }
+
+    r = unused;
+    r->mail = new Mail(pktHdr, mailHdr, NULL);
+    r->numFragments = divRoundUp(mailHdr.length, MaxMailSize);
+    r->received = 0;
+    r->size = mailHdr.length;
+    r->have = new char[r->numFragments];
+    for (i = 0; i < r->numFragments; i++)
+	r->have[i] = FALSE;
+    r->started = stats->totalTicks;
+    partialBytes += r->size;
+    return r;
+}
+
+//----------------------------------------------------------------------
+// MailBox::FreePartial
+// 	Give back the space held by a reassembly, and the message in it,
+//	if it's still there.
+//
+//	"r" -- the reassembly
+//----------------------------------------------------------------------
+
+void
+MailBox::FreePartial(Reassembly *r)
+{
+    partialBytes -= r->size;
+    delete [] r->have;
+    delete r->mail;			// NULL if it was delivered
+    r->mail = NULL;
+}
+
 //----------------------------------------------------------------------
 // MailBox::Get
 // 	Get a message from a mailbox, parsing it into the packet header,
@@ -134,6 +281,7 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data)
     bcopy(mail->data, data, mail->mailHdr.length);
 					// copy the message data into
 					// the caller's buffer
+    stats->numPayloadCopies++;
     delete mail;			// we've copied out the stuff we
 					// need, we can now discard the message
 }
@@ -179,6 +327,7 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
     messageAvailable = new Semaphore("message available", 0);
     messageSent = new Semaphore("message sent", 0);
     sendLock = new Lock("message send lock");
+    nextId = 0;
 
 // Second, initialize the mailboxes
     netAddr = addr; 
@@ -214,8 +363,9 @@ PostOffice::~PostOffice()
 // PostOffice::PostalDelivery
 // 	Wait for incoming messages, and put them in the right mailbox.
 //
-//      Incoming messages have had the PacketHeader stripped off,
-//	but the MailHeader is still tacked on the front of the data.
+//      Incoming messages are handed over in the packet buffer they 
+//	arrived in, with the PacketHeader and MailHeader still on the 
+//	front; the buffer goes on to the mailbox.
 //----------------------------------------------------------------------
 
 void
@@ -223,14 +373,16 @@ PostOffice::PostalDelivery()
 {
     PacketHeader pktHdr;
     MailHeader mailHdr;
-    char *buffer = new char[MaxPacketSize];
+    Packet *pkt;
 
     for (;;) {
         // first, wait for a message
         messageAvailable->P();	
-        pktHdr = network->Receive(buffer);
+        pkt = network->ReceivePacket();
+	ASSERT(pkt != NULL);
 
-        mailHdr = *(MailHeader *)buffer;
+        pktHdr = *pkt->Header();
+        mailHdr = *(MailHeader *) pkt->Payload();
         if (DebugIsEnabled('n')) {
 	    printf("Putting mail into mailbox: ");
 	    PrintHeader(pktHdr, mailHdr);
@@ -238,10 +390,13 @@ PostOffice::PostalDelivery()
 
 	// check that arriving message is legal!
 	ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
-	ASSERT(mailHdr.length <= MaxMailSize);
+	ASSERT(mailHdr.length <= MaxMessageSize);
+	ASSERT(mailHdr.offset % MaxMailSize == 0);
+	ASSERT(mailHdr.offset + pktHdr.length - sizeof(MailHeader) 
+							<= mailHdr.length);
 
 	// put into mailbox
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+        boxes[mailHdr.to].Put(pkt);
     }
 }
 
@@ -249,10 +404,16 @@ PostOffice::PostalDelivery()
 // PostOffice::Send
 // 	Concatenate the MailHeader to the front of the data, and pass 
 //	the result to the Network for delivery to the destination machine.
+//	The packet is built right in a packet buffer, which the Network
+//	sends as is, so the data is only copied once.
 //
 //	Note that the MailHeader + data looks just like normal payload
 //	data to the Network.
 //
+//	A message too big for one packet goes out in MaxMailSize pieces.
+//	Other threads' packets may go out in between; the message id
+//	keeps the receiver from mixing up the pieces.
+//
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
 //	"data" -- payload message data
@@ -261,33 +422,41 @@ PostOffice::PostalDelivery()
 void
 PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
 {
-    char* buffer = new char[MaxPacketSize];	// space to hold concatenated
-						// mailHdr + data
+    Packet *pkt;			// space to hold concatenated
+					// pktHdr + mailHdr + data
+    unsigned size;			// of the current fragment
 
     if (DebugIsEnabled('n')) {
 	printf("Post send: ");
 	PrintHeader(pktHdr, mailHdr);
     }
-    ASSERT(mailHdr.length <= MaxMailSize);
+    ASSERT(mailHdr.length <= MaxMessageSize);
     ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
     
     // fill in pktHdr, for the Network layer
     pktHdr.from = netAddr;
-    pktHdr.length = mailHdr.length + sizeof(MailHeader);
+    mailHdr.id = nextId++;
 
-    // concatenate MailHeader and data
-    bcopy(&mailHdr, buffer, sizeof(MailHeader));
-    bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
+    mailHdr.offset = 0;
+    do {
+	size = min(mailHdr.length - mailHdr.offset, MaxMailSize);
+	pktHdr.length = size + sizeof(MailHeader);
 
-    sendLock->Acquire();   		// only one message can be sent
-					// to the network at any one time
-    network->Send(pktHdr, buffer);
-    messageSent->P();			// wait for interrupt to tell us
-					// ok to send the next message
-    sendLock->Release();
+	// concatenate PacketHeader, MailHeader and data
+	pkt = packetPool->Alloc();
+	*pkt->Header() = pktHdr;
+	*(MailHeader *) pkt->Payload() = mailHdr;
+	bcopy(data + mailHdr.offset, pkt->Payload() + sizeof(MailHeader), size);
+	stats->numPayloadCopies++;
 
-    delete [] buffer;			// we've sent the message, so
-					// we can delete our buffer
+	sendLock->Acquire();   		// only one packet can be sent
+					// to the network at any one time
+	network->Send(pkt);		// the network gives back the buffer
+	messageSent->P();		// wait for interrupt to tell us
+					// ok to send the next packet
+	sendLock->Release();
+	mailHdr.offset += size;
+    } while (mailHdr.offset < mailHdr.length);
 }
 
 //----------------------------------------------------------------------
@@ -312,7 +481,7 @@ PostOffice::Receive(int box, PacketHeader *pktHdr,
     ASSERT((box >= 0) && (box < numBoxes));
 
     boxes[box].Get(pktHdr, mailHdr, data);
-    ASSERT(mailHdr->length <= MaxMailSize);
+    ASSERT(mailHdr->length <= MaxMessageSize);
 }
 
 //----------------------------------------------------------------------
@@ -19,6 +19,11 @@
 //	to which you can send an acknowledgement, if your protocol requires 
 //	this.
 //
+//	A message can be bigger than a packet (up to MaxMessageSize).  The
+//	post office splits it into fragments, and the receiving mailbox 
+//	puts them back together, in whatever order they arrive.  If any 
+//	fragment is lost, so is the whole message.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -45,13 +50,27 @@ class MailHeader {
     MailBoxAddress from;	// Mail box to reply to
     unsigned length;		// Bytes of message data (excluding the 
 				// mail header)
+    unsigned id;		// Which message this is a fragment of, 
+    unsigned offset;		// and where in it the fragment goes; 
+				// filled in by PostOffice::Send
 };
 
-// Maximum "payload" -- real data -- that can included in a single message
+// Maximum "payload" -- real data -- that can included in a single packet
 // Excluding the MailHeader and the PacketHeader
 
 #define MaxMailSize 	(MaxPacketSize - sizeof(MailHeader))
 
+// Largest message that can be sent, by splitting it into packets
+
+#define MaxMessageSize	(1 << 20)
+
+// Reassembly of fragmented messages, in each mailbox, is limited to
+// this many messages at a time, and this many bytes in all; if a new 
+// message won't fit, the oldest incomplete one is thrown away.
+
+#define MaxReassembly		4
+#define MaxReassemblyBytes	(2 * MaxMessageSize)
+
 
 // The following class defines the format of an incoming/outgoing 
 // "Mail" message.  The message format is layered: 
@@ -64,10 +83,29 @@ class Mail {
      Mail(PacketHeader pktH, MailHeader mailH, char *msgData);
 				// Initialize a mail message by
 				// concatenating the headers to the data
+     Mail(Packet *pkt);		// Initialize a mail message from a packet
+				// that holds all of it, leaving the data 
+				// where it is; we take over the packet
+     ~Mail();			// De-allocate the message
 
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
-     char data[MaxMailSize];	// Payload -- message data
+     char *data;		// Payload -- message data
+
+  private:
+     Packet *packet;		// The packet "data" is in, if any
+};
+
+// A message being put back together from its fragments.
+
+class Reassembly {
+  public:
+    Mail *mail;			// The message, or NULL if slot is unused
+    int size;			// Its length
+    int numFragments;		// How many fragments it was sent as
+    int received;		// How many we have so far
+    char *have;			// Which ones we have
+    int started;		// When the first one arrived
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -80,14 +118,23 @@ class MailBox {
     MailBox();			// Allocate and initialize mail box
     ~MailBox();			// De-allocate mail box
 
-    void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
+    void Put(Packet *pkt);	// Atomically put a message (or a fragment
+				// of one) into the mailbox; we take over
+				// the packet
     void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
 				// to get!)
   private:
     SynchList *messages;	// A mailbox is just a list of arrived messages
+    Reassembly partial[MaxReassembly];
+				// Messages we have only some fragments of
+    int partialBytes;		// Total size of those messages
+
+    Reassembly *FindPartial(PacketHeader pktHdr, MailHeader mailHdr);
+				// Find (or start) the reassembly for the 
+				// message a fragment belongs to
+    void FreePartial(Reassembly *r);	// Done with a reassembly
 };
 
 // The following class defines a "Post Office", or a collection of 
@@ -110,12 +157,18 @@ class PostOffice {
     void Send(PacketHeader pktHdr, MailHeader mailHdr, char *data);
     				// Send a message to a mailbox on a remote 
 				// machine.  The fromBox in the MailHeader is 
-				// the return box for ack's.
+				// the return box for ack's.  Messages bigger
+				// than MaxMailSize are sent in fragments.
     
     void Receive(int box, PacketHeader *pktHdr, 
 		MailHeader *mailHdr, char *data);
     				// Retrieve a message from "box".  Wait if
-				// there is no message in the box.
+				// there is no message in the box.  "data" 
+				// must have room for the biggest message
+				// that may be sent to the box.
+
+    NetworkAddress Address() { return netAddr; }
+				// This machine's network address
 
     void PostalDelivery();	// Wait for incoming messages, 
 				// and then put them in the correct mailbox
@@ -136,6 +189,7 @@ class PostOffice {
     Semaphore *messageAvailable;// V'ed when message has arrived from network
     Semaphore *messageSent;	// V'ed when next message can be sent to network
     Lock *sendLock;		// Only one outgoing message at a time
+    unsigned nextId;		// Id for the next message we send
 };
 
 #endif
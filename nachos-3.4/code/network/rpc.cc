@@ -0,0 +1,304 @@
+// rpc.cc
+//	Routines for remote procedure calls over the Post Office.  See
+//	rpc.h for how calls and replies are matched up.
+//
+//	A client has one thread of its own, which takes in every reply
+//	message that arrives in its reply mailbox, and hands each reply
+//	in it to the call it belongs to.  A server has its worker threads,
+//	plus one thread that sends replies.
+
+#include "copyright.h"
+#include "rpc.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ReplyHelper, WorkerHelper, SenderHelper
+// 	Dummy functions because C++ can't indirectly invoke member
+//	functions; they are forked as the client's and server's threads.
+//
+//	"arg" -- pointer to the RpcClient or RpcServer
+//----------------------------------------------------------------------
+
+static void ReplyHelper(int arg)
+{ RpcClient *c = (RpcClient *) arg; c->ReceiveReplies(); }
+static void WorkerHelper(int arg)
+{ RpcServer *s = (RpcServer *) arg; s->ServeRequests(); }
+static void SenderHelper(int arg)
+{ RpcServer *s = (RpcServer *) arg; s->SendReplies(); }
+
+//----------------------------------------------------------------------
+// RpcClient::RpcClient
+// 	Set up a client, and start the thread that takes in its replies.
+//
+//	"box" -- mailbox here for replies, used only by this client
+//	"addr", "service" -- where the server is listening
+//----------------------------------------------------------------------
+
+RpcClient::RpcClient(int box, NetworkAddress addr, int service)
+{
+    replyBox = box;
+    serverAddr = addr;
+    serverBox = service;
+
+    lock = new Lock("rpc client");
+    slotFree = new Condition("rpc slot free");
+    for (int i = 0; i < MaxOutstanding; i++)
+	calls[i] = NULL;
+    nextId = 0;
+
+    (new Thread("rpc replies"))->Fork(ReplyHelper, (int) this);
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Call
+// 	Call a procedure on the server, and wait for the result.  Other
+//	threads may be making calls at the same time.
+//
+//	"proc" -- which procedure
+//	"args", "length" -- its arguments; at most MaxRpcData bytes
+//	"result" -- where to put the result; room for MaxRpcData bytes
+//----------------------------------------------------------------------
+
+int
+RpcClient::Call(int proc, char *args, int length, char *result)
+{
+    return Finish(Begin(proc, args, length), result);
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Begin
+// 	Send a request to the server, and return without waiting for the
+//	reply.  Waits first if MaxOutstanding calls are already
+//	outstanding (or rather, if the one that was started
+//	MaxOutstanding calls ago is).
+//
+//	"proc" -- which procedure
+//	"args", "length" -- its arguments; at most MaxRpcData bytes
+//----------------------------------------------------------------------
+
+RpcCall *
+RpcClient::Begin(int proc, char *args, int length)
+{
+    RpcCall *call = new RpcCall;
+    char buffer[MaxMailSize];
+    RpcHeader *hdr = (RpcHeader *) buffer;
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+
+    ASSERT(length >= 0 && length <= (int) MaxRpcData);
+    call->done = new Semaphore("rpc call done", 0);
+
+    lock->Acquire();
+    while (calls[nextId % MaxOutstanding] != NULL)
+	slotFree->Wait(lock);
+    call->id = nextId++;
+    calls[call->id % MaxOutstanding] = call;
+    lock->Release();
+
+    DEBUG('n', "RPC: call %d, procedure %d\n", call->id, proc);
+    hdr->id = call->id;
+    hdr->proc = proc;
+    hdr->length = length;
+    bcopy(args, buffer + sizeof(RpcHeader), length);
+    pktHdr.to = serverAddr;
+    mailHdr.to = serverBox;
+    mailHdr.from = replyBox;
+    mailHdr.length = sizeof(RpcHeader) + length;
+    postOffice->Send(pktHdr, mailHdr, buffer);
+    return call;
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Finish
+// 	Wait for the reply to a call made with Begin, copy out the
+//	result, and return its length.
+//
+//	"call" -- the call; de-allocated here
+//	"result" -- where to put the result; room for MaxRpcData bytes
+//----------------------------------------------------------------------
+
+int
+RpcClient::Finish(RpcCall *call, char *result)
+{
+    int length;
+
+    call->done->P();
+    length = call->length;
+    bcopy(call->result, result, length);
+
+    lock->Acquire();
+    calls[call->id % MaxOutstanding] = NULL;
+    slotFree->Broadcast(lock);
+    lock->Release();
+
+    delete call->done;
+    delete call;
+    return length;
+}
+
+//----------------------------------------------------------------------
+// RpcClient::ReceiveReplies
+// 	Forever take in reply messages, and wake up the calls that the
+//	replies in them are for.
+//----------------------------------------------------------------------
+
+void
+RpcClient::ReceiveReplies()
+{
+    char buffer[MaxMailSize];
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    RpcHeader *hdr;
+    RpcCall *call;
+    int offset;
+
+    for (;;) {
+	postOffice->Receive(replyBox, &pktHdr, &mailHdr, buffer);
+	for (offset = 0; offset < (int) mailHdr.length;
+				offset += sizeof(RpcHeader) + hdr->length) {
+	    hdr = (RpcHeader *) (buffer + offset);
+	    ASSERT(hdr->length >= 0 && hdr->length <= (int) MaxRpcData);
+
+	    lock->Acquire();
+	    call = calls[hdr->id % MaxOutstanding];
+	    lock->Release();
+	    ASSERT(call != NULL && call->id == hdr->id);
+
+	    DEBUG('n', "RPC: reply to call %d\n", hdr->id);
+	    call->length = hdr->length;
+	    bcopy(buffer + offset + sizeof(RpcHeader), call->result,
+								hdr->length);
+	    call->done->V();
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// RpcServer::RpcServer
+// 	Set up a server, and start its threads.
+//
+//	"box" -- mailbox here where requests come in
+//	"numWorkers" -- how many calls to serve at once
+//	"h" -- the procedure that serves each call
+//----------------------------------------------------------------------
+
+RpcServer::RpcServer(int box, int numWorkers, RpcHandler h)
+{
+    ASSERT(numWorkers > 0);
+    serviceBox = box;
+    handler = h;
+
+    lock = new Lock("rpc server");
+    replyReady = new Condition("rpc reply ready");
+    replies = new List;
+
+    numCalls = numReplyMessages = 0;
+
+    for (int i = 0; i < numWorkers; i++)
+	(new Thread("rpc worker"))->Fork(WorkerHelper, (int) this);
+    (new Thread("rpc reply sender"))->Fork(SenderHelper, (int) this);
+}
+
+//----------------------------------------------------------------------
+// RpcServer::PrintStats
+// 	Print how many calls we've served, and in how many messages the
+//	replies went out.
+//----------------------------------------------------------------------
+
+void
+RpcServer::PrintStats()
+{
+    printf("RPC server: %d calls, %d reply messages\n", numCalls,
+							numReplyMessages);
+}
+
+//----------------------------------------------------------------------
+// RpcServer::ServeRequests
+// 	Forever take a request from the service mailbox, call the handler,
+//	and queue the reply to be sent.
+//----------------------------------------------------------------------
+
+void
+RpcServer::ServeRequests()
+{
+    char buffer[MaxMailSize];
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    RpcHeader *hdr = (RpcHeader *) buffer;
+    RpcReply *reply;
+
+    for (;;) {
+	postOffice->Receive(serviceBox, &pktHdr, &mailHdr, buffer);
+	ASSERT(mailHdr.length == sizeof(RpcHeader) + hdr->length);
+
+	reply = new RpcReply;
+	reply->to = pktHdr.from;
+	reply->box = mailHdr.from;
+	reply->hdr.id = hdr->id;
+	reply->hdr.proc = hdr->proc;
+	reply->hdr.length = (*handler)(hdr->proc, buffer + sizeof(RpcHeader),
+					hdr->length, reply->result);
+	ASSERT(reply->hdr.length >= 0
+			&& reply->hdr.length <= (int) MaxRpcData);
+
+	lock->Acquire();
+	numCalls++;
+	replies->Append((void *) reply);
+	replyReady->Signal(lock);
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// RpcServer::SendReplies
+// 	Forever send out the queued replies.  Take the oldest one, along
+//	with every other reply queued for the same client mailbox that
+//	fits in the same message, and send them all at once.  While the
+//	message is being sent, more replies can queue up for the next one.
+//----------------------------------------------------------------------
+
+void
+RpcServer::SendReplies()
+{
+    char buffer[MaxMailSize];
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    RpcReply *first, *reply;
+    List *others;
+    int length, size;
+
+    for (;;) {
+	lock->Acquire();
+	while (replies->IsEmpty())
+	    replyReady->Wait(lock);
+	first = (RpcReply *) replies->Remove();
+	length = 0;
+	others = new List;
+	for (reply = first; reply != NULL;
+				reply = (RpcReply *) replies->Remove()) {
+	    size = sizeof(RpcHeader) + reply->hdr.length;
+	    if (reply->to != first->to || reply->box != first->box
+				|| length + size > (int) MaxMailSize) {
+		others->Append((void *) reply);		// not this time
+		continue;
+	    }
+	    bcopy((char *) &reply->hdr, buffer + length, sizeof(RpcHeader));
+	    bcopy(reply->result, buffer + length + sizeof(RpcHeader),
+							reply->hdr.length);
+	    length += size;
+	    if (reply != first)
+		delete reply;
+	}
+	delete replies;				// what's left, in order
+	replies = others;
+	numReplyMessages++;
+	lock->Release();
+
+	pktHdr.to = first->to;
+	mailHdr.to = first->box;
+	mailHdr.from = serviceBox;
+	mailHdr.length = length;
+	postOffice->Send(pktHdr, mailHdr, buffer);
+	delete first;
+    }
+}
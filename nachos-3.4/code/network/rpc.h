@@ -0,0 +1,133 @@
+// rpc.h
+//	Data structures for remote procedure calls between machines, on
+//	top of the Post Office.
+//
+//	A client sends each call as a request message to the server's
+//	service mailbox, tagged with a call id; the server sends the
+//	result back in a reply with the same id, to a mailbox the client
+//	keeps for replies.  Since replies are matched to calls by id, not
+//	by the order they come back in, any number of a client's threads
+//	may have calls outstanding at once, and a single thread can start
+//	several calls before waiting for any of them (Begin/Finish).
+//
+//	The server runs a pool of worker threads, each taking requests
+//	from the service mailbox, calling the server's handler, and
+//	queueing the reply.  One more thread sends the replies out; any
+//	replies for the same client that have queued up while it was
+//	sending the last message go out together, in one message.
+//
+//	Like the Post Office, RPC assumes messages get through: a call
+//	whose request or reply is lost never finishes.
+
+#include "copyright.h"
+
+#ifndef RPC_H
+#define RPC_H
+
+#include "post.h"
+#include "synch.h"
+#include "list.h"
+
+#define MaxOutstanding	64		// most calls a client can have
+					// outstanding at once
+
+// The following class defines the RPC header, which goes in front of
+// the arguments of each request, and the result of each reply.  A reply
+// message may hold several replies, one after the other.
+
+class RpcHeader {
+  public:
+    unsigned id;			// Which call this is
+    int proc;				// Which procedure to call
+    int length;				// Bytes of arguments or result
+};
+
+// Largest arguments or result of a call; a request or reply fits in
+// one packet.
+#define MaxRpcData	(MaxMailSize - sizeof(RpcHeader))
+
+// A server's handler is called with the procedure number, and its
+// arguments; it puts the result in "result", and returns its length.
+typedef int (*RpcHandler)(int proc, char *args, int length, char *result);
+
+// The following class defines a call, from the time it's made until
+// its result is picked up.
+
+class RpcCall {
+  public:
+    unsigned id;			// Call id
+    Semaphore *done;			// V'ed when the reply arrives
+    int length;				// Bytes of result
+    char result[MaxRpcData];		// The result
+};
+
+// The following class defines a reply, waiting to be sent.
+
+class RpcReply {
+  public:
+    NetworkAddress to;			// Machine and mailbox to send it to
+    int box;
+    RpcHeader hdr;			// Header and result
+    char result[MaxRpcData];
+};
+
+// The following class defines the client side of RPC.
+
+class RpcClient {
+  public:
+    RpcClient(int replyBox, NetworkAddress serverAddr, int serverBox);
+				// Set up to call the server listening at
+				// "serverBox" on "serverAddr"; replies come
+				// to "replyBox", which nothing else may use
+
+    int Call(int proc, char *args, int length, char *result);
+				// Make a call, and wait for its result;
+				// return the length of the result
+    RpcCall *Begin(int proc, char *args, int length);
+				// Make a call, without waiting for it
+    int Finish(RpcCall *call, char *result);
+				// Wait for a call made with Begin to
+				// finish, and return its result
+
+    void ReceiveReplies();	// Body of the thread that takes in replies
+
+  private:
+    int replyBox;		// Our mailbox, for replies
+    NetworkAddress serverAddr;	// Where the server is
+    int serverBox;
+
+    Lock *lock;			// Protects everything below
+    Condition *slotFree;	// Signalled when a call finishes
+    RpcCall *calls[MaxOutstanding];
+				// Calls outstanding, by id % MaxOutstanding
+    unsigned nextId;		// Id for the next call
+};
+
+// The following class defines the server side of RPC.
+
+class RpcServer {
+  public:
+    RpcServer(int serviceBox, int numWorkers, RpcHandler handler);
+				// Start "numWorkers" threads serving calls
+				// that arrive at "serviceBox", by calling
+				// "handler"
+
+    void PrintStats();		// Print how many calls we've served, and
+				// how many messages the replies took
+
+    void ServeRequests();	// Body of each worker thread
+    void SendReplies();		// Body of the thread that sends replies
+
+  private:
+    int serviceBox;		// Where requests come in
+    RpcHandler handler;		// What to do with them
+
+    Lock *lock;			// Protects everything below
+    Condition *replyReady;	// Signalled when a reply is queued
+    List *replies;		// Replies waiting to be sent, in order
+
+    int numCalls;		// Statistics
+    int numReplyMessages;
+};
+
+#endif // RPC_H
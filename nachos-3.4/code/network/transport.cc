@@ -0,0 +1,431 @@
+// transport.cc
+//	Routines for reliable, in-order message delivery over the Post
+//	Office.  See transport.h for the protocol.
+//
+//	Each connection has two threads of its own: a receiver, which
+//	takes every segment that arrives in our mailbox and handles it
+//	(ACKs open up the send window; data is acknowledged, and queued
+//	for Receive in order), and a retransmitter, which waits for the
+//	retransmit timer to go off.  The timer itself is an interrupt,
+//	scheduled with Interrupt::Schedule; since an interrupt handler
+//	can't send a message (that takes a lock), all it does is wake up
+//	the retransmitter.
+//
+//	There is only ever one retransmit timer running per connection.
+//	Restarting it just moves the deadline; when the interrupt
+//	happens, if the deadline has moved it schedules itself again.
+
+#include "copyright.h"
+#include "transport.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ReceiverHelper, RetransmitHelper, TimerHandler
+// 	Dummy functions because C++ can't indirectly invoke member
+//	functions.  The first two are forked as the connection's threads;
+//	the last is called by the timer interrupt.
+//
+//	"arg" -- pointer to the Connection
+//----------------------------------------------------------------------
+
+static void ReceiverHelper(int arg)
+{ Connection *c = (Connection *) arg; c->ReceiveSegments(); }
+static void RetransmitHelper(int arg)
+{ Connection *c = (Connection *) arg; c->RetransmitSegments(); }
+static void TimerHandler(int arg)
+{ Connection *c = (Connection *) arg; c->TimerExpired(); }
+
+//----------------------------------------------------------------------
+// Connection::Connection
+// 	Set up our end of a connection, and start its threads.  The other
+//	end must set up a matching connection (with "localBox" and
+//	"farBox" swapped).
+//
+//	"localBox" -- mailbox here, used only by this connection
+//	"farAddr", "farBox" -- the other end
+//	"window" -- max # of messages sent but not yet acknowledged
+//----------------------------------------------------------------------
+
+Connection::Connection(int local, NetworkAddress addr, int box, int win)
+{
+    ASSERT(win > 0 && win <= MaxWindow);
+    localBox = local;
+    farAddr = addr;
+    farBox = box;
+    window = win;
+
+    lock = new Lock("connection");
+    windowOpen = new Condition("window open");
+    dataArrived = new Condition("data arrived");
+
+    sendWindow = new Segment[MaxWindow];
+    sendBase = nextSeq = 0;
+    dupAcks = 0;
+
+    srtt = rttvar = 0;
+    timeout = InitialTimeout;
+    timerOn = FALSE;
+    timerDeadline = timerScheduled = 0;
+    timerFired = new Semaphore("retransmit timer", 0);
+
+    recvWindow = new Segment[MaxWindow];
+    for (int i = 0; i < MaxWindow; i++)
+	recvWindow[i].present = FALSE;
+    recvNext = 0;
+    delivered = new List;
+
+    segmentsSent = retransmits = timeouts = fastRetransmits = 0;
+    dupsReceived = 0;
+
+    (new Thread("connection receiver"))->Fork(ReceiverHelper, (int) this);
+    (new Thread("connection retransmitter"))->Fork(RetransmitHelper,
+								(int) this);
+}
+
+//----------------------------------------------------------------------
+// Connection::Send
+// 	Send a message over the connection.  Returns once the message
+//	has been sent the first time -- not when it's been received.
+//	Waits first if there are already "window" messages outstanding.
+//
+//	"data" -- the message
+//	"length" -- its size, at most MaxSegmentSize
+//----------------------------------------------------------------------
+
+void
+Connection::Send(char *data, int length)
+{
+    Segment *seg;
+
+    ASSERT(length >= 0 && length <= (int) MaxSegmentSize);
+    lock->Acquire();
+    while (nextSeq - sendBase >= window)
+	windowOpen->Wait(lock);
+    seg = &sendWindow[nextSeq % MaxWindow];
+    seg->length = length;
+    bcopy(data, seg->data, length);
+    seg->retransmitted = FALSE;
+    nextSeq++;
+    Transmit(nextSeq - 1);
+    if (sendBase == nextSeq - 1)	// the timer is for the oldest message
+	StartTimer();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Connection::Receive
+// 	Wait for the next message to arrive (in order), and return it.
+//
+//	"data" -- where to put the message; room for MaxSegmentSize bytes
+//----------------------------------------------------------------------
+
+int
+Connection::Receive(char *data)
+{
+    Segment *seg;
+    int length;
+
+    lock->Acquire();
+    while (delivered->IsEmpty())
+	dataArrived->Wait(lock);
+    seg = (Segment *) delivered->Remove();
+    lock->Release();
+
+    length = seg->length;
+    bcopy(seg->data, data, length);
+    delete seg;
+    return length;
+}
+
+//----------------------------------------------------------------------
+// Connection::Flush
+// 	Wait until the other end has acknowledged every message we've sent.
+//----------------------------------------------------------------------
+
+void
+Connection::Flush()
+{
+    lock->Acquire();
+    while (sendBase < nextSeq)
+	windowOpen->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Connection::Transmit
+// 	Send (or resend) message "seq" from the send window to the other
+//	end.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::Transmit(int seq)
+{
+    Segment *seg = &sendWindow[seq % MaxWindow];
+    char buffer[MaxMailSize];
+    SegmentHeader *hdr = (SegmentHeader *) buffer;
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+
+    DEBUG('n', "Transport: sending segment %d, %d bytes\n", seq, 
+							seg->length);
+    hdr->type = DataSegment;
+    hdr->seq = seq;
+    bcopy(seg->data, buffer + sizeof(SegmentHeader), seg->length);
+    pktHdr.to = farAddr;
+    mailHdr.to = farBox;
+    mailHdr.from = localBox;
+    mailHdr.length = sizeof(SegmentHeader) + seg->length;
+    seg->sentAt = stats->totalTicks;
+    segmentsSent++;
+    postOffice->Send(pktHdr, mailHdr, buffer);
+}
+
+//----------------------------------------------------------------------
+// Connection::SendAck
+// 	Tell the other end which message we expect next -- implicitly,
+//	that we have everything before it.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::SendAck()
+{
+    SegmentHeader hdr;
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+
+    hdr.type = AckSegment;
+    hdr.seq = recvNext;
+    pktHdr.to = farAddr;
+    mailHdr.to = farBox;
+    mailHdr.from = localBox;
+    mailHdr.length = sizeof(SegmentHeader);
+    postOffice->Send(pktHdr, mailHdr, (char *) &hdr);
+}
+
+//----------------------------------------------------------------------
+// Connection::ReceiveSegments
+// 	The receiver thread: handle each segment that arrives in our
+//	mailbox.  Anything not from the other end of the connection is
+//	thrown away.
+//----------------------------------------------------------------------
+
+void
+Connection::ReceiveSegments()
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    char buffer[MaxMailSize];
+    SegmentHeader *hdr = (SegmentHeader *) buffer;
+
+    for (;;) {
+	postOffice->Receive(localBox, &pktHdr, &mailHdr, buffer);
+	if (pktHdr.from != farAddr || mailHdr.from != farBox
+		|| mailHdr.length < sizeof(SegmentHeader))
+	    continue;
+	lock->Acquire();
+	if (hdr->type == AckSegment)
+	    HandleAck(hdr->seq);
+	else
+	    HandleData(hdr->seq, buffer + sizeof(SegmentHeader),
+			mailHdr.length - sizeof(SegmentHeader));
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::HandleAck
+// 	The other end has everything before "ack".  Slide the window
+//	forward, and take a round trip time sample from the newest message
+//	acknowledged -- unless it was resent, since then we can't tell
+//	which copy is being acknowledged (Karn's algorithm).
+//
+//	If the ACK doesn't move the window, the other end is still missing
+//	sendBase, but got something after it; after DupAckThreshold of
+//	those, resend sendBase.
+//
+//	Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::HandleAck(int ack)
+{
+    Segment *newest;
+
+    if (ack > sendBase && ack <= nextSeq) {
+	newest = &sendWindow[(ack - 1) % MaxWindow];
+	if (!newest->retransmitted)
+	    SampleRtt(stats->totalTicks - newest->sentAt);
+	DEBUG('n', "Transport: ack %d, timeout %d\n", ack, timeout);
+	sendBase = ack;
+	dupAcks = 0;
+	if (sendBase == nextSeq)
+	    timerOn = FALSE;
+	else
+	    StartTimer();
+	windowOpen->Broadcast(lock);
+    } else if (ack == sendBase && sendBase < nextSeq) {
+	if (++dupAcks == DupAckThreshold) {
+	    DEBUG('n', "Transport: fast retransmit of %d\n", sendBase);
+	    fastRetransmits++;
+	    retransmits++;
+	    sendWindow[sendBase % MaxWindow].retransmitted = TRUE;
+	    Transmit(sendBase);
+	    StartTimer();
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::HandleData
+// 	Message "seq" has arrived.  If it's new, and we have room for it
+//	(the sender's window can be no bigger than MaxWindow), 
+//	keep it; then deliver everything we now have in order, and send
+//	an ACK (even for a duplicate, since the ACK for the original may
+//	have been lost).  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::HandleData(int seq, char *data, int length)
+{
+    Segment *seg;
+
+    if (seq >= recvNext && seq < recvNext + MaxWindow
+			&& !recvWindow[seq % MaxWindow].present) {
+	seg = &recvWindow[seq % MaxWindow];
+	seg->present = TRUE;
+	seg->length = length;
+	bcopy(data, seg->data, length);
+    } else
+	dupsReceived++;
+
+    while (recvWindow[recvNext % MaxWindow].present) {
+	seg = new Segment;
+	*seg = recvWindow[recvNext % MaxWindow];
+	recvWindow[recvNext % MaxWindow].present = FALSE;
+	delivered->Append((void *) seg);
+	recvNext++;
+	dataArrived->Signal(lock);
+    }
+    SendAck();
+}
+
+//----------------------------------------------------------------------
+// Connection::SampleRtt
+// 	Fold a new round trip time measurement into our estimate, and
+//	recompute the timeout: the smoothed round trip time plus four
+//	times its mean deviation (Jacobson/Karels).  srtt is kept times 8
+//	and rttvar times 4, so the arithmetic stays in integers.
+//----------------------------------------------------------------------
+
+void
+Connection::SampleRtt(int rtt)
+{
+    int delta;
+
+    if (srtt == 0) {			// first sample
+	srtt = rtt << 3;
+	rttvar = rtt << 1;
+    } else {
+	delta = rtt - (srtt >> 3);
+	srtt += delta;			// srtt = 7/8 srtt + 1/8 rtt
+	if (delta < 0)
+	    delta = -delta;
+	rttvar += delta - (rttvar >> 2);	// rttvar = 3/4 rttvar + 1/4 |delta|
+    }
+    timeout = (srtt >> 3) + rttvar;
+    if (timeout < MinTimeout)
+	timeout = MinTimeout;
+    if (timeout > MaxTimeout)
+	timeout = MaxTimeout;
+}
+
+//----------------------------------------------------------------------
+// Connection::StartTimer
+// 	(Re)start the retransmit timer, to go off "timeout" ticks from
+//	now.  We only need a new interrupt if the one already scheduled
+//	would be too late.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::StartTimer()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    timerDeadline = stats->totalTicks + timeout;
+    if (!timerOn || timerScheduled <= stats->totalTicks
+				|| timerDeadline < timerScheduled) {
+	timerScheduled = timerDeadline;
+	interrupt->Schedule(TimerHandler, (int) this, timeout, NetworkSendInt);
+    }
+    timerOn = TRUE;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Connection::TimerExpired
+// 	Interrupt handler for the retransmit timer.  If the timer has
+//	been stopped, or restarted since this interrupt was scheduled,
+//	there's nothing to do (except, in the second case, to make sure
+//	there'll be an interrupt at the new deadline).  Otherwise wake
+//	up the retransmitter.
+//----------------------------------------------------------------------
+
+void
+Connection::TimerExpired()
+{
+    if (!timerOn)
+	return;
+    if (stats->totalTicks < timerDeadline) {
+	if (timerScheduled <= stats->totalTicks) {
+	    timerScheduled = timerDeadline;
+	    interrupt->Schedule(TimerHandler, (int) this,
+			timerDeadline - stats->totalTicks, NetworkSendInt);
+	}
+	return;
+    }
+    timerOn = FALSE;
+    timerFired->V();
+}
+
+//----------------------------------------------------------------------
+// Connection::RetransmitSegments
+// 	The retransmitter thread: each time the timer goes off, resend
+//	the oldest unacknowledged message, and double the timeout, since
+//	the network must be losing packets (or slower than we thought).
+//----------------------------------------------------------------------
+
+void
+Connection::RetransmitSegments()
+{
+    for (;;) {
+	timerFired->P();
+	lock->Acquire();
+	if (sendBase < nextSeq && !timerOn) {
+	    DEBUG('n', "Transport: timeout, resending %d\n", sendBase);
+	    timeouts++;
+	    retransmits++;
+	    timeout *= 2;
+	    if (timeout > MaxTimeout)
+		timeout = MaxTimeout;
+	    dupAcks = 0;
+	    sendWindow[sendBase % MaxWindow].retransmitted = TRUE;
+	    Transmit(sendBase);
+	    StartTimer();
+	}
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::PrintStats
+// 	Print how hard the connection has had to work.
+//----------------------------------------------------------------------
+
+void
+Connection::PrintStats()
+{
+    printf("Transport: %d segments sent, %d retransmitted (%d timeouts, "
+	"%d fast retransmits), %d duplicates received, timeout %d\n",
+	segmentsSent, retransmits, timeouts, fastRetransmits, dupsReceived,
+	timeout);
+}
@@ -0,0 +1,137 @@
+// transport.h
+//	Data structures for reliable, in-order delivery of messages
+//	between two mailboxes on different machines, on top of the
+//	(unreliable) Post Office.
+//
+//	Each message is sent as one segment, tagged with a sequence
+//	number.  The receiver acknowledges cumulatively: each ACK carries
+//	the sequence number of the next message it is waiting for.  The
+//	sender may have up to "window" messages outstanding at once (a
+//	sliding window), and resends the oldest one if it isn't
+//	acknowledged within a timeout.  The timeout adapts to the round
+//	trip times we actually see (Jacobson's algorithm), and backs off
+//	exponentially while messages keep getting lost.  Three duplicate
+//	ACKs in a row mean a message was lost but later ones got through,
+//	so we resend it right away, without waiting for the timeout
+//	(fast retransmit).
+//
+//	The receiver holds on to messages that arrive out of order (within
+//	its window) until the missing ones show up.
+//
+//	A connection uses one mailbox at each end, for both data and
+//	ACKs; nothing else may use those mailboxes.  Connections are
+//	never torn down -- like the Post Office, they last until Nachos
+//	halts.
+
+#include "copyright.h"
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "post.h"
+#include "synch.h"
+#include "list.h"
+
+#define MaxWindow	32		// largest window, in messages
+#define DefaultWindow	8
+#define DupAckThreshold	3		// duplicate ACKs before fast retransmit
+
+#define InitialTimeout	(20 * NetworkTime)	// before we've measured
+#define MinTimeout	(4 * NetworkTime)	// any round trip times
+#define MaxTimeout	(500 * NetworkTime)
+
+enum SegmentType { DataSegment, AckSegment };
+
+// The following class defines the transport header, which is put in
+// front of the message data, inside the Post Office's mail.
+
+class SegmentHeader {
+  public:
+    int type;				// DataSegment or AckSegment
+    int seq;				// Data: sequence # of this message
+					// ACK: next sequence # expected
+};
+
+// Largest message that can be sent over a connection
+#define MaxSegmentSize	(MaxMailSize - sizeof(SegmentHeader))
+
+// A message in the send window (waiting to be acknowledged), or in the
+// receive window (waiting for the ones before it).
+
+class Segment {
+  public:
+    int length;				// Bytes of data
+    char data[MaxSegmentSize];		// The data
+    int sentAt;				// When we last sent it
+    bool retransmitted;			// Has it been sent more than once?
+    bool present;			// (receive window) has it arrived?
+};
+
+// The following class defines one end of a reliable connection.
+
+class Connection {
+  public:
+    Connection(int localBox, NetworkAddress farAddr, int farBox,
+						int window = DefaultWindow);
+				// Set up our end of a connection between
+				// "localBox" here and "farBox" on machine
+				// "farAddr", sending at most "window"
+				// unacknowledged messages at a time
+
+    void Send(char *data, int length);
+				// Send a message; waits if the window
+				// is full
+    int Receive(char *data);	// Wait for the next message, copy it into
+				// "data", and return its length
+    void Flush();		// Wait until everything sent so far
+				// has been acknowledged
+
+    void PrintStats();		// Print how many segments we sent,
+				// resent, and so on
+
+    void ReceiveSegments();	// Body of the receiver thread
+    void RetransmitSegments();	// Body of the retransmitter thread
+    void TimerExpired();	// Interrupt handler for the retransmit timer
+
+  private:
+    int localBox;		// Our mailbox
+    NetworkAddress farAddr;	// Where the other end is
+    int farBox;
+    int window;			// Max # of messages outstanding
+
+    Lock *lock;			// Protects everything below
+    Condition *windowOpen;	// Signalled when messages are acked
+    Condition *dataArrived;	// Signalled when messages are delivered
+
+    Segment *sendWindow;	// Sent, not yet acknowledged messages,
+    int sendBase;		// sendBase up to nextSeq - 1
+    int nextSeq;
+    int dupAcks;		// # of ACKs in a row for sendBase
+
+    int srtt;			// Smoothed round trip time, times 8
+    int rttvar;			// Its mean deviation, times 4
+    int timeout;		// Current retransmission timeout
+    bool timerOn;		// Is the retransmit timer running?
+    int timerDeadline;		// When it will go off
+    int timerScheduled;		// When the last interrupt we scheduled
+				// for it will happen
+    Semaphore *timerFired;	// V'ed by the timer interrupt
+
+    Segment *recvWindow;	// Messages that arrived out of order
+    int recvNext;		// Next sequence # we expect
+    List *delivered;		// Messages ready for Receive, in order
+
+    int segmentsSent;		// Statistics
+    int retransmits, timeouts, fastRetransmits;
+    int dupsReceived;
+
+    void Transmit(int seq);	// Send message "seq" from the window
+    void SendAck();		// Tell the other end what we expect next
+    void HandleAck(int ack);	// Process an ACK
+    void HandleData(int seq, char *data, int length);
+				// Process an arriving message
+    void StartTimer();		// (Re)start the retransmit timer
+    void SampleRtt(int rtt);	// Fold a round trip time into the timeout
+};
+
+#endif // TRANSPORT_H
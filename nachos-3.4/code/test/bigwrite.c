@@ -0,0 +1,34 @@
+/* bigwrite.c
+ *	Simple program to measure how fast the kernel moves large user
+ *	buffers in a system call.
+ *
+ *	Write 1 MB to the console, in writes as big as fit in our little
+ *	address space (main memory is only a few KB), and shut down.  Run
+ *	it as
+ *
+ *		./nachos -x ../test/bigwrite | tail -8
+ *
+ *	and compare the system ticks with those for conwrite, which
+ *	writes the same 1 MB a line at a time.
+ */
+
+#include "syscall.h"
+
+#define BufferSize	2048
+#define TotalSize	(1024 * 1024)
+
+char buffer[BufferSize];
+
+int
+main()
+{
+    int i;
+
+    for (i = 0; i < BufferSize; i++)
+	buffer[i] = (i % 64 == 63) ? '\n' : 'a' + (i % 26);
+
+    for (i = 0; i < TotalSize; i += BufferSize)
+	Write(buffer, BufferSize, ConsoleOutput);
+    Halt();
+    /* not reached */
+}
@@ -0,0 +1,35 @@
+/* conwrite.c
+ *	Simple program to measure how fast user programs can write to the
+ *	console.
+ *
+ *	Write 1 MB to the console, a line at a time, and shut down.  Run
+ *	it as
+ *
+ *		./nachos -x ../test/conwrite | tail -8
+ *
+ *	to see just the statistics Nachos prints at the end; bytes/second
+ *	is the bytes written over the total ticks (and, for the host, over
+ *	the real time "time" reports).  The "bursts" in the console line
+ *	say how many UNIX writes it took.
+ */
+
+#include "syscall.h"
+
+#define LineSize	64
+#define TotalSize	(1024 * 1024)
+
+int
+main()
+{
+    char line[LineSize];
+    int i;
+
+    for (i = 0; i < LineSize - 1; i++)
+	line[i] = 'a' + (i % 26);
+    line[LineSize - 1] = '\n';
+
+    for (i = 0; i < TotalSize; i += LineSize)
+	Write(line, LineSize, ConsoleOutput);
+    Halt();
+    /* not reached */
+}
@@ -0,0 +1,97 @@
+/* iobench.c
+ *	Simple program to measure file I/O through the system calls.
+ *
+ *	Write a 256 KB file front to back, read it back the same way,
+ *	then read and write blocks of it in random order (with Seek),
+ *	checking that each block holds what was last written there.
+ *	Blocks are as big as fit in our little address space.  Prints
+ *	a complaint if the data is wrong.  Run it as
+ *
+ *		./nachos -x ../test/iobench | tail -8
+ *
+ *	(It leaves the file, "iobench.dat", behind.)
+ */
+
+#include "syscall.h"
+
+#define BlockSize	1024
+#define NumBlocks	256
+#define RandomOps	512
+
+char buffer[BlockSize];
+
+/* Fill the buffer with a pattern made from "tag". */
+void
+Fill(int tag)
+{
+    int i;
+
+    for (i = 0; i < BlockSize; i++)
+	buffer[i] = tag + i;
+}
+
+/* Return 1 if the buffer holds the pattern made from "tag". */
+int
+Check(int tag)
+{
+    int i;
+
+    for (i = 0; i < BlockSize; i++)
+	if (buffer[i] != (char) (tag + i))
+	    return 0;
+    return 1;
+}
+
+void
+Complain(char *what)
+{
+    int n;
+
+    for (n = 0; what[n] != '\0'; n++)
+	;
+    Write(what, n, ConsoleOutput);
+}
+
+int tags[NumBlocks];		/* what was last written to each block */
+
+int
+main()
+{
+    OpenFileId f;
+    int i, block, seed = 1;
+
+    Create("iobench.dat");
+    f = Open("iobench.dat");
+    if (f < 0) {
+	Complain("iobench: can't open iobench.dat\n");
+	Halt();
+    }
+
+    for (i = 0; i < NumBlocks; i++) {		/* sequential write */
+	tags[i] = i;
+	Fill(i);
+	Write(buffer, BlockSize, f);
+    }
+
+    Seek(0, f);
+    for (i = 0; i < NumBlocks; i++)		/* sequential read */
+	if (Read(buffer, BlockSize, f) != BlockSize || !Check(tags[i]))
+	    Complain("iobench: sequential read is wrong\n");
+
+    for (i = 0; i < RandomOps; i++) {		/* random read/write */
+	seed = seed * 1103515245 + 12345;
+	block = ((unsigned) seed >> 8) % NumBlocks;
+	Seek(block * BlockSize, f);
+	if (i & 1) {
+	    tags[block] = i;
+	    Fill(i);
+	    Write(buffer, BlockSize, f);
+	} else if (Read(buffer, BlockSize, f) != BlockSize
+						|| !Check(tags[block]))
+	    Complain("iobench: random read is wrong\n");
+    }
+
+    Close(f);
+    Halt();
+    /* not reached */
+}
@@ -3,6 +3,13 @@
  *
  *    Intended to stress virtual memory system.
  *
+ *    Also makes a parallel benchmark: run several copies at once, on
+ *    more and more CPUs, with enough memory for them all, e.g.
+ *
+ *	./nachos -mem 512 -cpus 4 -xn 8 ../test/matmult
+ *
+ *    and compare the elapsed ticks and speedup printed at the end.
+ *
  *    Ideally, we could read the matrices off of the file system,
  *	and store the result back to the file system!
  */
@@ -130,6 +130,22 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl Seek
+	.ent	Seek
+Seek:
+	addiu $2,$0,SC_Seek
+	syscall
+	j	$31
+	.end Seek
+
+	.globl GetUsage
+	.ent	GetUsage
+GetUsage:
+	addiu $2,$0,SC_GetUsage
+	syscall
+	j	$31
+	.end GetUsage
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,69 @@
+/* usage.c
+ *	Simple program to show the GetUsage system call.
+ *
+ *	Do some work, writing to the console now and then, and print how
+ *	much CPU time this thread, this program and the whole machine
+ *	have had.  Run several copies at once, so that they have to share,
+ *	with
+ *
+ *		./nachos -rs 1 -xn 3 ../test/usage
+ *
+ *	and compare with the table Nachos prints when it halts.
+ */
+
+#include "syscall.h"
+
+#define Rounds		20
+#define Work		5000
+
+/* Write "n" in decimal to the console, after "label". */
+void
+PutNumber(char *label, int n)
+{
+    char digits[12];
+    int i = 12, length;
+
+    for (length = 0; label[length] != '\0'; length++)
+	;
+    Write(label, length, ConsoleOutput);
+    do {
+	digits[--i] = '0' + n % 10;
+	n /= 10;
+    } while (n > 0);
+    Write(digits + i, 12 - i, ConsoleOutput);
+}
+
+/* Print one line of usage, for "who". */
+void
+PutUsage(char *name, int who)
+{
+    UsageInfo usage;
+
+    if (GetUsage(who, &usage) < 0)
+	return;
+    PutNumber(name, usage.userTicks);
+    PutNumber(" user, system ", usage.systemTicks);
+    PutNumber(", ready ", usage.readyTicks);
+    PutNumber(", blocked ", usage.blockedTicks);
+    PutNumber(", switches ", usage.voluntarySwitches);
+    PutNumber("+", usage.involuntarySwitches);
+    PutNumber(", at time ", usage.totalTicks);
+    Write("\n", 1, ConsoleOutput);
+}
+
+int
+main()
+{
+    int i, j, sum = 0;
+
+    for (i = 0; i < Rounds; i++) {
+	for (j = 0; j < Work; j++)
+	    sum += i * j;
+	Write(".", 1, ConsoleOutput);
+    }
+    Write("\n", 1, ConsoleOutput);
+    PutUsage("thread: ", UsageThread);
+    PutUsage("program: ", UsageProcess);
+    PutUsage("machine: ", UsageSystem);
+    Exit(0);
+}
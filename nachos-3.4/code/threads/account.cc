@@ -0,0 +1,155 @@
+// account.cc
+//	Routines to keep, add up and print the accounts of threads and
+//	user programs.  See account.h.
+
+#include "copyright.h"
+#include "account.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Accounting::Accounting
+// 	Set up an empty table of accounts.
+//----------------------------------------------------------------------
+
+Accounting::Accounting()
+{
+    accounts = new Account *[InitialAccounts];
+    numAccounts = 0;
+    maxAccounts = InitialAccounts;
+}
+
+//----------------------------------------------------------------------
+// Accounting::~Accounting
+//----------------------------------------------------------------------
+
+Accounting::~Accounting()
+{
+    for (int i = 0; i < numAccounts; i++)
+	delete accounts[i];
+    delete [] accounts;
+}
+
+//----------------------------------------------------------------------
+// Accounting::New
+// 	Return a new account, with nothing charged to it yet, for the
+//	thread or user program "name".  If the table is full, make it
+//	twice as big first; every thread and program gets an account of
+//	its own.
+//----------------------------------------------------------------------
+
+Account *
+Accounting::New(char *name, bool isProcess)
+{
+    Account *account, **bigger;
+
+    if (numAccounts == maxAccounts) {
+	bigger = new Account *[2 * maxAccounts];
+	for (int i = 0; i < numAccounts; i++)
+	    bigger[i] = accounts[i];
+	delete [] accounts;
+	accounts = bigger;
+	maxAccounts *= 2;
+    }
+    account = new Account;
+    strncpy(account->name, name, AccountNameSize - 1);
+    account->name[AccountNameSize - 1] = '\0';
+    account->id = numAccounts;
+    account->isProcess = isProcess;
+    account->process = NULL;
+    account->done = FALSE;
+    account->userTicks = account->systemTicks = 0;
+    account->readyTicks = account->blockedTicks = 0;
+    account->voluntarySwitches = account->involuntarySwitches = 0;
+    account->since = stats->totalTicks;
+    accounts[numAccounts++] = account;
+    return account;
+}
+
+Account *
+Accounting::NewThread(char *name)
+{
+    return New(name, FALSE);
+}
+
+Account *
+Accounting::NewProcess(char *name)
+{
+    return New(name, TRUE);
+}
+
+//----------------------------------------------------------------------
+// Accounting::Total
+// 	Set "total" to the sum of the accounts of the threads that ran
+//	in "process", or of every thread, if "process" is NULL.
+//----------------------------------------------------------------------
+
+void
+Accounting::Total(Account *process, Account *total)
+{
+    Account *account;
+
+    total->userTicks = total->systemTicks = 0;
+    total->readyTicks = total->blockedTicks = 0;
+    total->voluntarySwitches = total->involuntarySwitches = 0;
+    for (int i = 0; i < numAccounts; i++) {
+	account = accounts[i];
+	if (account->isProcess
+		|| ((process != NULL) && (account->process != process)))
+	    continue;
+	total->userTicks += account->userTicks;
+	total->systemTicks += account->systemTicks;
+	total->readyTicks += account->readyTicks;
+	total->blockedTicks += account->blockedTicks;
+	total->voluntarySwitches += account->voluntarySwitches;
+	total->involuntarySwitches += account->involuntarySwitches;
+    }
+}
+
+//----------------------------------------------------------------------
+// Accounting::Print
+// 	Print a table of the accounts, like top: the threads, then the
+//	user programs, each busiest first, with the share of all the CPU
+//	time each had.  A program's line adds up its threads.
+//----------------------------------------------------------------------
+
+void
+Accounting::Print()
+{
+    Account **order = new Account *[numAccounts];	// (too big for a
+    Account *totals = new Account[numAccounts];		// thread's stack)
+    Account *account;
+    int i, j, busy = stats->userTicks + stats->systemTicks;
+
+    for (i = 0; i < numAccounts; i++) {	// programs' times first
+	account = accounts[i];
+	totals[i] = *account;
+	if (account->isProcess)
+	    Total(account, &totals[i]);
+    }
+    for (i = 0; i < numAccounts; i++) {	// threads first, then busiest
+	account = &totals[i];
+	for (j = i; (j > 0) && ((order[j - 1]->isProcess > account->isProcess)
+		|| ((order[j - 1]->isProcess == account->isProcess)
+		    && (order[j - 1]->CpuTicks() < account->CpuTicks())));
+									j--)
+	    order[j] = order[j - 1];
+	order[j] = account;
+    }
+
+    printf("\n  ID %-20s %9s %9s %6s %9s %9s %6s %6s %s\n", "THREAD", "USER",
+	    "SYSTEM", "CPU%", "READY", "BLOCKED", "VOL", "INVOL", "STATE");
+    for (i = 0; i < numAccounts; i++) {
+	account = order[i];
+	if (account->isProcess && ((i == 0) || !order[i - 1]->isProcess))
+	    printf("  ID %-20s\n", "PROGRAM");
+	printf("%4d %-20.20s %9d %9d %6.1f %9d %9d %6d %6d %s\n",
+	    account->id, account->name, account->userTicks,
+	    account->systemTicks,
+	    busy ? 100.0 * account->CpuTicks() / busy : 0.0,
+	    account->readyTicks, account->blockedTicks,
+	    account->voluntarySwitches, account->involuntarySwitches,
+	    account->done ? "done" : "");
+    }
+    delete [] order;
+    delete [] totals;
+}
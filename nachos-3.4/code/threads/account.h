@@ -0,0 +1,83 @@
+// account.h
+//	Data structures for keeping track of how much CPU time each
+//	thread, and each user program, has had, and how it fared with
+//	the scheduler.
+//
+//	Every thread has an account (cf. Thread::account).  Each tick it
+//	runs is charged to it, as user or system time (cf.
+//	Interrupt::OneTick).  Each change of its status adds the time
+//	since the last change to the time it has spent waiting on a ready
+//	list, or blocked, if that's what it was doing (cf.
+//	Thread::setStatus).  Each time it gives up the CPU is a context
+//	switch: involuntary if the timer took the CPU away, voluntary if
+//	it yielded or blocked.
+//
+//	A user program (an address space) has an account too, which the
+//	threads running in it point to; its times are those of its
+//	threads, added up when they're wanted.
+//
+//	Accounts outlive their threads and programs, so that they can all
+//	be printed, busiest first, when Nachos halts.  User programs can
+//	read their own with the GetUsage system call.
+//
+//	On a multiprocessor, the CPUs' clocks are never quite together
+//	(cf. cpu.h), so a thread that moves to another CPU may seem to
+//	have waited a little less than it did, though never less than
+//	nothing.
+
+#include "copyright.h"
+
+#ifndef ACCOUNT_H
+#define ACCOUNT_H
+
+#define InitialAccounts		64	// room in the table to start with;
+					// it doubles whenever it fills
+#define AccountNameSize		32	// longest name kept, plus one
+
+// The following class defines the account of a thread, or a user
+// program.
+
+class Account {
+  public:
+    char name[AccountNameSize];
+    int id;			// Its number, in order of creation
+    bool isProcess;		// A user program's, not a thread's?
+    Account *process;		// For a thread, the program it runs; NULL
+				// if none
+    bool done;			// Thread finished, or program exited?
+
+    int userTicks;		// Time spent running user code,
+    int systemTicks;		//   and in the kernel
+    int readyTicks;		// Time spent waiting on a ready list
+    int blockedTicks;		// Time spent blocked
+    int voluntarySwitches;	// Times it gave up the CPU itself
+    int involuntarySwitches;	// Times the timer took the CPU away
+    int since;			// When its status last changed
+
+    int CpuTicks() { return userTicks + systemTicks; }
+};
+
+// The following class defines the table of every account.
+
+class Accounting {
+  public:
+    Accounting();
+    ~Accounting();
+
+    Account *NewThread(char *name);	// An account for a new thread,
+    Account *NewProcess(char *name);	//   or user program
+    void Total(Account *process, Account *total);
+					// Add up the threads of "process"
+					// (or every thread, if NULL)
+					// into "total"
+    void Print();			// Print every account, busiest first
+
+  private:
+    Account **accounts;
+    int numAccounts;
+    int maxAccounts;			// Room in "accounts"
+
+    Account *New(char *name, bool isProcess);
+};
+
+#endif // ACCOUNT_H
@@ -0,0 +1,385 @@
+// cpu.cc
+//	Routines to simulate a multiprocessor, by giving each CPU a turn
+//	in a fixed order.  See cpu.h.
+
+#include "copyright.h"
+#include "cpu.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// IdleLoop
+// 	What a CPU runs when it has nothing else to: look for a thread to
+//	run (taking one from another CPU if need be); if there isn't one,
+//	wait until there might be.
+//
+//	The idle thread is never on a ready list.  When it finds a thread
+//	to run, it just sleeps, until the CPU next runs out of things to do
+//	(cf. Thread::Sleep).
+//----------------------------------------------------------------------
+
+static void
+IdleLoop(int which)
+{
+    Thread *next;
+    IntStatus oldLevel;
+
+    for (;;) {
+	oldLevel = interrupt->SetLevel(IntOff);
+	if ((next = scheduler->FindNextToRun()) != NULL) {
+	    currentThread->setStatus(BLOCKED);
+	    scheduler->Run(next);
+	}
+	(void) interrupt->SetLevel(oldLevel);
+	if (next == NULL)
+	    smp->Idle();
+    }
+}
+
+//----------------------------------------------------------------------
+// Cpu::Cpu
+// 	Set up a CPU, with nothing to run but its idle thread.  CPU 0 uses
+//	the machine's own TLB to start with; the others get one each.
+//----------------------------------------------------------------------
+
+Cpu::Cpu(int which)
+{
+    char *name = new char[16];
+
+    id = which;
+    readyList = new List;
+    sprintf(name, "idle cpu %d", id);
+    idleThread = new Thread(name);
+    idleThread->StackAllocate(IdleLoop, id);
+    current = idleThread;
+    clock = stats->totalTicks;
+    idleTicks = 0;
+    steals = 0;
+    status = SystemMode;
+
+#ifdef USER_PROGRAM
+    for (int i = 0; i < NumTotalRegs; i++)
+	registers[i] = 0;
+    tlb = NULL;
+#ifdef USE_TLB
+    if (id != 0) {
+	tlb = new TranslationEntry[TLBSize];
+	for (int i = 0; i < TLBSize; i++)
+	    tlb[i].valid = FALSE;
+    }
+#endif
+    pageTable = NULL;
+    pageTableSize = 0;
+    runner = NULL;
+    ahead = 0;
+    aheadTicks = 0;
+#endif
+}
+
+//----------------------------------------------------------------------
+// Cpu::~Cpu
+// 	De-allocate a CPU.  Its idle thread can't go, since it may be the
+//	one running.
+//----------------------------------------------------------------------
+
+Cpu::~Cpu()
+{
+    delete readyList;
+#ifdef USER_PROGRAM
+    if (tlb != NULL)
+	delete [] tlb;
+    if (runner != NULL)
+	delete runner;
+#endif
+}
+
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// Cpu::RunAhead
+// 	Run the CPU's user code on its own Machine, as far as it can go
+//	before "aheadLimit", and set "ahead" to how long that took.  This
+//	runs on a host thread of its own, alongside the other CPUs', so it
+//	must only touch the CPU's own state (and its program's memory).
+//----------------------------------------------------------------------
+
+void
+Cpu::RunAhead()
+{
+    bcopy((char *) registers, (char *) runner->registers, sizeof(registers));
+    runner->tlb = tlb;
+    runner->pageTable = pageTable;
+    runner->pageTableSize = pageTableSize;
+    ahead = runner->RunAhead(aheadLimit - clock);
+    bcopy((char *) runner->registers, (char *) registers, sizeof(registers));
+    runner->tlb = NULL;			// so it isn't deleted with runner
+}
+
+static Cpu *aheadCpus[MaxCpus];		// the CPUs running ahead this round
+
+static void
+RunAheadCpu(int which)
+{
+    aheadCpus[which]->RunAhead();
+}
+#endif
+
+//----------------------------------------------------------------------
+// Multiprocessor::Multiprocessor
+// 	Set up the CPUs.  The thread running now carries on, on CPU 0.
+//----------------------------------------------------------------------
+
+Multiprocessor::Multiprocessor(int n, int ticks, bool parallel)
+{
+    ASSERT((n > 0) && (n <= MaxCpus));
+    ASSERT(ticks > 0);
+    numCpus = n;
+    for (int i = 0; i < numCpus; i++)
+	cpus[i] = new Cpu(i);
+    cpus[0]->current = currentThread;
+    current = 0;
+    slice = ticks;
+    roundEnd = stats->totalTicks + slice;
+    hostParallel = parallel;
+}
+
+Multiprocessor::~Multiprocessor()
+{
+    for (int i = 0; i < numCpus; i++)
+	delete cpus[i];
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::CheckSlice
+// 	Called after each tick, with interrupts on.  If the CPU running
+//	has reached the end of its slice, give the next one its turn.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::CheckSlice()
+{
+    if (stats->totalTicks >= roundEnd)
+	NextCpu();
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::NextCpu
+// 	Put away the state of the CPU running now, and switch to the next
+//	one, where it left off.  After the last CPU, a new round starts.
+//	A CPU whose clock is behind the start of its turn (because it had
+//	nothing to do) catches up, idle, first.  With -hostpar, a round
+//	starts with the CPUs running user code running ahead.
+//
+//	Returns when this CPU's next turn comes around.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::NextCpu()
+{
+    Cpu *from = cpus[current], *to;
+    Thread *oldThread = currentThread;
+    int start;
+
+    from->clock = stats->totalTicks;
+    from->current = currentThread;
+    from->status = interrupt->getStatus();
+#ifdef USER_PROGRAM
+    if (machine != NULL) {
+	bcopy((char *) machine->registers, (char *) from->registers,
+						sizeof(from->registers));
+	from->tlb = machine->tlb;
+	from->pageTable = machine->pageTable;
+	from->pageTableSize = machine->pageTableSize;
+    }
+#endif
+
+    current = (current + 1) % numCpus;
+    if (current == 0) {
+	roundEnd += slice;
+	if (hostParallel)
+	    RunAhead();
+    }
+    to = cpus[current];
+    start = roundEnd - slice;
+    if (to->clock < start) {
+	to->idleTicks += start - to->clock;
+	stats->idleTicks += start - to->clock;
+	to->clock = start;
+    }
+
+    stats->totalTicks = to->clock;
+    interrupt->setStatus(to->status);
+#ifdef USER_PROGRAM
+    if (machine != NULL) {
+	bcopy((char *) to->registers, (char *) machine->registers,
+						sizeof(to->registers));
+	machine->tlb = to->tlb;
+	to->tlb = NULL;			// it's the machine's while it runs
+	machine->pageTable = to->pageTable;
+	machine->pageTableSize = to->pageTableSize;
+    }
+#endif
+    currentThread = to->current;
+
+    DEBUG('t', "CPU %d's turn, at time %d, running \"%s\"\n", current,
+				stats->totalTicks, currentThread->getName());
+    if (currentThread != oldThread)
+	SWITCH(oldThread, currentThread);
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::RunAhead
+// 	At the start of a round, with every CPU's state put away, let
+//	each CPU that is running user code run ahead with it, all at once
+//	on host threads of their own (cf. cpu.h).  Then charge the time
+//	each ran to its clock, so that its turn starts from there.
+//
+//	A CPU may run up to the end of the round, or on CPU 0, up to when
+//	the next interrupt is due; it stops short of either, so that its
+//	turn still ends, or the interrupt still fires, after the same
+//	instruction as it would have.  A CPU whose address space another
+//	CPU is running in too stays put, as does everyone, if anything
+//	needs to look at each instruction as it runs.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::RunAhead()
+{
+#ifdef USER_PROGRAM
+    Cpu *cpu;
+    int i, j, n = 0, due;
+
+    if ((machine == NULL) || (checkpointName != NULL) || (profiler != NULL)
+		|| stats->histograms || DebugIsEnabled('m')
+		|| DebugIsEnabled('a'))
+	return;
+    for (i = 0; i < numCpus; i++) {
+	cpu = cpus[i];
+	if ((cpu->status != UserMode) || (cpu->current->space == NULL)
+					|| (cpu->clock < roundEnd - slice))
+	    continue;
+	for (j = 0; j < numCpus; j++)
+	    if ((j != i) && (cpus[j]->status == UserMode)
+			&& (cpus[j]->current->space == cpu->current->space))
+		break;
+	if (j < numCpus)
+	    continue;			// it shares its memory
+	cpu->aheadLimit = roundEnd;
+	if ((i == 0) && interrupt->NextDue(&due) && (due < roundEnd))
+	    cpu->aheadLimit = due;
+	if (cpu->aheadLimit - cpu->clock <= UserTick)
+	    continue;
+	if (cpu->runner == NULL)
+	    cpu->runner = new Machine(machine);
+	cpu->runner->mainMemory = machine->mainMemory;
+	aheadCpus[n++] = cpu;
+    }
+
+    RunOnHostThreads(RunAheadCpu, n);
+
+    for (i = 0; i < n; i++) {
+	cpu = aheadCpus[i];
+	DEBUG('t', "CPU %d ran ahead from time %d to %d\n", cpu->id,
+					cpu->clock, cpu->clock + cpu->ahead);
+	cpu->clock += cpu->ahead;
+	cpu->aheadTicks += cpu->ahead;
+	stats->userTicks += cpu->ahead;
+	cpu->current->account->userTicks += cpu->ahead;
+    }
+#endif
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::AllIdle
+// 	Return TRUE if every CPU but this one is running its idle thread,
+//	and no thread is waiting to run.
+//----------------------------------------------------------------------
+
+bool
+Multiprocessor::AllIdle()
+{
+    for (int i = 0; i < numCpus; i++)
+	if ((i != current) && (cpus[i]->current != cpus[i]->idleThread))
+	    return FALSE;
+    return scheduler->IsEmpty();
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Idle
+// 	Called by a CPU's idle thread, with interrupts on, when there is
+//	nothing for it to run.
+//
+//	On CPU 0, fire any interrupt due before the end of the slice,
+//	first rolling its clock forward to it, since that may give us
+//	something to do.  If nothing is due, and no CPU has anything to
+//	do either, the whole machine is idle: roll time forward to the
+//	next interrupt (cf. Interrupt::Idle), and start a new round then.
+//
+//	Otherwise, the CPU sits out the rest of its slice.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::Idle()
+{
+    Cpu *cpu = cpus[current];
+    IntStatus oldLevel;
+    bool fired = FALSE;
+    int before = stats->totalTicks, end = roundEnd;
+
+    if (current == 0) {
+	oldLevel = interrupt->SetLevel(IntOff);
+	if (interrupt->IdleUntil(roundEnd))
+	    fired = TRUE;
+	else if (AllIdle()) {
+	    interrupt->Idle();		// halts if nothing is pending
+	    roundEnd = stats->totalTicks + slice;
+	    fired = TRUE;
+	}
+	cpu->idleTicks += stats->totalTicks - before;
+	(void) interrupt->SetLevel(oldLevel);
+	if (fired || (roundEnd != end))
+	    return;			// go look for something to run
+    }
+
+    if (stats->totalTicks < roundEnd) {
+	cpu->idleTicks += roundEnd - stats->totalTicks;
+	stats->idleTicks += roundEnd - stats->totalTicks;
+	stats->totalTicks = roundEnd;
+    }
+    NextCpu();
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Print
+// 	Print how busy each CPU was, and how many threads it took from
+//	the others, then how much faster the work went than on one CPU:
+//	the time all the CPUs were busy, over the time it took.  With
+//	-hostpar, also print how much of the work ran on host threads.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::Print()
+{
+    int i, busy, totalBusy = 0, elapsed = 0;
+
+    cpus[current]->clock = stats->totalTicks;
+    for (i = 0; i < numCpus; i++) {
+	busy = cpus[i]->clock - cpus[i]->idleTicks;
+	totalBusy += busy;
+	if (cpus[i]->clock > elapsed)
+	    elapsed = cpus[i]->clock;
+	printf("CPU %d: busy ticks %d, idle ticks %d, threads stolen %d\n",
+			i, busy, cpus[i]->idleTicks, cpus[i]->steals);
+    }
+    if (elapsed > 0)
+	printf("CPUs: %d, elapsed ticks %d, speedup %.2f\n", numCpus,
+			elapsed, (double) totalBusy / elapsed);
+#ifdef USER_PROGRAM
+    if (hostParallel) {
+	int ahead = 0;
+
+	for (i = 0; i < numCpus; i++)
+	    ahead += cpus[i]->aheadTicks;
+	printf("Host-parallel: slice %d, ticks run ahead %d of %d busy\n",
+			slice, ahead, totalBusy);
+    }
+#endif
+}
@@ -0,0 +1,125 @@
+// cpu.h
+//	Data structures for simulating a multiprocessor: several CPUs
+//	sharing main memory, the devices and the kernel (-cpus).
+//
+//	Each CPU has its own registers, TLB and page table register, its
+//	own current thread, and its own queue of threads ready to run
+//	(cf. scheduler.h).  There is still only one UNIX thread, so the
+//	CPUs take turns: in each round, every CPU in order runs until its
+//	own clock reaches the end of the round, a slice (-slice, CpuSlice by
+//	default) on.  So no CPU's clock gets more than a slice ahead of the
+//	others', and since the turns are fixed, a run is exactly repeatable.
+//	stats->totalTicks is the clock of whichever CPU is running.
+//
+//	Devices, and the timer, interrupt CPU 0 only.  A CPU only hands
+//	over to the next at a tick with interrupts on (cf. OneTick), so
+//	turning interrupts off keeps the other CPUs out as well -- like a
+//	spinlock around the whole kernel -- and Semaphores, Locks and
+//	Conditions work unchanged.
+//
+//	A CPU with nothing in its queue takes a thread from another CPU's
+//	queue; failing that, it runs its idle thread, which waits out the
+//	rest of its slice.
+//
+//	With -hostpar, the CPUs running user code run it on host threads
+//	of their own, at once, at the start of each round: each runs ahead
+//	on a Machine of its own (cf. Machine::RunAhead), up to the first
+//	instruction that would trap, or that ends the slice or (on CPU 0)
+//	is when an interrupt is due.  The rest of the round then goes as
+//	before, with each CPU carrying on from where it got to; the kernel
+//	still only ever runs on one host thread, so it needs no host locks.
+//	A user program can only touch its own memory, so running it early
+//	can't change what it does -- unless two CPUs run threads of one
+//	address space, and then neither runs ahead.  So the simulated
+//	results (every clock, and every statistic) are exactly the same as
+//	without -hostpar; for CPU-bound programs, make the slice long, so
+//	that most of the work is done in parallel.
+
+#include "copyright.h"
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "list.h"
+#include "thread.h"
+#include "interrupt.h"
+#ifdef USER_PROGRAM
+#include "machine.h"
+#endif
+
+#define MaxCpus		16	// most CPUs we can simulate
+#define CpuSlice	100	// default ticks each CPU runs before the next
+				// one's turn
+
+// The following class defines the state of one CPU, while it isn't
+// the one running.
+
+class Cpu {
+  public:
+    Cpu(int id);
+    ~Cpu();
+
+    int id;
+    List *readyList;		// Threads waiting to run on this CPU
+    Thread *current;		// Thread it was running when its turn ended
+    Thread *idleThread;		// Thread it runs when there's nothing else
+    int clock;			// Its time, when its turn ended
+    int idleTicks;		// Time it had nothing to run
+    int steals;			// Threads it took from other CPUs' queues
+    MachineStatus status;	// Idle, kernel mode or user mode
+
+#ifdef USER_PROGRAM
+    int registers[NumTotalRegs];	// Its user-level registers,
+    TranslationEntry *tlb;		// TLB,
+    TranslationEntry *pageTable;	// and page table register
+    unsigned int pageTableSize;
+
+    Machine *runner;			// Runs its user code ahead, with -hostpar
+    int aheadLimit;			// How far ahead it may run,
+    int ahead;				// and how far it did
+    int aheadTicks;			// Time it has spent running ahead
+
+    void RunAhead();			// Run ahead, on a host thread
+#endif
+};
+
+// The following class defines the multiprocessor: the CPUs, and
+// whose turn it is.
+
+class Multiprocessor {
+  public:
+    Multiprocessor(int numCpus, int slice, bool hostParallel);
+					// Set up "numCpus" CPUs, taking turns
+					// of "slice" ticks; the thread running
+					// now is on CPU 0
+    ~Multiprocessor();
+
+    int NumCpus() { return numCpus; }
+    int CurrentId() { return current; }	// The CPU running now
+    Cpu *GetCpu(int id) { return cpus[id]; }
+    Thread *IdleThread() { return cpus[current]->idleThread; }
+
+    void CheckSlice();			// Called each tick, with interrupts
+					// on: let the next CPU run, if this
+					// one has had its slice
+    void Idle();			// This CPU has nothing to run; wait
+					// for something to show up, or for
+					// the end of its slice
+
+    void Print();			// Print how busy each CPU was
+
+  private:
+    Cpu *cpus[MaxCpus];
+    int numCpus;
+    int current;			// CPU whose turn it is
+    int roundEnd;			// When its turn ends
+    int slice;				// How long each turn is
+    bool hostParallel;			// Run user code on host threads?
+
+    void NextCpu();			// Switch to the next CPU's turn
+    bool AllIdle();			// Is there nothing to run anywhere?
+    void RunAhead();			// Run every CPU that can ahead, at
+					// the start of a round
+};
+
+#endif // CPU_H
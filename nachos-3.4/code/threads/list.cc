@@ -127,6 +127,22 @@ List::Remove()
     return SortedRemove(NULL);  // Same as SortedRemove, but ignore the key
 }
 
+//----------------------------------------------------------------------
+// List::Front
+//      Return the item on the front of the list, leaving it there.
+//
+// Returns:
+//	Pointer to the item, NULL if nothing on the list.
+//----------------------------------------------------------------------
+
+void *
+List::Front()
+{
+    if (IsEmpty()) 
+	return NULL;
+    return first->item;
+}
+
 //----------------------------------------------------------------------
 // List::Mapcar
 //	Apply a function to each item on the list, by walking through  
@@ -9,35 +9,94 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-record <log file> -replay <log file> -trace <trace file>
+//		-cpus <# cpus> -slice <ticks>
+//		-s -hostpar -x <nachos file> -xn <# copies> <nachos file>
+//		-mem <# pages> -prof <ticks> -hist -histcsv <csv file>
+//		-c <consoleIn> <consoleOut>
+//		-ckpt <time> <checkpoint file> -restore <checkpoint file>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
+//		-mkdir <nachos dir> -td <# files> -tc <# threads>
+//		-lfs -tw <# files> -dsync <never|halt|write>
+//		-geometry <# tracks> <# sectors per track> -disks <# disks>
+//		-stripe <# sectors> -ts <# sectors>
 //              -n <network reliability> -m <machine id>
-//              -o <other machine id>
+//              -o <other machine id> -tr <other machine id> <window>
+//              -tm <other machine id> -tp <other machine id>
+//              -nodes <# machines> -tf
+//              -trpc <other machine id> <# threads>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -record logs the random seed, console input and network input, with
+//	the time each arrived, so that the run can be repeated exactly
+//    -replay repeats a recorded run, taking its input from the log
+//    -trace writes a timeline of kernel events to a file when Nachos halts,
+//	in Chrome trace format (open it in chrome://tracing or Perfetto)
+//    -cpus simulates a multiprocessor with that many CPUs (cf. cpu.h)
+//    -slice sets how many ticks each CPU runs before the next one's turn
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -hostpar runs the CPUs' user code on host threads, in parallel,
+//	with the same results as without it
 //    -x runs a user program
+//    -xn runs that many copies of a user program at once
+//    -mem sets the number of pages of main memory
+//    -prof profiles user programs, sampling the PC every so many ticks of
+//	user time, and prints where they spent it when Nachos halts
+//	(cf. userprog/profile.h)
+//    -hist counts the instructions user programs run, by opcode, their
+//	branches, system calls, exceptions and memory accesses by page, and
+//	prints the counts with the other statistics (cf. machine/stats.h);
+//	-histcsv writes them to a file instead, as CSV
 //    -c tests the console
+//    -ckpt saves the machine and the running user program to a file, at
+//	the given time (or as soon after as the machine is quiet)
+//    -restore runs the user program saved in a checkpoint, from where it
+//	left off (with FILESYS, the disk is put back as it was, too)
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -lfs, with -f, formats the disk as a log (cf. filesys/logdisk.h)
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -r removes a Nachos file (or empty directory) from the file system
+//    -l lists the contents of the Nachos root directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -mkdir creates a Nachos directory
+//    -td tests the performance of directory lookups, with the given
+//	number of files
+//    -tc tests create/remove throughput, with the given number of threads
+//    -tw tests small-write throughput, with the given number of files
+//    -dsync says when to wait for what is written to the disk to reach
+//	the UNIX file: never (the default), when Nachos halts, or after
+//	every write (cf. disk.h)
+//    -geometry sets how many tracks each disk has, and how many sectors
+//	each track has (an even number; cf. FileSystemFits)
+//    -disks stripes the file system across that many disks, and
+//	-stripe sets how many sectors in a row go on each (cf. synchdisk.h)
+//    -ts tests sequential read throughput, reading the whole disk the
+//	given number of sectors at a time
 //
 //  NETWORK
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
 //    -o runs a simple test of the Nachos network software
+//    -tr measures a bulk transfer over a reliable connection, with the 
+//	given window size
+//    -tm measures sending messages of up to a megabyte, in fragments
+//    -tp measures round trips of small messages, and the buffers and
+//	copies each one takes
+//    -nodes simulates that many machines in this Nachos, connected by
+//	a simulated network fabric, instead of using UNIX sockets
+//    -tf runs a message exchange among all the machines on the fabric
+//    -trpc measures remote procedure calls, with up to the given number
+//	of client threads
 //
 //  NOTE -- flags are ignored until the relevant assignment.
 //  Some of the flags are interpreted here; some in system.cc.
@@ -62,8 +121,15 @@ extern void Elevator(int numFloors);
 extern void ArrivingGoingFromTo(int atFloor, int toFloor);
 extern void ThreadTest(int n), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
+extern void DirectoryTest(int numFiles), CreateRemoveTest(int numThreads);
+extern void WriteTest(int numFiles), StripeTest(int sectorsPerRead);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
+extern void StartProcesses(char *file, int copies);
+extern void RestoreProcess(char *name);
 extern void MailTest(int networkID);
+extern void TransportTest(int farAddr, int window);
+extern void MessageTest(int farAddr), PingPongTest(int farAddr);
+extern void FabricTest(void), RpcTest(int farAddr, int maxThreads);
 extern void Ping(void);
 //----------------------------------------------------------------------
 // main
@@ -145,6 +211,14 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-xn")) {	// run several at once
+	    ASSERT(argc > 2);
+            StartProcesses(*(argv + 2), atoi(*(argv + 1)));
+            argCount = 3;
+        } else if (!strcmp(*argv, "-restore")) {	// pick up a checkpoint
+	    ASSERT(argc > 1);
+            RestoreProcess(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-c")) {      // test the console
 	    if (argc == 1)
 	        ConsoleTest(NULL, NULL);
@@ -177,6 +251,27 @@ main(int argc, char **argv)
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-mkdir")) {	// make a Nachos directory
+	    ASSERT(argc > 1);
+	    if (!fileSystem->CreateDirectory(*(argv + 1)))
+		printf("Couldn't create directory %s\n", *(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-td")) {	// directory performance test
+	    ASSERT(argc > 1);
+            DirectoryTest(atoi(*(argv + 1)));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tc")) {	// create/remove throughput
+	    ASSERT(argc > 1);
+            CreateRemoveTest(atoi(*(argv + 1)));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tw")) {	// small-write throughput
+	    ASSERT(argc > 1);
+            WriteTest(atoi(*(argv + 1)));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ts")) {	// striped read throughput
+	    ASSERT(argc > 1);
+            StripeTest(atoi(*(argv + 1)));
+	    argCount = 2;
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -187,6 +282,28 @@ main(int argc, char **argv)
 						// start up another nachos
             MailTest(atoi(*(argv + 1)));
             argCount = 2;
+        } else if (!strcmp(*argv, "-tr")) {	// reliable transfer test
+	    ASSERT(argc > 2);
+            Delay(2); 				// wait for the other nachos
+            TransportTest(atoi(*(argv + 1)), atoi(*(argv + 2)));
+            argCount = 3;
+        } else if (!strcmp(*argv, "-tm")) {	// large message test
+	    ASSERT(argc > 1);
+            Delay(2); 				// wait for the other nachos
+            MessageTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-tp")) {	// ping-pong test
+	    ASSERT(argc > 1);
+            Delay(2); 				// wait for the other nachos
+            PingPongTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-tf")) {	// many-machine fabric test
+            FabricTest();
+        } else if (!strcmp(*argv, "-trpc")) {	// RPC test
+	    ASSERT(argc > 2);
+            Delay(2); 				// wait for the other nachos
+            RpcTest(atoi(*(argv + 1)), atoi(*(argv + 2)));
+            argCount = 3;
         }
 #endif // NETWORK
     }
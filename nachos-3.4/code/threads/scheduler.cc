@@ -4,7 +4,8 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since we are on a uniprocessor, or on a multiprocessor whose
+//	CPUs only take turns with interrupts on -- cf. cpu.h).
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would 
@@ -42,6 +43,19 @@ Scheduler::~Scheduler()
     delete readyList; 
 } 
 
+//----------------------------------------------------------------------
+// Scheduler::ReadyList
+// 	Return the list of threads ready to run on the CPU running now.
+//----------------------------------------------------------------------
+
+List *
+Scheduler::ReadyList()
+{
+    if (smp == NULL)
+	return readyList;
+    return smp->GetCpu(smp->CurrentId())->readyList;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
@@ -56,13 +70,16 @@ Scheduler::ReadyToRun (Thread *thread)
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+    ReadyList()->Append((void *)thread);
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
 // 	Return the next thread to be scheduled onto the CPU.
 //	If there are no ready threads, return NULL.
+//
+//	On a multiprocessor, if there are none ready on this CPU, steal
+//	one from the next CPU along that has any.
 // Side effect:
 //	Thread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -70,7 +87,24 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    Thread *thread = (Thread *)ReadyList()->Remove();
+    Cpu *victim;
+    int i, me;
+
+    if (thread != NULL || smp == NULL)
+	return thread;
+    me = smp->CurrentId();
+    for (i = 1; i < smp->NumCpus(); i++) {
+	victim = smp->GetCpu((me + i) % smp->NumCpus());
+	thread = (Thread *)victim->readyList->Remove();
+	if (thread != NULL) {
+	    DEBUG('t', "CPU %d stealing thread %s from CPU %d\n", me,
+					thread->getName(), victim->id);
+	    smp->GetCpu(me)->steals++;
+	    return thread;
+	}
+    }
+    return NULL;
 }
 
 //----------------------------------------------------------------------
@@ -102,6 +136,8 @@ Scheduler::Run (Thread *nextThread)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    if (trace != NULL && (smp == NULL || smp->CurrentId() == 0))
+	trace->Running(nextThread);	// (the CPU track is CPU 0's)
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
     
@@ -134,6 +170,22 @@ Scheduler::Run (Thread *nextThread)
 #endif
 }
 
+//----------------------------------------------------------------------
+// Scheduler::IsEmpty
+// 	Return TRUE if no thread is waiting for the CPU.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::IsEmpty()
+{
+    if (smp == NULL)
+	return readyList->IsEmpty();
+    for (int i = 0; i < smp->NumCpus(); i++)
+	if (!smp->GetCpu(i)->readyList->IsEmpty())
+	    return FALSE;
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 // 	Print the scheduler state -- in other words, the contents of
@@ -143,5 +195,13 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    if (smp == NULL) {
+	readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+	return;
+    }
+    for (int i = 0; i < smp->NumCpus(); i++) {
+	printf("CPU %d: ", i);
+	smp->GetCpu(i)->readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+	printf("\n");
+    }
 }
@@ -16,6 +16,10 @@
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
+//
+// On a multiprocessor (cf. cpu.h), each CPU has a ready list of its
+// own; a thread made ready goes on the list of the CPU that readied it,
+// and a CPU whose list is empty takes the first thread from another's.
 
 class Scheduler {
   public:
@@ -25,12 +29,18 @@ class Scheduler {
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
     Thread* FindNextToRun();		// Dequeue first thread on the ready 
 					// list, if any, and return thread.
+					// (On a multiprocessor, from this
+					// CPU's list, or else another's.)
     void Run(Thread* nextThread);	// Cause nextThread to start running
     void Print();			// Print contents of ready list
+    bool IsEmpty();			// Is no thread ready to run?
     
   private:
     List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+				// but not running (on a multiprocessor,
+				// CPUs have their own instead)
+
+    List *ReadyList();		// The ready list for the CPU running now
 };
 
 #endif // SCHEDULER_H
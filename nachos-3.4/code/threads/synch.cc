@@ -137,9 +137,16 @@ void
 Lock::Acquire() 
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int start = stats->totalTicks;
 
     sem->P();
     holder = currentThread ;
+    if (trace != NULL) {
+	if (stats->totalTicks > start)		// had to wait for it
+	    trace->Span(trace->ThreadTrack(currentThread), "lock", name,
+				start, stats->totalTicks - start, 0);
+	trace->AsyncBegin("lock", name, (int) this);
+    }
 
     (void) interrupt->SetLevel(oldLevel);
 }
@@ -159,6 +166,8 @@ Lock::Release()
     ASSERT( isHeldByCurrentThread() ) ;
     sem->V() ;	
     holder = NULL ; 
+    if (trace != NULL)
+	trace->AsyncEnd("lock", name, (int) this);
 
     (void) interrupt->SetLevel(oldLevel);
 }
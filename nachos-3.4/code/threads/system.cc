@@ -18,6 +18,11 @@ Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+ReplayLog *replayLog;			// the log of inputs, if -record
+					// or -replay
+Trace *trace;				// the timeline, if -trace
+Accounting *accounting;			// who had the CPU, and for how long
+Multiprocessor *smp;			// the CPUs, if more than one
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -25,14 +30,23 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+HeaderCache *headerCache;
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+BitMap *memoryMap;
+SynchConsole *synchConsole;
+char *checkpointName;
+int checkpointTime;
+SysFileTable *openFiles;
+Profiler *profiler;
 #endif
 
 #ifdef NETWORK
 PostOffice *postOffice;
+PacketPool *packetPool;
+Fabric *fabric;
 #endif
 
 
@@ -80,16 +94,35 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+    unsigned seed = 1;			// random number seed (1 is what
+					// it is if nobody sets it)
+    char *recordName = NULL;		// log to record inputs to
+    char *replayName = NULL;		// log to replay inputs from
+    char *traceName = NULL;		// file to write a trace to
+    int numCpus = 1;			// CPUs to simulate
+    int slice = CpuSlice;		// how long each one's turn is
+    bool hostParallel = FALSE;		// run them on host threads?
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    int profileInterval = 0;	// ticks between samples, if profiling
+    bool histograms = FALSE;	// keep histograms of what they do,
+    char *histName = NULL;	//   and write them here, as CSV
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    bool logStructured = FALSE;	// format it as a log
+    char *restoreName = NULL;	// checkpoint to take the disk from
+    DiskSync diskSync = SyncNever;	// when to flush the disk's file
+    int numDisks = 1;			// disks to stripe across
+    int stripeUnit = DefaultStripeUnit;	// sectors in a row on each
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
+    int numNodes = 0;		// machines in this Nachos, if more than one
 #endif
     
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
@@ -103,19 +136,95 @@ Initialize(int argc, char **argv)
 	    }
 	} else if (!strcmp(*argv, "-rs")) {
 	    ASSERT(argc > 1);
-	    RandomInit(atoi(*(argv + 1)));	// initialize pseudo-random
-						// number generator
+	    seed = atoi(*(argv + 1));
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-record")) {
+	    ASSERT(argc > 1);
+	    recordName = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-replay")) {
+	    ASSERT(argc > 1);
+	    replayName = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-trace")) {
+	    ASSERT(argc > 1);
+	    traceName = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-cpus")) {
+	    ASSERT(argc > 1);
+	    numCpus = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-slice")) {
+	    ASSERT(argc > 1);
+	    slice = atoi(*(argv + 1));
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-hostpar"))
+	    hostParallel = TRUE;
+	else if (!strcmp(*argv, "-ckpt")) {
+	    ASSERT(argc > 2);
+	    checkpointTime = atoi(*(argv + 1));
+	    checkpointName = *(argv + 2);
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-mem")) {
+	    ASSERT(argc > 1);
+	    numPhysPages = atoi(*(argv + 1));
+	    ASSERT(numPhysPages > 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-hist"))
+	    histograms = TRUE;
+	else if (!strcmp(*argv, "-histcsv")) {
+	    ASSERT(argc > 1);
+	    histograms = TRUE;
+	    histName = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-prof")) {
+	    ASSERT(argc > 1);
+	    profileInterval = atoi(*(argv + 1));
+	    ASSERT(profileInterval > 0);
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-lfs"))
+	    logStructured = TRUE;
+	else if (!strcmp(*argv, "-restore")) {
+	    ASSERT(argc > 1);
+	    restoreName = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-geometry")) {
+	    ASSERT(argc > 2);
+	    numTracks = atoi(*(argv + 1));
+	    sectorsPerTrack = atoi(*(argv + 2));
+	    ASSERT((numTracks > 0) && (sectorsPerTrack > 0));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-disks")) {
+	    ASSERT(argc > 1);
+	    numDisks = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-stripe")) {
+	    ASSERT(argc > 1);
+	    stripeUnit = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-dsync")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "halt"))
+		diskSync = SyncOnHalt;
+	    else if (!strcmp(*(argv + 1), "write"))
+		diskSync = SyncEachWrite;
+	    else
+		ASSERT(!strcmp(*(argv + 1), "never"));
+	    argCount = 2;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-l")) {
 	    ASSERT(argc > 1);
@@ -125,14 +234,31 @@ Initialize(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    netname = atoi(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-nodes")) {
+	    ASSERT(argc > 1);
+	    numNodes = atoi(*(argv + 1));
+	    argCount = 2;
 	}
 #endif
     }
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+#ifdef USER_PROGRAM
+    if (histograms)
+	stats->KeepHistograms(numPhysPages, histName);
+#endif
+    if (recordName != NULL)			// the seed goes in the log,
+	replayLog = new ReplayLog(recordName, TRUE, &seed, &randomYield);
+    else if (replayName != NULL)		// or comes from it
+	replayLog = new ReplayLog(replayName, FALSE, &seed, &randomYield);
+    else
+	replayLog = NULL;
+    RandomInit(seed);				// initialize pseudo-random
+						// number generator
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
+    accounting = new Accounting();		// before any thread is made
     if (randomYield)				// start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
@@ -144,15 +270,46 @@ Initialize(int argc, char **argv)
     currentThread = new Thread("main");		
     currentThread->setStatus(RUNNING);
 
+#ifdef USER_PROGRAM
+    if (debugUserProg)				// the debugger has to see
+	hostParallel = FALSE;			// each instruction as it runs
+#endif
+    if (numCpus > 1)				// main carries on, on CPU 0
+	smp = new Multiprocessor(numCpus, slice, hostParallel);
+    else
+	smp = NULL;
+
+    if (traceName != NULL) {			// start tracing, with main
+	trace = new Trace(traceName, TraceSize);	// on the CPU
+	trace->Running(currentThread);
+    } else
+	trace = NULL;
+
     interrupt->Enable();
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    memoryMap = new BitMap(numPhysPages);
+    synchConsole = NULL;
+    openFiles = new SysFileTable;
+    if (profileInterval > 0)
+	profiler = new Profiler(profileInterval);
+    else
+	profiler = NULL;
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    if (!FileSystemFits(numDisks)) {
+	printf("No room for the file system on %d disk(s) of %d tracks of "
+		"%d sectors\n", numDisks, numTracks, sectorsPerTrack);
+	ASSERT(FALSE);
+    }
+    if (restoreName != NULL)
+	RestoreDisk(restoreName, "DISK");	// before anything looks at it
+    synchDisk = new SynchDisk("DISK", numDisks, stripeUnit, diskSync);
+    synchDisk->Mount(format, logStructured);
+    headerCache = new HeaderCache(HeaderCacheSize);
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -160,6 +317,11 @@ Initialize(int argc, char **argv)
 #endif
 
 #ifdef NETWORK
+    packetPool = new PacketPool();
+    if (numNodes > 0)
+	fabric = new Fabric(numNodes, rely);
+    else
+	fabric = NULL;
     postOffice = new PostOffice(netname, rely, 10);
 #endif
 }
@@ -172,12 +334,24 @@ void
 Cleanup()
 {
     printf("\nCleaning up...\n");
+    if (trace != NULL)
+	trace->Write();
+#ifdef USER_PROGRAM
+    if (profiler != NULL)
+	profiler->Print();
+#endif
 #ifdef NETWORK
     delete postOffice;
+    delete fabric;
+    delete packetPool;
 #endif
     
 #ifdef USER_PROGRAM
     delete machine;
+    delete memoryMap;
+    delete synchConsole;
+    delete openFiles;
+    delete profiler;
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -185,11 +359,16 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete headerCache;
     delete synchDisk;
 #endif
     
+    delete replayLog;
+    delete trace;
     delete timer;
+    delete smp;
     delete scheduler;
+    delete accounting;
     delete interrupt;
     
     Exit(0);
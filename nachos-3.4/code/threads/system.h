@@ -15,6 +15,10 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "replay.h"
+#include "trace.h"
+#include "cpu.h"
+#include "account.h"
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
@@ -28,10 +32,30 @@ extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern ReplayLog *replayLog;			// inputs being recorded or
+						// replayed, or NULL
+extern Trace *trace;				// timeline of kernel events,
+						// or NULL
+extern Multiprocessor *smp;			// the CPUs, if -cpus gives
+						// more than one; else NULL
+extern Accounting *accounting;			// CPU time of each thread
+						// and user program
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "synchconsole.h"
+#include "checkpoint.h"
+#include "filetable.h"
+#include "profile.h"
+#include "bitmap.h"
 extern Machine* machine;	// user program memory and registers
+extern BitMap *memoryMap;	// pages of main memory in use
+extern SynchConsole *synchConsole;	// console for Read and Write, made
+					// the first time it is used
+extern char *checkpointName;	// where to checkpoint, or NULL
+extern int checkpointTime;	//   and when
+extern SysFileTable *openFiles;	// files user programs have open
+extern Profiler *profiler;	// where they spend their time, or NULL
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -41,12 +65,18 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "fscache.h"
 extern SynchDisk   *synchDisk;
+extern HeaderCache *headerCache;	// file headers of open files
 #endif
 
 #ifdef NETWORK
 #include "post.h"
+#include "fabric.h"
 extern PostOffice* postOffice;
+extern PacketPool *packetPool;
+extern Fabric *fabric;		// NULL unless simulating many machines
+				// in this Nachos
 #endif
 
 #endif // SYSTEM_H
@@ -38,6 +38,8 @@ Thread::Thread(char* threadName)
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    traceId = 0;
+    account = accounting->NewThread(threadName);
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
@@ -91,6 +93,10 @@ Thread::Fork(VoidFunctionPtr func, int arg)
 	  name, (int) func, arg);
     
     StackAllocate(func, arg);
+    if (trace != NULL) {
+	trace->Instant(trace->ThreadTrack(currentThread), "thread", "fork",
+						trace->ThreadTrack(this));
+    }
 
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
     scheduler->ReadyToRun(this);	// ReadyToRun assumes that interrupts 
@@ -147,6 +153,9 @@ Thread::Finish ()
     ASSERT(this == currentThread);
     
     DEBUG('t', "Finishing thread \"%s\"\n", getName());
+    account->done = TRUE;
+    if (trace != NULL)
+	trace->Instant(trace->ThreadTrack(this), "thread", "finish", 0);
     
     threadToBeDestroyed = currentThread;
     Sleep();					// invokes SWITCH
@@ -169,10 +178,13 @@ Thread::Finish ()
 //	original state, in case we are called with interrupts disabled. 
 //
 // 	Similar to Thread::Sleep(), but a little different.
+//
+//	"preempted" is TRUE if the thread isn't giving up the CPU of its
+//	own accord, but because its time slice is up (cf. OneTick).
 //----------------------------------------------------------------------
 
 void
-Thread::Yield ()
+Thread::Yield (bool preempted)
 {
     Thread *nextThread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
@@ -183,6 +195,10 @@ Thread::Yield ()
     
     nextThread = scheduler->FindNextToRun();
     if (nextThread != NULL) {
+	if (preempted)
+	    account->involuntarySwitches++;
+	else
+	    account->voluntarySwitches++;
 	scheduler->ReadyToRun(this);
 	scheduler->Run(nextThread);
     }
@@ -200,7 +216,8 @@ Thread::Yield ()
 //	we have no thread to run.  "Interrupt::Idle" is called
 //	to signify that we should idle the CPU until the next I/O interrupt
 //	occurs (the only thing that could cause a thread to become
-//	ready to run).
+//	ready to run).  On a multiprocessor, the CPU's idle thread
+//	takes over instead (cf. cpu.h).
 //
 //	NOTE: we assume interrupts are already disabled, because it
 //	is called from the synchronization routines which must
@@ -218,13 +235,41 @@ Thread::Sleep ()
     
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
-    status = BLOCKED;
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
+    setStatus(BLOCKED);
+    if (threadToBeDestroyed != this)
+	account->voluntarySwitches++;
+    while ((nextThread = scheduler->FindNextToRun()) == NULL) {
+	if (smp != NULL) {
+	    nextThread = smp->IdleThread();
+	    break;
+	}
 	interrupt->Idle();	// no one to run, wait for an interrupt
+    }
         
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
+//----------------------------------------------------------------------
+// Thread::setStatus
+// 	Change the thread's status.  If it was waiting to run, or blocked,
+//	charge the time since it started waiting to its account.
+//----------------------------------------------------------------------
+
+void
+Thread::setStatus(ThreadStatus st)
+{
+    int waited = stats->totalTicks - account->since;
+
+    if (waited < 0)		// another CPU's clock (cf. account.h)
+	waited = 0;
+    if (status == READY)
+	account->readyTicks += waited;
+    else if (status == BLOCKED)
+	account->blockedTicks += waited;
+    account->since = stats->totalTicks;
+    status = st;
+}
+
 //----------------------------------------------------------------------
 // ThreadFinish, InterruptEnable, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
@@ -39,6 +39,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "account.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -90,17 +91,25 @@ class Thread {
     // basic thread operations
 
     void Fork(VoidFunctionPtr func, int arg); 	// Make thread run (*func)(arg)
-    void Yield();  				// Relinquish the CPU if any 
-						// other thread is runnable
+    void Yield(bool preempted = FALSE);		// Relinquish the CPU if any 
+						// other thread is runnable;
+						// "preempted" if the timer
+						// says so (for accounting)
     void Sleep();  				// Put the thread to sleep and 
 						// relinquish the processor
     void Finish();  				// The thread is done executing
     
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
-    void setStatus(ThreadStatus st) { status = st; }
+    void setStatus(ThreadStatus st);		// also charges it for the
+						// time it was ready or blocked
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
+    int getTraceId() { return (traceId); }
+    void setTraceId(int id) { traceId = id; }
+
+    Account *account;				// CPU time it has had, and
+						// how it got it (cf. account.h)
 
   private:
     // some of the private data for this class is listed above
@@ -110,10 +119,14 @@ class Thread {
 					// (If NULL, don't deallocate stack)
     ThreadStatus status;		// ready, running or blocked
     char* name;
+    int traceId;			// track in the trace; 0 if none yet
 
+  public:
     void StackAllocate(VoidFunctionPtr func, int arg);
     					// Allocate a stack for thread.
-					// Used internally by Fork()
+					// Used internally by Fork(), and
+					// for the CPUs' idle threads
+					// (cf. cpu.cc)
 
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
@@ -0,0 +1,231 @@
+// trace.cc
+//	Routines to record kernel events in a ring buffer, and to write
+//	them out as a Chrome trace.  See trace.h.
+
+#include "copyright.h"
+#include "trace.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Trace::Trace
+// 	Set up an empty trace, and its ring of events.
+//
+//	"name" -- UNIX file to write the trace to, at the end
+//	"n" -- the most events to keep
+//----------------------------------------------------------------------
+
+Trace::Trace(char *name, int n)
+{
+    ASSERT(n > 0);
+    fileName = name;
+    size = n;
+    ring = new TraceEvent[size];
+    next = count = 0;
+    running = NULL;
+    since = 0;
+    numThreads = 0;
+}
+
+Trace::~Trace()
+{
+    delete [] ring;
+}
+
+//----------------------------------------------------------------------
+// Trace::Add
+// 	Put an event in the ring, over the oldest one if the ring is full.
+//----------------------------------------------------------------------
+
+void
+Trace::Add(char phase, char *category, char *name, int track, int time,
+					int duration, int id, int arg)
+{
+    TraceEvent *e = &ring[next];
+
+    e->phase = phase;
+    e->category = category;
+    e->name = name;
+    e->track = track;
+    e->time = time;
+    e->duration = duration;
+    e->id = id;
+    e->arg = arg;
+    next = (next + 1) % size;
+    count++;
+}
+
+//----------------------------------------------------------------------
+// Trace::ThreadTrack
+// 	Return the track for "thread", giving it one (and remembering its
+//	name) the first time we see it.
+//----------------------------------------------------------------------
+
+int
+Trace::ThreadTrack(Thread *thread)
+{
+    int slot;
+
+    if (thread->getTraceId() == 0) {
+	slot = numThreads % MaxTraceThreads;
+	strncpy(threadNames[slot], thread->getName(), TraceNameSize - 1);
+	threadNames[slot][TraceNameSize - 1] = '\0';
+	thread->setTraceId(FirstThreadTrack + numThreads++);
+    }
+    return thread->getTraceId();
+}
+
+//----------------------------------------------------------------------
+// Trace::Running
+// 	The CPU is changing hands: close off the span for whoever had it
+//	(or for the time it was idle), and start one for "thread".
+//
+//	"thread" -- who has the CPU now; NULL if no one
+//----------------------------------------------------------------------
+
+void
+Trace::Running(Thread *thread)
+{
+    int track;
+
+    if (thread == running)
+	return;
+    if (stats->totalTicks > since) {
+	if (running == NULL)
+	    Add('X', "cpu", "idle", CpuTrack, since,
+				stats->totalTicks - since, 0, 0);
+	else {
+	    track = ThreadTrack(running);
+	    Add('X', "cpu", threadNames[(track - FirstThreadTrack)
+					% MaxTraceThreads], CpuTrack,
+			since, stats->totalTicks - since, 0, track);
+	}
+    }
+    running = thread;
+    since = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Trace::Instant, Trace::Span
+// 	Record something that happened on "track": at this moment, or
+//	from "start" for "duration" ticks.
+//----------------------------------------------------------------------
+
+void
+Trace::Instant(int track, char *category, char *name, int arg)
+{
+    Add('i', category, name, track, stats->totalTicks, 0, 0, arg);
+}
+
+void
+Trace::Span(int track, char *category, char *name, int start,
+					int duration, int arg)
+{
+    Add('X', category, name, track, start, duration, 0, arg);
+}
+
+//----------------------------------------------------------------------
+// Trace::AsyncBegin, Trace::AsyncEnd
+// 	Record the start or end of something that can overlap other
+//	things on the same thread, such as holding a lock.  The start and
+//	end are matched up by "category", "name" and "id".
+//----------------------------------------------------------------------
+
+void
+Trace::AsyncBegin(char *category, char *name, int id)
+{
+    Add('b', category, name, CpuTrack, stats->totalTicks, 0, id, 0);
+}
+
+void
+Trace::AsyncEnd(char *category, char *name, int id)
+{
+    Add('e', category, name, CpuTrack, stats->totalTicks, 0, id, 0);
+}
+
+//----------------------------------------------------------------------
+// PutString
+// 	Write "s" to "f" as a JSON string.
+//----------------------------------------------------------------------
+
+static void
+PutString(FILE *f, char *s)
+{
+    putc('"', f);
+    for (; *s != '\0'; s++) {
+	if (*s == '"' || *s == '\\')
+	    putc('\\', f);
+	if (*s >= ' ')
+	    putc(*s, f);
+    }
+    putc('"', f);
+}
+
+//----------------------------------------------------------------------
+// PutTrackName
+// 	Write the metadata event that names a track.
+//----------------------------------------------------------------------
+
+static void
+PutTrackName(FILE *f, int track, char *name)
+{
+    fprintf(f, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,"
+				"\"tid\":%d,\"args\":{\"name\":", track);
+    PutString(f, name);
+    fprintf(f, "}},\n");
+}
+
+//----------------------------------------------------------------------
+// Trace::Write
+// 	Write out the events in the ring, oldest first, in Chrome's
+//	trace event format.  The names of the tracks go first, and the
+//	name of the process last (so every other entry ends in a comma).
+//----------------------------------------------------------------------
+
+void
+Trace::Write()
+{
+    FILE *f = fopen(fileName, "w");
+    TraceEvent *e;
+    int i, first, n;
+
+    if (f == NULL) {
+	printf("Unable to write trace to %s\n", fileName);
+	return;
+    }
+    Running(NULL);			// close off the last span
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    PutTrackName(f, CpuTrack, "CPU");
+    PutTrackName(f, InterruptTrack, "interrupts");
+    PutTrackName(f, DiskTrack, "disk");
+    first = (numThreads > MaxTraceThreads) ? numThreads - MaxTraceThreads : 0;
+    for (i = first; i < numThreads; i++)
+	PutTrackName(f, FirstThreadTrack + i, threadNames[i % MaxTraceThreads]);
+
+    n = (count < size) ? count : size;
+    first = (count < size) ? 0 : next;
+    for (i = 0; i < n; i++) {
+	e = &ring[(first + i) % size];
+	fprintf(f, "{\"ph\":\"%c\",\"cat\":", e->phase);
+	PutString(f, e->category);
+	fprintf(f, ",\"name\":");
+	PutString(f, e->name);
+	fprintf(f, ",\"pid\":1,\"tid\":%d,\"ts\":%d", e->track, e->time);
+	if (e->phase == 'X')
+	    fprintf(f, ",\"dur\":%d", e->duration);
+	else if (e->phase == 'i')
+	    fprintf(f, ",\"s\":\"t\"");
+	else
+	    fprintf(f, ",\"id\":%d", e->id);
+	fprintf(f, ",\"args\":{\"arg\":%d}},\n", e->arg);
+    }
+    fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,"
+				"\"args\":{\"name\":\"Nachos\"}}\n");
+    fprintf(f, "]}\n");
+    fclose(f);
+
+    printf("Trace: %d events written to %s", n, fileName);
+    if (count > n)
+	printf(" (%d older ones dropped)", count - n);
+    printf("\n");
+}
@@ -0,0 +1,95 @@
+// trace.h
+//	Data structures for tracing what the kernel does, and when, for
+//	viewing as a timeline (-trace).
+//
+//	Events are stamped with the simulated time, and kept in a ring
+//	buffer allocated up front, so tracing costs a few stores per event;
+//	once the ring is full, the oldest events make way for new ones.
+//	When Nachos halts, the ring is written out as Chrome trace JSON,
+//	which chrome://tracing and Perfetto (ui.perfetto.dev) can open.
+//	One tick shows as one microsecond.
+//
+//	The timeline has a track for the CPU (which thread had it, and
+//	when it was idle), one for interrupts, one for the disk, and one
+//	per thread (syscalls and exceptions, waits for locks, forks and
+//	finishes).  Lock holds show as async spans, one per lock.
+
+#include "copyright.h"
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "thread.h"
+
+#define TraceSize		65536	// events kept in the ring
+#define MaxTraceThreads		256	// threads whose names we remember
+#define TraceNameSize		32	// longest thread name kept, plus one
+
+// Fixed tracks; each thread gets a track of its own after these.
+#define CpuTrack		1
+#define InterruptTrack		2
+#define DiskTrack		3
+#define FirstThreadTrack	4
+
+// The following class defines one event in the ring.  "name" and
+// "category" must stay around until the trace is written (string
+// constants, or object names that live that long).
+
+class TraceEvent {
+  public:
+    char phase;			// Chrome trace phase: 'X' for a span,
+				// 'i' for an instant, 'b'/'e' for the
+				// start/end of an async span
+    char *category;
+    char *name;
+    int track;			// Which track it goes on
+    int time;			// When it happened (or started)
+    int duration;		// For a span, how long it took
+    int id;			// For an async span, what it is about
+    int arg;			// Anything else worth showing
+};
+
+// The following class defines the trace.
+
+class Trace {
+  public:
+    Trace(char *fileName, int size);	// Start tracing, keeping up to
+					// "size" events, to write to
+					// "fileName"
+    ~Trace();
+
+    void Running(Thread *thread);	// "thread" now has the CPU; NULL
+					// if the CPU is going idle
+    int ThreadTrack(Thread *thread);	// The track for "thread"
+
+    void Instant(int track, char *category, char *name, int arg);
+					// Something happened, now
+    void Span(int track, char *category, char *name, int start,
+				int duration, int arg);
+					// Something took from "start" for
+					// "duration" ticks
+    void AsyncBegin(char *category, char *name, int id);
+    void AsyncEnd(char *category, char *name, int id);
+					// Something started (or ended) that
+					// may overlap other such things
+
+    void Write();			// Write the trace out
+
+  private:
+    TraceEvent *ring;			// The events, oldest first,
+    int size;				//   starting at ring[next] once
+    int next;				//   the ring has filled up
+    int count;				// Events recorded so far
+    char *fileName;
+
+    Thread *running;			// Who has the CPU, NULL if idle
+    int since;				//   and since when
+
+    char threadNames[MaxTraceThreads][TraceNameSize];
+    int numThreads;			// Threads given a track so far
+
+    void Add(char phase, char *category, char *name, int track,
+			int time, int duration, int id, int arg);
+};
+
+#endif // TRACE_H
@@ -45,6 +45,33 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// LoadSegment
+// 	Read "size" bytes of a program, at "inFileAddr" in "executable",
+//	into its address space at "virtualAddr", a page at a time, since
+//	the pages can be anywhere in physical memory.
+//----------------------------------------------------------------------
+
+static void
+LoadSegment(OpenFile *executable, TranslationEntry *pageTable,
+				int virtualAddr, int size, int inFileAddr)
+{
+    int page, offset, n;
+
+    while (size > 0) {
+	page = virtualAddr / PageSize;
+	offset = virtualAddr % PageSize;
+	n = PageSize - offset;
+	if (n > size)
+	    n = size;
+	executable->ReadAt(&(machine->mainMemory[pageTable[page].physicalPage
+				* PageSize + offset]), n, inFileAddr);
+	virtualAddr += n;
+	inFileAddr += n;
+	size -= n;
+    }
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -54,8 +81,9 @@ SwapHeader (NoffHeader *noffH)
 //	Assumes that the object code file is in NOFF format.
 //
 //	First, set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	memory.  Each virtual page gets a free physical page of its
+//	own (cf. memoryMap), so that several programs can be in memory
+//	at once; we have a single unsegmented page table.
 //
 //	"executable" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
@@ -78,7 +106,8 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
+    ASSERT(numPages <= (unsigned int) memoryMap->NumClear());
+						// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
@@ -88,8 +117,8 @@ AddrSpace::AddrSpace(OpenFile *executable)
 // first, set up the translation 
     pageTable = new TranslationEntry[numPages];
     for (i = 0; i < numPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-	pageTable[i].physicalPage = i;
+	pageTable[i].virtualPage = i;
+	pageTable[i].physicalPage = memoryMap->Find();
 	pageTable[i].valid = TRUE;
 	pageTable[i].use = FALSE;
 	pageTable[i].dirty = FALSE;
@@ -100,32 +129,63 @@ AddrSpace::AddrSpace(OpenFile *executable)
     
 // zero out the entire address space, to zero the unitialized data segment 
 // and the stack segment
-    bzero(machine->mainMemory, size);
+    for (i = 0; i < numPages; i++)
+	bzero(&(machine->mainMemory[pageTable[i].physicalPage * PageSize]),
+								PageSize);
 
 // then, copy in the code and data segments into memory
     if (noffH.code.size > 0) {
         DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
 			noffH.code.virtualAddr, noffH.code.size);
-        executable->ReadAt(&(machine->mainMemory[noffH.code.virtualAddr]),
+        LoadSegment(executable, pageTable, noffH.code.virtualAddr,
 			noffH.code.size, noffH.code.inFileAddr);
     }
     if (noffH.initData.size > 0) {
         DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
 			noffH.initData.virtualAddr, noffH.initData.size);
-        executable->ReadAt(&(machine->mainMemory[noffH.initData.virtualAddr]),
+        LoadSegment(executable, pageTable, noffH.initData.virtualAddr,
 			noffH.initData.size, noffH.initData.inFileAddr);
     }
 
+    fileTable = new FdTable;
+    profile = NULL;
+    account = NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create an address space for a program whose memory has already
+//	been put back, from a checkpoint.
+//
+//	"table" -- its page table, which now belongs to the address space
+//	"n" -- the number of pages
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(TranslationEntry *table, int n)
+{
+    pageTable = table;
+    numPages = n;
+    for (int i = 0; i < n; i++)		// its pages are in use
+	memoryMap->Mark(table[i].physicalPage);
+    fileTable = new FdTable;
+    profile = NULL;
+    account = NULL;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space, freeing its pages of memory, and
+//	closing any files it left open.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
+   for (unsigned int i = 0; i < numPages; i++)
+	memoryMap->Clear(pageTable[i].physicalPage);
    delete pageTable;
+   delete fileTable;
+   if (account != NULL)
+	account->done = TRUE;		// its threads' times stay on
 }
 
 //----------------------------------------------------------------------
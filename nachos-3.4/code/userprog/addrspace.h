@@ -16,6 +16,10 @@
 #include "copyright.h"
 #include "filesys.h"
 
+class FdTable;				// cf. filetable.h
+class Profile;				// cf. profile.h
+class Account;				// cf. account.h
+
 #define UserStackSize		1024 	// increase this as necessary!
 
 class AddrSpace {
@@ -23,6 +27,11 @@ class AddrSpace {
     AddrSpace(OpenFile *executable);	// Create an address space,
 					// initializing it with the program
 					// stored in the file "executable"
+    AddrSpace(TranslationEntry *table, int n);
+					// Create an address space whose
+					// memory is already there, with
+					// page table "table" (cf.
+					// checkpoint.h)
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -31,6 +40,12 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    FdTable *fileTable;			// Files the program has open
+    Profile *profile;			// Where it spends its time, if
+					// profiling; else NULL
+    Account *account;			// CPU time its threads have had;
+					// NULL if not kept
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
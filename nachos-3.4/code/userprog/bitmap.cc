@@ -22,8 +22,8 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 	// also clears the unused bits
+        map[i] = 0;			// past numBits in the last word
 }
 
 //----------------------------------------------------------------------
@@ -82,6 +82,50 @@ BitMap::Test(int which)
 	return FALSE;
 }
 
+//----------------------------------------------------------------------
+// BitMap::NextClear, BitMap::NextSet
+// 	Return the number of the first bit at or after "from" that is
+//	clear (resp. set), or numBits if there isn't one.
+//
+//	Rather than testing bit by bit, we skip over whole words that
+//	have nothing of interest in them, and use the hardware's "count
+//	trailing zeros" to pick the bit out of the first one that does.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextClear(int from)
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return numBits;
+    bits = ~map[w] & (~0u << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return numBits;
+	bits = ~map[w];
+    }
+    return min(w * BitsInWord + __builtin_ctz(bits), numBits);
+}
+
+int
+BitMap::NextSet(int from)
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return numBits;
+    bits = map[w] & (~0u << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return numBits;
+	bits = map[w];
+    }
+    return min(w * BitsInWord + __builtin_ctz(bits), numBits);
+}
+
 //----------------------------------------------------------------------
 // BitMap::Find
 // 	Return the number of the first bit which is clear.
@@ -94,11 +138,38 @@ BitMap::Test(int which)
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
-	}
+    int i = NextClear(0);
+
+    if (i == numBits)
+	return -1;
+    Mark(i);
+    return i;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Return the number of the first bit of a run of "count" clear
+//	bits, looking only at bits "from" and above.  Unlike Find, the
+//	bits are NOT marked -- the caller decides which of them to use.
+//
+//	If there is no such run, return -1.
+//
+//	"count" is the length of the run we need
+//	"from" is where to start looking
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int count, int from)
+{
+    int first, end;
+
+    ASSERT(count > 0 && from >= 0);
+    for (first = NextClear(from); first + count <= numBits; 
+					first = NextClear(end)) {
+	end = NextSet(first);		// the run of clear bits is [first, end)
+	if (end - first >= count)
+	    return first;
+    }
     return -1;
 }
 
@@ -106,6 +177,9 @@ BitMap::Find()
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//
+//	The bits past numBits in the last word are always clear, so
+//	don't count them.
 //----------------------------------------------------------------------
 
 int 
@@ -113,9 +187,9 @@ BitMap::NumClear()
 {
     int count = 0;
 
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
-    return count;
+    for (int i = 0; i < numWords; i++)
+	count += __builtin_popcount(~map[i]);
+    return count - (numWords * BitsInWord - numBits);
 }
 
 //----------------------------------------------------------------------
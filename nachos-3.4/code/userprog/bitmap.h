@@ -43,6 +43,11 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindRun(int count, int from);
+				// Return the # of the first bit of a run
+				// of "count" clear bits, at or after
+				// "from".  Does NOT set the bits.
+				// If there is no such run, return -1.
     int NumClear();		// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
@@ -59,6 +64,9 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+
+    int NextClear(int from);		// # of the first clear/set bit at
+    int NextSet(int from);		// or after "from"; numBits if none
 };
 
 #endif // BITMAP_H
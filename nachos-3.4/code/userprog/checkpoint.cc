@@ -0,0 +1,222 @@
+// checkpoint.cc
+//	Routines to save the simulated machine to a file, and to pick up
+//	again from one.  See checkpoint.h for what is saved, and when.
+
+#include "copyright.h"
+#include "system.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// Quiet
+// 	Return TRUE if the machine can be checkpointed: nothing but the
+//	current thread can run, no device has an operation in progress,
+//	and the user program has no file ids open (they aren't saved).
+//	Only the registers of one CPU are saved, so not on a multiprocessor;
+//	and only one disk's file is copied, so not with several disks.
+//----------------------------------------------------------------------
+
+static bool
+Quiet()
+{
+#ifdef FILESYS
+    if (synchDisk->NumDisks() > 1)
+	return FALSE;
+#endif
+    return (smp == NULL) && scheduler->IsEmpty()
+		&& currentThread->space->fileTable->IsEmpty()
+		&& !interrupt->IsPending(DiskInt)
+		&& !interrupt->IsPending(ConsoleWriteInt)
+		&& !interrupt->IsPending(NetworkSendInt);
+}
+
+//----------------------------------------------------------------------
+// IsZero
+// 	Return TRUE if "length" bytes at "p" are all zero.
+//----------------------------------------------------------------------
+
+static bool
+IsZero(char *p, int length)
+{
+    for (int i = 0; i < length; i++)
+	if (p[i] != 0)
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DiskCopyName
+// 	Return the name of the copy of the disk that goes with checkpoint
+//	"name".  The caller de-allocates it.
+//----------------------------------------------------------------------
+
+static char *
+DiskCopyName(char *name)
+{
+    char *copyName = new char[strlen(name) + 6];
+
+    sprintf(copyName, "%s.disk", name);
+    return copyName;
+}
+
+//----------------------------------------------------------------------
+// CopyFile
+// 	Copy the UNIX file "from" to "to".
+//----------------------------------------------------------------------
+
+static void
+CopyFile(char *from, char *to)
+{
+    char buffer[8192];
+    int in = OpenForReadWrite(from, TRUE);
+    int out = OpenForWrite(to);
+    int n;
+
+    while ((n = ReadPartial(in, buffer, sizeof(buffer))) > 0)
+	WriteFile(out, buffer, n);
+    Close(in);
+    Close(out);
+}
+
+//----------------------------------------------------------------------
+// TakeCheckpoint
+// 	Save the user program and the machine it runs on to the file
+//	"name", if the machine is quiet.  Called between user
+//	instructions.  Return TRUE if the checkpoint was taken, FALSE if
+//	it has to wait.
+//----------------------------------------------------------------------
+
+bool
+TakeCheckpoint(char *name)
+{
+    CheckpointHeader hdr;
+    int fd, i, offset;
+    bool quiet;
+
+    interrupt->setStatus(SystemMode);
+#ifdef FILESYS
+    synchDisk->Sync();			// get everything onto the disk
+#endif
+    quiet = Quiet();
+    interrupt->setStatus(UserMode);
+    if (!quiet)
+	return FALSE;
+    ASSERT(machine->pageTable != NULL);	// a TLB would need saving too
+
+    hdr.magic = CheckpointMagic;
+    hdr.stats = *stats;
+    for (i = 0; i < NumTotalRegs; i++)
+	hdr.registers[i] = machine->ReadRegister(i);
+    hdr.numPages = machine->pageTableSize;
+    hdr.memorySize = MemorySize;
+    hdr.memoryOffset = divRoundUp(sizeof(CheckpointHeader)
+		+ hdr.numPages * sizeof(TranslationEntry), CheckpointAlign)
+		* CheckpointAlign;
+#ifdef FILESYS
+    hdr.hasDisk = TRUE;
+#else
+    hdr.hasDisk = FALSE;
+#endif
+
+    fd = OpenForWrite(name);
+    WriteFile(fd, (char *) &hdr, sizeof(CheckpointHeader));
+    WriteFile(fd, (char *) machine->pageTable,
+				hdr.numPages * sizeof(TranslationEntry));
+    for (offset = 0; offset < MemorySize; offset += PageSize)
+	if (!IsZero(machine->mainMemory + offset, PageSize)) {
+	    Lseek(fd, hdr.memoryOffset + offset, 0);
+	    WriteFile(fd, machine->mainMemory + offset, PageSize);
+	}
+    // make sure the file covers all of memory, holes included, so
+    // it can all be mapped
+    Lseek(fd, hdr.memoryOffset + MemorySize - 1, 0);
+    WriteFile(fd, machine->mainMemory + MemorySize - 1, 1);
+    Close(fd);
+
+    if (hdr.hasDisk) {
+	char *copyName = DiskCopyName(name);
+
+	CopyFile("DISK", copyName);
+	delete [] copyName;
+    }
+    printf("Checkpoint taken at time %d, in %s\n", stats->totalTicks, name);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RestoreProcess
+// 	Run the user program saved in checkpoint "name", from where it
+//	left off.  Memory is mapped from the checkpoint, rather than read
+//	in, so pages are only read as the program touches them.
+//----------------------------------------------------------------------
+
+void
+RestoreProcess(char *name)
+{
+    CheckpointHeader hdr;
+    TranslationEntry *pageTable;
+    AddrSpace *space;
+    int fd = OpenForReadWrite(name, FALSE);
+    int i;
+    bool histograms = stats->histograms;	// these are this run's
+    int *pageAccesses = stats->pageAccesses;	// settings, not the
+    int numPages = stats->numPages;		// checkpoint's
+    char *csvName = stats->csvName;
+
+    if (fd < 0) {
+	printf("Unable to open checkpoint %s\n", name);
+	return;
+    }
+    Read(fd, (char *) &hdr, sizeof(CheckpointHeader));
+    if ((hdr.magic != CheckpointMagic) || (hdr.memorySize != MemorySize)) {
+	printf("%s is not a checkpoint of this machine\n", name);
+	Close(fd);
+	return;
+    }
+    pageTable = new TranslationEntry[hdr.numPages];
+    Read(fd, (char *) pageTable, hdr.numPages * sizeof(TranslationEntry));
+    space = new AddrSpace(pageTable, hdr.numPages);
+    currentThread->space = space;
+    space->account = accounting->NewProcess(name);
+    currentThread->account->process = space->account;
+
+    machine->MapMemory(fd, hdr.memoryOffset);
+    Close(fd);				// the mapping stays
+    for (i = 0; i < NumTotalRegs; i++)
+	machine->WriteRegister(i, hdr.registers[i]);
+    *stats = hdr.stats;			// including the time
+    stats->histograms = histograms;
+    stats->pageAccesses = pageAccesses;
+    stats->numPages = numPages;
+    stats->csvName = csvName;
+    DEBUG('a', "Restored checkpoint %s, at time %d\n", name,
+						stats->totalTicks);
+
+    space->RestoreState();		// load page table register
+    machine->Run();			// and pick up where we left off
+    ASSERT(FALSE);			// machine->Run never returns
+}
+
+//----------------------------------------------------------------------
+// RestoreDisk
+// 	If checkpoint "name" has a copy of the disk, copy it over the
+//	UNIX file "diskName" that holds the disk.  Called before the disk
+//	is opened.
+//----------------------------------------------------------------------
+
+void
+RestoreDisk(char *name, char *diskName)
+{
+    CheckpointHeader hdr;
+    int fd = OpenForReadWrite(name, FALSE);
+
+    if (fd < 0)
+	return;				// RestoreProcess will complain
+    Read(fd, (char *) &hdr, sizeof(CheckpointHeader));
+    Close(fd);
+    if ((hdr.magic == CheckpointMagic) && hdr.hasDisk) {
+	char *copyName = DiskCopyName(name);
+
+	CopyFile(copyName, diskName);
+	delete [] copyName;
+    }
+}
@@ -0,0 +1,60 @@
+// checkpoint.h
+//	Data structures for saving the whole simulated machine, with the
+//	user program running on it, to a file, so that a later Nachos can
+//	pick up from there instead of starting over (-ckpt and -restore).
+//
+//	A checkpoint holds the user program's registers, its page table,
+//	main memory, and the statistics (which include the time).  With
+//	the file system, a copy of the disk goes alongside, in
+//	"<name>.disk".
+//
+//	Kernel threads can't be saved -- they run on host stacks -- so a
+//	checkpoint is only taken when the machine is quiet: nothing but
+//	the user program is ready to run, no device is in the middle of
+//	an operation, and the program has no files open (open file ids
+//	aren't saved).  The only interrupts still pending then are the
+//	timer and the console's polling for input; those start up afresh
+//	in the restored Nachos.  If the machine isn't quiet at the time
+//	asked for, the checkpoint is taken at the first instruction after
+//	that when it is.
+//
+//	Memory is written page by page, skipping pages of zeroes (which
+//	are left as holes in the file), and restored by mapping the file
+//	copy-on-write, so a restore only reads in the pages the program
+//	touches from then on.
+
+#include "copyright.h"
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "machine.h"
+#include "stats.h"
+
+#define CheckpointMagic	0x4e434b50	// "NCKP"
+#define CheckpointAlign	65536		// memory starts at a multiple of
+					// this in the file, so it can be
+					// mapped on any host page size
+
+// The following class defines the start of a checkpoint file.  The
+// page table comes right after it; main memory, at "memoryOffset".
+
+class CheckpointHeader {
+  public:
+    int magic;				// CheckpointMagic
+    Statistics stats;			// Statistics, and the time
+    int registers[NumTotalRegs];	// User registers
+    int numPages;			// Entries in the page table
+    int memorySize;			// Bytes of main memory
+    int memoryOffset;			// Where main memory is in the file
+    bool hasDisk;			// Is there a copy of the disk?
+};
+
+extern bool TakeCheckpoint(char *name);	// Save the machine to "name", if
+					// it is quiet; return whether it was
+extern void RestoreProcess(char *name);	// Pick up the user program saved
+					// in "name"; never returns
+extern void RestoreDisk(char *name, char *diskName);
+					// Put back the disk saved with "name"
+
+#endif // CHECKPOINT_H
@@ -4,8 +4,10 @@
 //	transfer back to here from user code:
 //
 //	syscall -- The user code explicitly requests to call a procedure
-//	in the Nachos kernel.  Right now, the only function we support is
-//	"Halt".
+//	in the Nachos kernel.  Right now, the only functions we support are
+//	"Halt", "Exit", the file operations: "Create", "Open", "Read",
+//	"Write", "Seek" and "Close" (the console is open as ids 0 and 1),
+//	and "GetUsage".
 //
 //	exceptions -- The user code does something that the CPU can't handle.
 //	For instance, accessing memory that doesn't exist, arithmetic errors,
@@ -14,7 +16,8 @@
 //	Interrupts (which can also cause control to transfer from user
 //	code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
+// For now, this only handles Halt(), Exit(), the file system calls and
+// GetUsage().
 // Everything else core dumps.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -24,6 +27,237 @@
 #include "copyright.h"
 #include "system.h"
 #include "syscall.h"
+#include "usermem.h"
+
+//----------------------------------------------------------------------
+// GetSynchConsole
+// 	Return the console for user programs, setting it up the first time
+//	one of them uses it.  (It isn't set up in Initialize, because once
+//	it is, the console polls for input forever, and Nachos never runs
+//	out of things to do.)
+//----------------------------------------------------------------------
+
+static SynchConsole *
+GetSynchConsole()
+{
+    if (synchConsole == NULL)
+	synchConsole = new SynchConsole(NULL, NULL);
+    return synchConsole;
+}
+
+//----------------------------------------------------------------------
+// CreateSyscall, OpenSyscall, CloseSyscall
+// 	Create, open or close a file for the user program.  The name is
+//	a string in user memory.  Open returns the new id, or -1.
+//----------------------------------------------------------------------
+
+static void
+CreateSyscall(int name)
+{
+    char buf[UserNameSize];
+
+    if (CopyStringFromUser(name, buf, sizeof(buf)) < 0)
+	return;
+    DEBUG('a', "Create %s\n", buf);
+    fileSystem->Create(buf, 0);
+}
+
+static OpenFileId
+OpenSyscall(int name)
+{
+    char buf[UserNameSize];
+    SysOpenFile *file;
+    int id;
+
+    if (CopyStringFromUser(name, buf, sizeof(buf)) < 0)
+	return -1;
+    if ((file = openFiles->Open(buf)) == NULL)
+	return -1;
+    if ((id = currentThread->space->fileTable->Add(file)) < 0)
+	openFiles->Close(file);		// no room for it
+    DEBUG('a', "Open %s as %d\n", buf, id);
+    return id;
+}
+
+static void
+CloseSyscall(OpenFileId id)
+{
+    currentThread->space->fileTable->Remove(id);
+}
+
+//----------------------------------------------------------------------
+// FileTransfer
+// 	Read or write up to "size" bytes between the open file "id" and
+//	the user's "buffer", at the id's position, and move the position
+//	on past them.  The data goes straight between the file and main
+//	memory, a span (a run of contiguous pages) at a time.  The file
+//	is locked throughout, so a transfer isn't interleaved with any
+//	other on the same file, whoever has it open.  Return how many
+//	bytes were transferred, or -1 if "id" isn't open.
+//
+//	"reading" -- TRUE to read from the file into "buffer"
+//----------------------------------------------------------------------
+
+static int
+FileTransfer(int buffer, int size, OpenFileId id, bool reading)
+{
+    FdTable *table = currentThread->space->fileTable;
+    SysOpenFile *file = table->Get(id);
+    UserBuffer user(buffer, size, reading);
+    int *position;
+    char *span;
+    int n, done, total = 0;
+
+    if (file == NULL || size < 0)
+	return -1;
+    position = table->Position(id);
+    file->lock->Acquire();
+    while ((span = user.NextSpan(&n)) != NULL) {
+	if (reading)
+	    done = file->file->ReadAt(span, n, *position);
+	else
+	    done = file->file->WriteAt(span, n, *position);
+	if (done > 0) {
+	    *position += done;
+	    total += done;
+	}
+	if (done < n)
+	    break;			// end of the file
+    }
+    file->lock->Release();
+    return total;
+}
+
+//----------------------------------------------------------------------
+// WriteSyscall
+// 	Write "size" bytes from the user's "buffer" to the console or to
+//	an open file.  For the console, each page of the buffer goes
+//	straight from main memory into the console's ring, which batches
+//	it up with the rest, so the whole write goes out in as few bursts
+//	as it can.
+//----------------------------------------------------------------------
+
+static void
+WriteSyscall(int buffer, int size, OpenFileId id)
+{
+    UserBuffer user(buffer, size, FALSE);
+    char *span;
+    int n;
+
+    if (id != ConsoleOutput) {
+	FileTransfer(buffer, size, id, FALSE);
+	return;
+    }
+    while ((span = user.NextSpan(&n)) != NULL)
+	GetSynchConsole()->Write(span, n);
+}
+
+//----------------------------------------------------------------------
+// ReadSyscall
+// 	Read up to "size" bytes from the console or from an open file
+//	straight into the user's "buffer".  From the console, stop after
+//	a newline.  Return how many were read, or -1.
+//----------------------------------------------------------------------
+
+static int
+ReadSyscall(int buffer, int size, OpenFileId id)
+{
+    UserBuffer user(buffer, size, TRUE);
+    char *span;
+    int n, got, total = 0;
+
+    if (id != ConsoleInput)
+	return FileTransfer(buffer, size, id, TRUE);
+    if (size < 0)
+	return -1;
+    while ((span = user.NextSpan(&n)) != NULL) {
+	got = GetSynchConsole()->Read(span, n);
+	total += got;
+	if (got < n || span[got - 1] == '\n')
+	    break;			// end of the line
+    }
+    return total;
+}
+
+//----------------------------------------------------------------------
+// SeekSyscall
+// 	Move the position of the open file "id" to "position" bytes from
+//	its start.
+//----------------------------------------------------------------------
+
+static void
+SeekSyscall(int position, OpenFileId id)
+{
+    FdTable *table = currentThread->space->fileTable;
+
+    if (table->Get(id) != NULL && position >= 0)
+	*table->Position(id) = position;
+}
+
+//----------------------------------------------------------------------
+// GetUsageSyscall
+// 	Copy the account of the running thread, its program, or every
+//	thread (cf. account.h) out to a UsageInfo at "addr", in the
+//	machine's byte order.  Return 0, or -1 if "who" or "addr" is bad.
+//----------------------------------------------------------------------
+
+static int
+GetUsageSyscall(int who, int addr)
+{
+    Account total, *account = currentThread->account;
+    UsageInfo usage;
+    int *word = (int *) &usage;
+
+    if (who == UsageThread)
+	total = *account;
+    else if (who == UsageProcess && account->process != NULL)
+	accounting->Total(account->process, &total);
+    else if (who == UsageSystem)
+	accounting->Total(NULL, &total);
+    else
+	return -1;
+    usage.userTicks = total.userTicks;
+    usage.systemTicks = total.systemTicks;
+    usage.readyTicks = total.readyTicks;
+    usage.blockedTicks = total.blockedTicks;
+    usage.voluntarySwitches = total.voluntarySwitches;
+    usage.involuntarySwitches = total.involuntarySwitches;
+    usage.totalTicks = stats->totalTicks;
+    for (unsigned int i = 0; i < sizeof(usage) / sizeof(int); i++)
+	word[i] = WordToMachine(word[i]);
+    if (CopyToUser((char *) &usage, addr, sizeof(usage)) != sizeof(usage))
+	return -1;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ExitSyscall
+// 	The user program is done: free its address space, and finish the
+//	thread running it.  Once nothing is left to run, Nachos halts.
+//----------------------------------------------------------------------
+
+static void
+ExitSyscall(int status)
+{
+    DEBUG('a', "User program \"%s\" exits, status %d\n",
+					currentThread->getName(), status);
+    delete currentThread->space;
+    currentThread->space = NULL;
+    currentThread->Finish();
+}
+
+//----------------------------------------------------------------------
+// AdvancePC
+// 	Move the user program on past the syscall instruction.
+//----------------------------------------------------------------------
+
+static void
+AdvancePC()
+{
+    machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+    machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+    machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg) + 4);
+}
 
 //----------------------------------------------------------------------
 // ExceptionHandler
@@ -53,9 +287,42 @@ ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
 
+    if (stats->histograms) {
+	stats->exceptionCounts[which]++;
+	if (which == SyscallException)
+	    stats->CountSyscall(type);
+    }
     if ((which == SyscallException) && (type == SC_Halt)) {
 	DEBUG('a', "Shutdown, initiated by user program.\n");
+	if (synchConsole != NULL)
+	    synchConsole->Flush();	// let the last output get out
    	interrupt->Halt();
+    } else if ((which == SyscallException) && (type == SC_Exit)) {
+	ExitSyscall(machine->ReadRegister(4));
+    } else if ((which == SyscallException) && (type == SC_Write)) {
+	WriteSyscall(machine->ReadRegister(4), machine->ReadRegister(5),
+					machine->ReadRegister(6));
+	AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Read)) {
+	machine->WriteRegister(2, ReadSyscall(machine->ReadRegister(4),
+			machine->ReadRegister(5), machine->ReadRegister(6)));
+	AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Create)) {
+	CreateSyscall(machine->ReadRegister(4));
+	AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Open)) {
+	machine->WriteRegister(2, OpenSyscall(machine->ReadRegister(4)));
+	AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Seek)) {
+	SeekSyscall(machine->ReadRegister(4), machine->ReadRegister(5));
+	AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Close)) {
+	CloseSyscall(machine->ReadRegister(4));
+	AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_GetUsage)) {
+	machine->WriteRegister(2, GetUsageSyscall(machine->ReadRegister(4),
+					machine->ReadRegister(5)));
+	AdvancePC();
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
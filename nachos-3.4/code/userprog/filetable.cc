@@ -0,0 +1,222 @@
+// filetable.cc
+//	Routines to manage the system-wide table of open files, and each
+//	address space's table of open file ids.  See filetable.h.
+
+#include "copyright.h"
+#include "filetable.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// CanonicalName
+// 	Copy "name" to "canon" (which must have room for it) the way the
+//	file system reads it, so that every name for the same file comes
+//	out the same: runs of '/' become one.  The Nachos file system
+//	also ignores leading and trailing '/'s (cf. FileSystem::FindParent),
+//	so those go too; UNIX doesn't, so with FILESYS_STUB they stay.
+//----------------------------------------------------------------------
+
+static void
+CanonicalName(char *name, char *canon)
+{
+    char *to = canon;
+
+#ifdef FILESYS
+    while (*name == '/')
+	name++;
+#endif
+    for (; *name != '\0'; name++)
+	if ((*name != '/') || (to == canon) || (to[-1] != '/'))
+	    *to++ = *name;
+#ifdef FILESYS
+    while ((to > canon) && (to[-1] == '/'))
+	to--;
+#endif
+    *to = '\0';
+}
+
+//----------------------------------------------------------------------
+// SysFileTable::SysFileTable
+// 	Set up an empty table of open files.
+//----------------------------------------------------------------------
+
+SysFileTable::SysFileTable()
+{
+    for (int i = 0; i < MaxSysOpenFiles; i++) {
+	table[i].name = NULL;
+	table[i].file = NULL;
+	table[i].refCount = 0;
+	table[i].lock = NULL;
+    }
+    lock = new Lock("open files");
+}
+
+//----------------------------------------------------------------------
+// SysFileTable::~SysFileTable
+// 	Close any files still open.
+//----------------------------------------------------------------------
+
+SysFileTable::~SysFileTable()
+{
+    for (int i = 0; i < MaxSysOpenFiles; i++)
+	if (table[i].name != NULL) {
+	    delete table[i].file;
+	    delete table[i].lock;
+	    delete [] table[i].name;
+	}
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// SysFileTable::Open
+// 	Return the entry for the file "name", opening the file if no one
+//	has it open yet.  Return NULL if it doesn't exist, or if the table
+//	is full.  Files are found by their canonical names, so that "a",
+//	"/a" and "//a" share one entry.
+//----------------------------------------------------------------------
+
+SysOpenFile *
+SysFileTable::Open(char *name)
+{
+    SysOpenFile *entry = NULL;
+    OpenFile *file;
+    char *canon = new char[strlen(name) + 1];
+    int i;
+
+    CanonicalName(name, canon);
+    lock->Acquire();
+    for (i = 0; i < MaxSysOpenFiles; i++)
+	if (table[i].name != NULL && !strcmp(table[i].name, canon)) {
+	    entry = &table[i];
+	    entry->refCount++;
+	    lock->Release();
+	    delete [] canon;
+	    return entry;
+	}
+    for (i = 0; i < MaxSysOpenFiles; i++)
+	if (table[i].name == NULL) {
+	    entry = &table[i];
+	    break;
+	}
+    if (entry == NULL || (file = fileSystem->Open(canon)) == NULL) {
+	lock->Release();
+	delete [] canon;
+	return NULL;
+    }
+    entry->name = canon;
+    entry->file = file;
+    entry->refCount = 1;
+    entry->lock = new Lock("open file");	// (not "name": trace keeps
+						// lock names after Close)
+    DEBUG('f', "Opened %s for user programs\n", canon);
+    lock->Release();
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// SysFileTable::Close
+// 	One fewer id has "entry" open; if it was the last, close the file.
+//----------------------------------------------------------------------
+
+void
+SysFileTable::Close(SysOpenFile *entry)
+{
+    lock->Acquire();
+    ASSERT(entry->refCount > 0);
+    if (--entry->refCount == 0) {
+	DEBUG('f', "Closed %s for user programs\n", entry->name);
+	delete entry->file;
+	delete entry->lock;
+	delete [] entry->name;
+	entry->file = NULL;
+	entry->lock = NULL;
+	entry->name = NULL;
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FdTable::FdTable
+// 	Set up an address space's table of open ids, with none open.
+//----------------------------------------------------------------------
+
+FdTable::FdTable()
+{
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	files[i] = NULL;
+	position[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// FdTable::~FdTable
+// 	Close whatever the address space left open.
+//----------------------------------------------------------------------
+
+FdTable::~FdTable()
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+	if (files[i] != NULL)
+	    openFiles->Close(files[i]);
+}
+
+//----------------------------------------------------------------------
+// FdTable::Add
+// 	Give "file" the lowest free id, starting at the beginning of the
+//	file.  Return the id, or -1 if the table is full.
+//----------------------------------------------------------------------
+
+int
+FdTable::Add(SysOpenFile *file)
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+	if (files[i] == NULL) {
+	    files[i] = file;
+	    position[i] = 0;
+	    return i + FirstFileId;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FdTable::Get
+// 	Return the file behind "id", or NULL if "id" isn't open.
+//----------------------------------------------------------------------
+
+SysOpenFile *
+FdTable::Get(int id)
+{
+    if (id < FirstFileId || id >= FirstFileId + MaxOpenFiles)
+	return NULL;
+    return files[id - FirstFileId];
+}
+
+//----------------------------------------------------------------------
+// FdTable::IsEmpty
+// 	Return TRUE if no ids are open.
+//----------------------------------------------------------------------
+
+bool
+FdTable::IsEmpty()
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+	if (files[i] != NULL)
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FdTable::Remove
+// 	Close "id".  Return FALSE if it wasn't open.
+//----------------------------------------------------------------------
+
+bool
+FdTable::Remove(int id)
+{
+    SysOpenFile *file = Get(id);
+
+    if (file == NULL)
+	return FALSE;
+    files[id - FirstFileId] = NULL;
+    openFiles->Close(file);
+    return TRUE;
+}
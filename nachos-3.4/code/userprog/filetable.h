@@ -0,0 +1,76 @@
+// filetable.h
+//	Data structures to keep track of the files user programs have
+//	open, for the Open, Read, Write, Seek and Close system calls.
+//
+//	There are two levels, as in UNIX.  Each address space has a table
+//	of open file ids, each with its own position in the file.  The ids
+//	point into one system-wide table of open files, with an entry per
+//	file no matter how many ids (in how many address spaces) have it
+//	open; the entry holds the file's OpenFile, and a lock that keeps
+//	Reads and Writes of the file from interleaving.  The OpenFile is
+//	closed when its last id is.
+//
+//	Ids 0 and 1 are the console (cf. syscall.h), so file ids start at 2.
+
+#include "copyright.h"
+
+#ifndef FILETABLE_H
+#define FILETABLE_H
+
+#include "filesys.h"
+#include "synch.h"
+
+#define MaxSysOpenFiles		64	// files open at once, system-wide
+#define MaxOpenFiles		16	// ids open at once, per address space
+#define FirstFileId		2	// ids below this are the console
+#define UserNameSize		64	// longest file name a program can
+					// pass, plus one
+
+// The following class defines an entry in the system-wide table.
+
+class SysOpenFile {
+  public:
+    char *name;			// The file's name, NULL if entry is free
+    OpenFile *file;		// The file, open once for everyone
+    int refCount;		// How many ids have it open
+    Lock *lock;			// Held across each Read or Write
+};
+
+// The following class defines the system-wide table of open files.
+
+class SysFileTable {
+  public:
+    SysFileTable();
+    ~SysFileTable();
+
+    SysOpenFile *Open(char *name);	// Find "name" in the table, or
+					// open it; NULL if it can't be
+    void Close(SysOpenFile *entry);	// One fewer id has "entry" open
+
+  private:
+    SysOpenFile table[MaxSysOpenFiles];
+    Lock *lock;				// Held while looking in the table
+};
+
+// The following class defines an address space's table of open ids.
+
+class FdTable {
+  public:
+    FdTable();
+    ~FdTable();				// Close everything still open
+
+    int Add(SysOpenFile *file);		// Give "file" an id, at position 0;
+					// -1 if the table is full
+    SysOpenFile *Get(int id);		// The file behind "id"; NULL if none
+    int *Position(int id) { return &position[id - FirstFileId]; }
+					// Where in the file "id" is; only
+					// for an id Get says is open
+    bool Remove(int id);		// Close "id"; FALSE if it isn't open
+    bool IsEmpty();			// Are no ids open?
+
+  private:
+    SysOpenFile *files[MaxOpenFiles];
+    int position[MaxOpenFiles];
+};
+
+#endif // FILETABLE_H
@@ -0,0 +1,532 @@
+// profile.cc
+//	Routines to profile user programs: sample their PCs, count their
+//	calls, and put both down to functions, from the programs' COFF
+//	symbol tables.  See profile.h.
+//
+//	The COFF files are MIPS ECOFF.  The symbol table is found through
+//	the "symbolic header" (what the file header's f_symptr points to).
+//	Each source file has a file descriptor there, with its own symbols
+//	and strings; a procedure is a symbol of type stProc or
+//	stStaticProc, in the text section, whose value is its address.
+//	Programs linked without local symbols still have external ones,
+//	so those are read too.  Everything is little-endian, like the
+//	simulated machine (cf. WordToHost).
+
+#include "copyright.h"
+#include "profile.h"
+#include "system.h"
+
+// Where things are, in the file header, the optional ("a.out")
+// header after it, and the symbolic header; and the sizes of the
+// records in the symbol table.  (coff.h has the structures, but with
+// "long"s, which aren't always 4 bytes.)
+#define FileMagic		0	// file header: magic number,
+#define CoffMagic		0x0162	//   MIPSELMAGIC in coff.h
+#define FileSymPtr		8	//   where the symbolic header is
+#define AoutTextSize		24	// a.out header: size of the code
+#define AoutTextStart		40	//   and where it goes
+#define SymMagic		0x7009	// symbolic header: its magic number
+#define SymHeaderSize		96	//   its size
+#define SymLocalsOffset		36	//   local symbols
+#define SymLocalStrings		60	//   their strings
+#define SymExternStrings	68	//   external symbols' strings
+#define SymFiles		72	//   number of file descriptors
+#define SymFilesOffset		76	//   and where they are
+#define SymExterns		88	//   number of external symbols
+#define SymExternsOffset	92	//   and where they are
+#define FileDescSize		72	// file descriptor: strings start at
+#define FdStrings		8	//   this in the local strings, symbols
+#define FdSymbols		16	//   at this index in the locals, and
+#define FdNumSymbols		20	//   there are this many
+#define SymbolSize		12	// symbol: string, value, type bits
+#define ExternSize		16	// external: 4 bytes, then a symbol
+
+#define stProc			6	// symbol types we want
+#define stStaticProc		14
+#define scText			1	// storage class we want
+
+//----------------------------------------------------------------------
+// Word
+// 	Return the 4-byte word at "p", in host byte order.
+//----------------------------------------------------------------------
+
+static int
+Word(char *p)
+{
+    unsigned int word;
+
+    bcopy(p, (char *) &word, sizeof(word));
+    return (int) WordToHost(word);
+}
+
+//----------------------------------------------------------------------
+// Profile::Profile
+// 	Set up to profile the program in "fileName", reading its
+//	functions from "fileName".coff.  If it can't be read, the
+//	profile has no symbols, and the program isn't profiled.
+//----------------------------------------------------------------------
+
+Profile::Profile(char *fileName)
+{
+    char *coffName = new char[strlen(fileName) + 6];
+
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    sprintf(coffName, "%s.coff", fileName);
+
+    numFunctions = 0;
+    functionAddr = NULL;
+    functionName = NULL;
+    strings = NULL;
+    textStart = textSize = 0;
+    if (!ReadSymbols(coffName))
+	printf("No symbols in %s; not profiling %s\n", coffName, name);
+    delete [] coffName;
+
+    hits = new int[textSize / 4 + 1];
+    for (int i = 0; i <= textSize / 4; i++)
+	hits[i] = 0;
+    samples = 0;
+    for (int i = 0; i < MaxCallArcs; i++)
+	arcs[i].count = 0;
+    lostCalls = 0;
+}
+
+//----------------------------------------------------------------------
+// Profile::~Profile
+//----------------------------------------------------------------------
+
+Profile::~Profile()
+{
+    delete [] name;
+    delete [] hits;
+    delete [] functionAddr;
+    delete [] functionName;
+    delete [] strings;
+}
+
+//----------------------------------------------------------------------
+// Within
+// 	Return TRUE if "count" records of "each" bytes, starting "offset"
+//	bytes into a file "size" bytes long, are all inside the file.
+//----------------------------------------------------------------------
+
+static bool
+Within(int offset, int count, int each, int size)
+{
+    return (offset >= 0) && (offset <= size) && (count >= 0)
+				&& (count <= (size - offset) / each);
+}
+
+//----------------------------------------------------------------------
+// Profile::ReadSymbols
+// 	Read the functions, and where the code is, out of the COFF file
+//	"coffName", sorted by address.  Return FALSE if there isn't a
+//	COFF file, or it has no functions.
+//
+//	The whole file is read in, and the functions' names are left
+//	where they are in it; it isn't very big.  Nothing in it is
+//	trusted: every offset and count is checked against its size
+//	before it is used, and a file that fails is taken to have none.
+//----------------------------------------------------------------------
+
+bool
+Profile::ReadSymbols(char *coffName)
+{
+    int fd = OpenForReadWrite(coffName, FALSE);
+    int size, sym, files, filesOffset, externs, externsOffset;
+    int locals, localStrings, externStrings, strs, name;
+    int i, j, max, fdesc, first, count, bits, addr;
+    char *p, *symName;
+
+    if (fd < 0)
+	return FALSE;
+    Lseek(fd, 0, 2);
+    size = Tell(fd);
+    Lseek(fd, 0, 0);
+    strings = new char[size + 1];
+    Read(fd, strings, size);
+    Close(fd);
+    strings[size] = '\0';			// so every name ends
+
+    if ((size < AoutTextStart + 4)
+	    || (ShortToHost(*(unsigned short *) (strings + FileMagic))
+								!= CoffMagic))
+	return FALSE;
+    sym = Word(strings + FileSymPtr);
+    if (!Within(sym, 1, SymHeaderSize, size)
+	    || (ShortToHost(*(unsigned short *) (strings + sym)) != SymMagic))
+	return FALSE;
+    textSize = Word(strings + AoutTextSize);
+    textStart = Word(strings + AoutTextStart);
+    locals = Word(strings + sym + SymLocalsOffset);
+    localStrings = Word(strings + sym + SymLocalStrings);
+    externStrings = Word(strings + sym + SymExternStrings);
+    files = Word(strings + sym + SymFiles);
+    filesOffset = Word(strings + sym + SymFilesOffset);
+    externs = Word(strings + sym + SymExterns);
+    externsOffset = Word(strings + sym + SymExternsOffset);
+    if (!Within(0, textSize, 1, size) || !Within(locals, 0, 1, size)
+	    || !Within(localStrings, 0, 1, size)
+	    || !Within(externStrings, 0, 1, size)
+	    || !Within(filesOffset, files, FileDescSize, size)
+	    || !Within(externsOffset, externs, ExternSize, size)) {
+	textSize = 0;
+	return FALSE;
+    }
+
+    max = externs;				// room for every symbol
+    for (i = 0; i < files; i++) {
+	fdesc = filesOffset + i * FileDescSize;
+	first = Word(strings + fdesc + FdSymbols);
+	count = Word(strings + fdesc + FdNumSymbols);
+	strs = Word(strings + fdesc + FdStrings);
+	if ((first < 0) || (first > (size - locals) / SymbolSize)
+		|| !Within(locals + first * SymbolSize, count, SymbolSize, size)
+		|| !Within(strs, 0, 1, size - localStrings)
+		|| (count > size / SymbolSize - max)) {
+	    textSize = 0;
+	    return FALSE;
+	}
+	max += count;
+    }
+    functionAddr = new int[max];
+    functionName = new char *[max];
+
+    for (i = 0; i < files + externs; i++) {
+	if (i < files) {			// a source file's symbols
+	    fdesc = filesOffset + i * FileDescSize;
+	    first = locals + Word(strings + fdesc + FdSymbols) * SymbolSize;
+	    count = Word(strings + fdesc + FdNumSymbols);
+	    strs = localStrings + Word(strings + fdesc + FdStrings);
+	} else {				// an external symbol
+	    first = externsOffset + (i - files) * ExternSize
+						+ (ExternSize - SymbolSize);
+	    count = 1;
+	    strs = externStrings;
+	}
+	for (j = 0; j < count; j++) {
+	    p = strings + first + j * SymbolSize;
+	    bits = Word(p + 8);
+	    if ((((bits & 0x3f) != stProc) && ((bits & 0x3f) != stStaticProc))
+					|| (((bits >> 6) & 0x1f) != scText))
+		continue;
+	    name = Word(p);
+	    addr = Word(p + 4);
+	    if ((name < 0) || (name >= size - strs)
+		    || ((unsigned int) (addr - textStart)
+						>= (unsigned int) textSize))
+		continue;			// name or code isn't there
+	    functionAddr[numFunctions] = addr;
+	    functionName[numFunctions] = strings + strs + name;
+	    numFunctions++;
+	}
+    }
+
+    for (i = 1; i < numFunctions; i++) {	// sort by address, and
+	addr = functionAddr[i];			// drop the second of each
+	symName = functionName[i];		// pair at the same place
+	for (j = i; (j > 0) && (functionAddr[j - 1] > addr); j--) {
+	    functionAddr[j] = functionAddr[j - 1];
+	    functionName[j] = functionName[j - 1];
+	}
+	functionAddr[j] = addr;
+	functionName[j] = symName;
+    }
+    for (i = j = 0; i < numFunctions; i++)
+	if ((j == 0) || (functionAddr[i] != functionAddr[j - 1])) {
+	    functionAddr[j] = functionAddr[i];
+	    functionName[j++] = functionName[i];
+	}
+    numFunctions = j;
+    DEBUG('a', "Read %d functions from %s\n", numFunctions, coffName);
+    return (numFunctions > 0);
+}
+
+//----------------------------------------------------------------------
+// Profile::Lookup
+// 	Return the index of the function "addr" is in, or -1 if it is
+//	before the first function, or past the end of the code.
+//----------------------------------------------------------------------
+
+int
+Profile::Lookup(int addr)
+{
+    int low = 0, high = numFunctions - 1, mid;
+
+    if ((numFunctions == 0) || (addr < functionAddr[0])
+				|| (addr >= textStart + textSize))
+	return -1;
+    while (low < high) {		// the last function at or before addr
+	mid = (low + high + 1) / 2;
+	if (functionAddr[mid] <= addr)
+	    low = mid;
+	else
+	    high = mid - 1;
+    }
+    return low;
+}
+
+//----------------------------------------------------------------------
+// Profile::Call
+// 	Count a call from the instruction at "from" to "to".
+//----------------------------------------------------------------------
+
+void
+Profile::Call(int from, int to)
+{
+    unsigned int h = ((unsigned int) from / 4 * 31 + (unsigned int) to / 4)
+							% MaxCallArcs;
+
+    for (int i = 0; i < MaxCallArcs; i++) {
+	CallArc *arc = &arcs[(h + i) % MaxCallArcs];
+
+	if ((arc->from == from) && (arc->to == to)) {
+	    arc->count++;
+	    return;
+	}
+	if (arc->count == 0) {
+	    arc->from = from;
+	    arc->to = to;
+	    arc->count = 1;
+	    return;
+	}
+    }
+    lostCalls++;
+}
+
+// Working storage for Profile::Print, one entry per function: its own
+// samples, the calls to it, and its samples along with those of what
+// it calls (and whether that has been worked out yet); and the calls,
+// by function.
+
+static int *selfSamples;
+static int *callsTo;
+static double *totalSamples;
+static char *totalState;		// how far along that is
+static int numCallArcs;
+static int *arcFrom, *arcTo, *arcCount;
+
+#define TotalNotYet	0
+#define TotalWorkingOn	1
+#define TotalDone	2
+
+//----------------------------------------------------------------------
+// TotalSamples
+// 	Return the samples in function "f", along with its share of those
+//	in everything it calls: for each function it calls, the fraction
+//	of the calls to that function that came from "f".  A call that
+//	goes back round to a function still being worked out (a recursive
+//	one) only counts once, in that function.
+//----------------------------------------------------------------------
+
+static double
+TotalSamples(int f)
+{
+    int i, g;
+
+    if (totalState[f] == TotalDone)
+	return totalSamples[f];
+    totalState[f] = TotalWorkingOn;
+    totalSamples[f] = selfSamples[f];
+    for (i = 0; i < numCallArcs; i++) {
+	g = arcTo[i];
+	if ((arcFrom[i] == f) && (totalState[g] == TotalNotYet))
+	    totalSamples[f] += TotalSamples(g) * arcCount[i] / callsTo[g];
+	else if ((arcFrom[i] == f) && (totalState[g] == TotalDone))
+	    totalSamples[f] += totalSamples[g] * arcCount[i] / callsTo[g];
+    }
+    totalState[f] = TotalDone;
+    return totalSamples[f];
+}
+
+//----------------------------------------------------------------------
+// Profile::Print
+// 	Print the flat profile -- the functions, by the samples in them --
+//	and the call graph: for each function, who called it, and what it
+//	called, how many times.
+//
+//	"interval" is the ticks between samples, to say so.
+//----------------------------------------------------------------------
+
+void
+Profile::Print(int interval)
+{
+    int *order = new int[numFunctions];
+    int i, j, f, end, inside = 0, cumulative = 0;
+
+    selfSamples = new int[numFunctions];
+    callsTo = new int[numFunctions];
+    totalSamples = new double[numFunctions];
+    totalState = new char[numFunctions];
+    arcFrom = new int[MaxCallArcs];
+    arcTo = new int[MaxCallArcs];
+    arcCount = new int[MaxCallArcs];
+
+    for (f = 0; f < numFunctions; f++) {
+	end = (f + 1 < numFunctions) ? functionAddr[f + 1]
+						: textStart + textSize;
+	selfSamples[f] = 0;
+	for (i = functionAddr[f]; i < end; i += 4)
+	    selfSamples[f] += hits[(i - textStart) / 4];
+	inside += selfSamples[f];
+	callsTo[f] = 0;
+	totalState[f] = TotalNotYet;
+    }
+    numCallArcs = 0;
+    for (i = 0; i < MaxCallArcs; i++)
+	if ((arcs[i].count != 0) && (Lookup(arcs[i].from) >= 0)
+				&& (Lookup(arcs[i].to) >= 0)) {
+	    arcFrom[numCallArcs] = Lookup(arcs[i].from);
+	    arcTo[numCallArcs] = Lookup(arcs[i].to);
+	    arcCount[numCallArcs] = arcs[i].count;
+	    callsTo[arcTo[numCallArcs]] += arcs[i].count;
+	    numCallArcs++;
+	}
+    for (f = 0; f < numFunctions; f++)
+	TotalSamples(f);
+
+    for (i = 0; i < numFunctions; i++) {	// busiest first
+	f = i;
+	for (j = i; (j > 0) && ((selfSamples[order[j - 1]] < selfSamples[f])
+		    || ((selfSamples[order[j - 1]] == selfSamples[f])
+			    && (callsTo[order[j - 1]] < callsTo[f]))); j--)
+	    order[j] = order[j - 1];
+	order[j] = f;
+    }
+
+    printf("\nFlat profile of %s: %d samples, one every %d ticks of "
+			"user time\n", name, samples, interval);
+    printf("  %%time cumul%%     self    calls  function\n");
+    for (i = 0; i < numFunctions; i++) {
+	f = order[i];
+	if ((selfSamples[f] == 0) && (callsTo[f] == 0))
+	    continue;
+	cumulative += selfSamples[f];
+	printf("%7.2f %6.2f %8d %8d  %s\n",
+		samples ? 100.0 * selfSamples[f] / samples : 0.0,
+		samples ? 100.0 * cumulative / samples : 0.0,
+		selfSamples[f], callsTo[f], functionName[f]);
+    }
+    if (samples > inside)
+	printf("  (%d samples outside any function)\n", samples - inside);
+
+    printf("\nCall graph of %s, in samples (self, and with what it calls):\n",
+								name);
+    for (i = 0; i < numFunctions; i++) {
+	f = order[i];
+	if ((selfSamples[f] == 0) && (callsTo[f] == 0))
+	    continue;
+	printf("%s: self %d, total %.1f, called %d times\n", functionName[f],
+			selfSamples[f], totalSamples[f], callsTo[f]);
+	for (j = 0; j < numCallArcs; j++)
+	    if (arcTo[j] == f)
+		printf("\t%8d from %s\n", arcCount[j],
+						functionName[arcFrom[j]]);
+	for (j = 0; j < numCallArcs; j++)
+	    if ((arcFrom[j] == f) && (arcTo[j] != f))
+		printf("\t%8d to %s (%.1f)\n", arcCount[j],
+			functionName[arcTo[j]],
+		totalSamples[arcTo[j]] * arcCount[j] / callsTo[arcTo[j]]);
+    }
+    if (lostCalls > 0)
+	printf("  (%d calls not counted; the call table was full)\n",
+								lostCalls);
+
+    delete [] order;
+    delete [] selfSamples;
+    delete [] callsTo;
+    delete [] totalSamples;
+    delete [] totalState;
+    delete [] arcFrom;
+    delete [] arcTo;
+    delete [] arcCount;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Profiler
+// 	Set up to profile user programs, taking a sample every "interval"
+//	ticks of user time.
+//----------------------------------------------------------------------
+
+Profiler::Profiler(int sampleInterval)
+{
+    ASSERT(sampleInterval > 0);
+    interval = sampleInterval;
+    untilSample = interval;
+    numProfiles = 0;
+}
+
+//----------------------------------------------------------------------
+// Profiler::~Profiler
+//----------------------------------------------------------------------
+
+Profiler::~Profiler()
+{
+    for (int i = 0; i < numProfiles; i++)
+	delete profiles[i];
+}
+
+//----------------------------------------------------------------------
+// Profiler::Find
+// 	Return the profile for the program in "fileName", setting it up
+//	the first time the program is run.  Several copies of a program
+//	share a profile.  Return NULL if the program has no symbols, or
+//	too many programs have been run already.
+//----------------------------------------------------------------------
+
+Profile *
+Profiler::Find(char *fileName)
+{
+    Profile *profile;
+
+    for (int i = 0; i < numProfiles; i++)
+	if (!strcmp(profiles[i]->Name(), fileName))
+	    return profiles[i]->HasSymbols() ? profiles[i] : NULL;
+    if (numProfiles == MaxProfiles)
+	return NULL;
+    profile = new Profile(fileName);
+    profiles[numProfiles++] = profile;
+    return profile->HasSymbols() ? profile : NULL;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Sample
+// 	Count a sample against the running program, at its PC, and start
+//	counting down to the next one.
+//----------------------------------------------------------------------
+
+void
+Profiler::Sample()
+{
+    untilSample = interval;
+    if ((currentThread->space != NULL)
+			&& (currentThread->space->profile != NULL))
+	currentThread->space->profile->Sample(machine->ReadRegister(PCReg));
+}
+
+//----------------------------------------------------------------------
+// Profiler::Call
+// 	The running program made a call, from "from" to "to"; count it.
+//----------------------------------------------------------------------
+
+void
+Profiler::Call(int from, int to)
+{
+    if ((currentThread->space != NULL)
+			&& (currentThread->space->profile != NULL))
+	currentThread->space->profile->Call(from, to);
+}
+
+//----------------------------------------------------------------------
+// Profiler::Print
+// 	Print the profile of every program that had one.
+//----------------------------------------------------------------------
+
+void
+Profiler::Print()
+{
+    for (int i = 0; i < numProfiles; i++)
+	if (profiles[i]->HasSymbols())
+	    profiles[i]->Print(interval);
+}
@@ -0,0 +1,111 @@
+// profile.h
+//	Data structures for profiling user programs (-prof).
+//
+//	Every so many ticks of user time, the profiler looks at the PC of
+//	whatever user program is running, and counts a sample against
+//	that instruction.  It also counts every call (jal or jalr), by
+//	where it was called from and where it went.  When Nachos halts,
+//	the samples and calls are put down to the functions they fell in,
+//	and printed as a flat profile and a call graph, for each program.
+//
+//	The functions come from the symbol table of the program's COFF
+//	file -- the one coff2noff made the NOFF file from, which is taken
+//	to be the UNIX file with the NOFF file's name, plus ".coff" (so
+//	"-x ../test/sort" looks for "../test/sort.coff").  A program with
+//	no COFF file isn't profiled.
+//
+//	All the work is done when Nachos halts, except for the sample
+//	itself, which is a counter bumped on the instruction's slot in an
+//	array, and each call, which is a counter in a hash table; so with
+//	the usual interval, profiling slows Nachos down hardly at all.
+
+#include "copyright.h"
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#define DefaultProfileInterval	100	// ticks of user time between samples
+#define MaxProfiles		16	// programs profiled at once
+#define MaxCallArcs		1024	// different calls remembered, per
+					// program
+
+// The following class defines one kind of call: from where, to where,
+// and how many times.
+
+class CallArc {
+  public:
+    int from;			// Address of the jal or jalr
+    int to;			// Where it went
+    int count;			// How many times; 0 if unused
+};
+
+// The following class defines the profile of one program.
+
+class Profile {
+  public:
+    Profile(char *fileName);		// Set up to profile the program
+					// in "fileName"
+    ~Profile();
+
+    bool HasSymbols() { return numFunctions > 0; }
+    char *Name() { return name; }
+
+    void Sample(int pc) {		// The program was at "pc"
+	samples++;
+	if ((unsigned int) (pc - textStart) < (unsigned int) textSize)
+	    hits[(pc - textStart) / 4]++;
+    }
+    void Call(int from, int to);	// A jal or jalr at "from" went to "to"
+
+    void Print(int interval);		// Print the flat profile and call
+					// graph
+
+  private:
+    char *name;				// The program's file name
+    int textStart, textSize;		// Where its code is
+    int *hits;				// Samples, for each instruction
+    int samples;			// All of them, even outside the code
+
+    int numFunctions;			// The functions, by address
+    int *functionAddr;
+    char **functionName;
+    char *strings;			// The functions' names
+
+    CallArc arcs[MaxCallArcs];		// The calls, hashed on where from
+    int lostCalls;			// Calls the table had no room for
+
+    bool ReadSymbols(char *coffName);	// Fill in the functions
+    int Lookup(int addr);		// Which function "addr" is in; -1 if
+					// none
+};
+
+// The following class defines the profiler, with a profile for each
+// program run.
+
+class Profiler {
+  public:
+    Profiler(int interval);		// Sample every "interval" ticks of
+					// user time
+    ~Profiler();
+
+    Profile *Find(char *fileName);	// The profile for "fileName", set
+					// up the first time; NULL if it has
+					// no symbols
+    void Tick() {			// One more tick of user time
+	if (--untilSample <= 0)
+	    Sample();
+    }
+    void Call(int from, int to);	// The running program made a call
+
+    void Print();			// Print every program's profile
+
+  private:
+    int interval;
+    int untilSample;			// Ticks to go before the next sample
+    Profile *profiles[MaxProfiles];
+    int numProfiles;
+
+    void Sample();			// Sample the running program's PC
+};
+
+#endif // PROFILE_H
@@ -32,6 +32,10 @@ StartProcess(char *filename)
     }
     space = new AddrSpace(executable);    
     currentThread->space = space;
+    space->account = accounting->NewProcess(filename);
+    currentThread->account->process = space->account;
+    if (profiler != NULL)
+	space->profile = profiler->Find(filename);
 
     delete executable;			// close file
 
@@ -44,6 +48,27 @@ StartProcess(char *filename)
 					// by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// StartProcesses
+// 	Run "copies" copies of a user program at once, each in an address
+//	space and a thread of its own.  On a multiprocessor, the other
+//	CPUs pick them up (cf. cpu.h).
+//----------------------------------------------------------------------
+
+static void
+ProcessThread(int filename)
+{
+    StartProcess((char *) filename);
+}
+
+void
+StartProcesses(char *filename, int copies)
+{
+    for (int i = 1; i < copies; i++)
+	(new Thread("user program"))->Fork(ProcessThread, (int) filename);
+    StartProcess(filename);
+}
+
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
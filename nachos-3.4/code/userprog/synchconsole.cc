@@ -0,0 +1,210 @@
+// synchconsole.cc
+//	Routines to synchronously access the console.  The console is an
+//	asynchronous device (a write returns immediately, and an
+//	interrupt happens later on; so does the arrival of a character).
+//	This is a layer on top of the console providing a synchronous
+//	interface, with output batched up in a ring buffer (see
+//	synchconsole.h).
+//
+//	The ring is shared with the write-done interrupt handler, which
+//	starts the next burst as soon as the last one is done, so it is
+//	only touched with interrupts off.  The handler only wakes up a
+//	writer if one is waiting (for room, or for the ring to empty).
+
+#include "copyright.h"
+#include "synchconsole.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ConsoleWriteDone, ConsoleReadAvail
+// 	Console interrupt handlers.  Need these to be C routines, because
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+ConsoleWriteDone(int arg)
+{
+    SynchConsole *console = (SynchConsole *) arg;
+
+    console->WriteDone();
+}
+
+static void
+ConsoleReadAvail(int arg)
+{
+    SynchConsole *console = (SynchConsole *) arg;
+
+    console->ReadAvail();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::SynchConsole
+// 	Initialize the synchronous interface to the console, in turn
+//	initializing the console device.
+//
+//	"readFile", "writeFile" -- UNIX files for the keyboard and the
+//	   display (NULL for stdin and stdout)
+//----------------------------------------------------------------------
+
+SynchConsole::SynchConsole(char *readFile, char *writeFile)
+{
+    writeLock = new Lock("synch console write");
+    readLock = new Lock("synch console read");
+    burstDone = new Semaphore("synch console burst", 0);
+    charAvail = new Semaphore("synch console char", 0);
+    head = count = inFlight = 0;
+    waiting = FALSE;
+    console = new Console(readFile, writeFile, ConsoleReadAvail,
+					ConsoleWriteDone, (int) this);
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::~SynchConsole
+// 	De-allocate data structures needed for the synchronous console
+//	abstraction.
+//----------------------------------------------------------------------
+
+SynchConsole::~SynchConsole()
+{
+    delete console;
+    delete writeLock;
+    delete readLock;
+    delete burstDone;
+    delete charAvail;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Write
+// 	Copy "data" into the output ring, starting the console on it if
+//	it isn't busy already, and return.  If the ring fills up, wait
+//	for the console to make room.
+//
+//	"data" -- the characters to write
+//	"length" -- how many of them
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Write(char *data, int length)
+{
+    IntStatus oldLevel;
+    int n, tail, first;
+
+    writeLock->Acquire();
+    while (length > 0) {
+	oldLevel = interrupt->SetLevel(IntOff);
+	n = min(length, ConsoleRingSize - count);
+	if (n == 0) {				// ring is full
+	    waiting = TRUE;
+	    (void) interrupt->SetLevel(oldLevel);
+	    burstDone->P();
+	    continue;
+	}
+	tail = (head + count) % ConsoleRingSize;
+	first = min(n, ConsoleRingSize - tail);	// up to the end of the ring
+	bcopy(data, ring + tail, first);
+	bcopy(data + first, ring, n - first);	// and the rest wraps around
+	count += n;
+	data += n;
+	length -= n;
+	if (inFlight == 0)			// console is idle
+	    StartBurst();
+	(void) interrupt->SetLevel(oldLevel);
+    }
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Flush
+// 	Wait until everything written so far has been displayed.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Flush()
+{
+    IntStatus oldLevel;
+    bool empty;
+
+    writeLock->Acquire();
+    for (;;) {
+	oldLevel = interrupt->SetLevel(IntOff);
+	empty = (count == 0);
+	if (!empty)
+	    waiting = TRUE;
+	(void) interrupt->SetLevel(oldLevel);
+	if (empty)
+	    break;
+	burstDone->P();
+    }
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Read
+// 	Read characters from the keyboard, waiting for each one to arrive,
+//	until we have "length" of them, or a newline.
+//
+//	"data" -- where to put the characters
+//	"length" -- most to read
+//----------------------------------------------------------------------
+
+int
+SynchConsole::Read(char *data, int length)
+{
+    int n = 0;
+
+    readLock->Acquire();
+    while (n < length) {
+	charAvail->P();
+	data[n] = console->GetChar();
+	if (data[n++] == '\n')
+	    break;
+    }
+    readLock->Release();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::StartBurst
+// 	Hand the console as much of the ring as it can take in one go --
+//	everything up to the end of the ring.  Called with interrupts off,
+//	when the console is idle and the ring isn't empty.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::StartBurst()
+{
+    inFlight = min(count, ConsoleRingSize - head);
+    console->PutChars(ring + head, inFlight);
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::WriteDone
+// 	A burst has been written: take it out of the ring, start on the
+//	next one, if there is more, and wake up anyone waiting for room.
+//	Called by the console's interrupt handler.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::WriteDone()
+{
+    head = (head + inFlight) % ConsoleRingSize;
+    count -= inFlight;
+    inFlight = 0;
+    if (count > 0)
+	StartBurst();
+    if (waiting) {
+	waiting = FALSE;
+	burstDone->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::ReadAvail
+// 	A character has arrived.  Called by the console's interrupt handler.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::ReadAvail()
+{
+    charAvail->V();
+}
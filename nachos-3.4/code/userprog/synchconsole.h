@@ -0,0 +1,67 @@
+// synchconsole.h
+//	Data structures to export a synchronous interface to the console
+//	device, for the Read and Write system calls.
+//
+//	Output goes into a ring buffer, and Write returns as soon as its
+//	data is in the ring (waiting only if the ring is full).  The
+//	console writes out whatever has piled up in the ring in one burst
+//	(cf. Console::PutChars); while it is busy, later writes pile up
+//	for the next burst.  So a program printing line after line costs
+//	one interrupt, and one UNIX write, per burst rather than per
+//	character.
+//
+//	Input still arrives a character at a time; Read waits for each one.
+
+#include "copyright.h"
+
+#ifndef SYNCHCONSOLE_H
+#define SYNCHCONSOLE_H
+
+#include "console.h"
+#include "synch.h"
+
+#define ConsoleRingSize		4096	// bytes of output that can be
+					// waiting to go out
+
+// The following class defines a "synchronous" console abstraction.
+// Any number of threads may read and write at once; each Write's
+// characters come out together, in the order the Writes were made.
+
+class SynchConsole {
+  public:
+    SynchConsole(char *readFile, char *writeFile);
+				// Initialize the console device; NULL means
+				// stdin or stdout
+    ~SynchConsole();		// De-allocate the synch console data
+
+    void Write(char *data, int length);
+				// Queue "length" characters to be written;
+				// return once they are in the ring
+    int Read(char *data, int length);
+				// Wait for up to "length" characters,
+				// stopping early at a newline; return how
+				// many were read
+    void Flush();		// Wait until all the queued output has
+				// been written
+
+    void WriteDone();		// Called by the console device interrupt
+    void ReadAvail();		// handlers
+
+  private:
+    Console *console;		// Raw console device
+    Lock *writeLock;		// Only one Write (or Flush) at a time
+    Lock *readLock;		// Only one Read at a time
+    Semaphore *burstDone;	// V'ed when a burst has been written,
+    bool waiting;		//   if a writer is waiting for that
+    Semaphore *charAvail;	// V'ed when a character has arrived
+
+    char ring[ConsoleRingSize];	// Output not yet written, oldest first,
+    int head;			//   starting at ring[head]
+    int count;
+    int inFlight;		// # of those the device is writing now
+
+    void StartBurst();		// Write out all the output we can in one
+				// go; called with interrupts off
+};
+
+#endif // SYNCHCONSOLE_H
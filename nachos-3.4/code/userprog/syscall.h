@@ -29,6 +29,8 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_Seek		11
+#define SC_GetUsage	12
 
 #ifndef IN_ASM
 
@@ -65,7 +67,7 @@ SpaceId Exec(char *name);
 int Join(SpaceId id); 	
  
 
-/* File system operations: Create, Open, Read, Write, Close
+/* File system operations: Create, Open, Read, Write, Seek, Close
  * These functions are patterned after UNIX -- files represent
  * both files *and* hardware I/O devices.
  *
@@ -105,6 +107,12 @@ void Write(char *buffer, int size, OpenFileId id);
  */
 int Read(char *buffer, int size, OpenFileId id);
 
+/* Move the place in the open file where the next Read or Write starts
+ * to "position" bytes from the beginning.  Each OpenFileId has its own
+ * place, even if the same file is open more than once.
+ */
+void Seek(int position, OpenFileId id);
+
 /* Close the file, we're done reading and writing to it. */
 void Close(OpenFileId id);
 
@@ -124,6 +132,31 @@ void Fork(void (*func)());
  */
 void Yield();		
 
+
+/* Accounting: GetUsage.  How much CPU time the thread, the user program,
+ * or the whole machine has had, and how it got on with the scheduler.
+ * Times are in ticks.
+ */
+
+typedef struct {
+    int userTicks;		/* time running user code */
+    int systemTicks;		/* time running in the kernel */
+    int readyTicks;		/* time waiting to run */
+    int blockedTicks;		/* time blocked */
+    int voluntarySwitches;	/* times it gave up the CPU itself */
+    int involuntarySwitches;	/* times its time slice ran out */
+    int totalTicks;		/* time since Nachos started */
+} UsageInfo;
+
+#define UsageThread	0	/* the thread calling GetUsage */
+#define UsageProcess	1	/* all the threads of its program */
+#define UsageSystem	2	/* every thread there has been */
+
+/* Fill in "usage" for "who" (one of the above).  Return 0, or -1 if
+ * "who" or "usage" is bad.
+ */
+int GetUsage(int who, UsageInfo *usage);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
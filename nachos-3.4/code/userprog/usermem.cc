@@ -0,0 +1,151 @@
+// usermem.cc
+//	Routines to move data between the kernel and user memory, a page
+//	at a time.  See usermem.h.
+
+#include "copyright.h"
+#include "usermem.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// TranslateUser
+// 	Return where the user virtual address "virtAddr" is in main memory,
+//	or NULL if it isn't mapped.  On a page fault, let the kernel's
+//	exception handler bring the page in first, as if the program had
+//	faulted on it itself.
+//----------------------------------------------------------------------
+
+static char *
+TranslateUser(int virtAddr, bool writing)
+{
+    ExceptionType exception;
+    int physAddr;
+
+    exception = machine->Translate(virtAddr, &physAddr, 1, writing);
+    if (exception == PageFaultException) {
+	machine->WriteRegister(BadVAddrReg, virtAddr);
+	ExceptionHandler(PageFaultException);
+	exception = machine->Translate(virtAddr, &physAddr, 1, writing);
+    }
+    if (exception != NoException) {
+	DEBUG('a', "Bad user address 0x%x in system call\n", virtAddr);
+	return NULL;
+    }
+    return &machine->mainMemory[physAddr];
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::UserBuffer
+// 	Set up to walk a buffer in user memory.
+//
+//	"virtAddr" -- where the buffer is, in the user's address space
+//	"length" -- how long it is
+//	"writing" -- TRUE if the kernel will put data in it
+//----------------------------------------------------------------------
+
+UserBuffer::UserBuffer(int virtAddr, int length, bool isWriting)
+{
+    addr = virtAddr;
+    left = (length > 0) ? length : 0;
+    writing = isWriting;
+    done = 0;
+}
+
+//----------------------------------------------------------------------
+// UserBuffer::NextSpan
+// 	Return the next piece of the buffer: from where we are up to the
+//	end of its page, and on through any following pages that come
+//	right after it in main memory, up to the end of the buffer.  Each
+//	page is only translated once.
+//
+//	"spanLength" -- set to the length of the piece
+//----------------------------------------------------------------------
+
+char *
+UserBuffer::NextSpan(int *spanLength)
+{
+    char *span, *more;
+    int n, step;
+
+    if (left == 0)
+	return NULL;
+    span = TranslateUser(addr, writing);
+    if (span == NULL) {
+	left = 0;			// give up on the rest
+	return NULL;
+    }
+    n = PageSize - (addr % PageSize);
+    if (n > left)
+	n = left;
+    while (n < left) {			// does the next page follow on?
+	more = TranslateUser(addr + n, writing);
+	if (more != span + n)
+	    break;			// no (or it's bad); next time
+	step = (left - n < PageSize) ? left - n : PageSize;
+	n += step;
+    }
+    addr += n;
+    left -= n;
+    done += n;
+    *spanLength = n;
+    return span;
+}
+
+//----------------------------------------------------------------------
+// CopyFromUser, CopyToUser
+// 	Copy "length" bytes between "buffer" in the kernel and "virtAddr"
+//	in user memory, a page at a time.  Return how many bytes were
+//	copied -- fewer than asked for only at a bad address.
+//----------------------------------------------------------------------
+
+int
+CopyFromUser(int virtAddr, char *buffer, int length)
+{
+    UserBuffer user(virtAddr, length, FALSE);
+    char *span;
+    int n, copied = 0;
+
+    while ((span = user.NextSpan(&n)) != NULL) {
+	bcopy(span, buffer + copied, n);
+	copied += n;
+    }
+    return copied;
+}
+
+int
+CopyToUser(char *buffer, int virtAddr, int length)
+{
+    UserBuffer user(virtAddr, length, TRUE);
+    char *span;
+    int n, copied = 0;
+
+    while ((span = user.NextSpan(&n)) != NULL) {
+	bcopy(buffer + copied, span, n);
+	copied += n;
+    }
+    return copied;
+}
+
+//----------------------------------------------------------------------
+// CopyStringFromUser
+// 	Copy a null-terminated string in from user memory, a page at a
+//	time, stopping at the null.  Return the length of the string, or
+//	-1 if it (and its null) doesn't fit in "size" bytes, or if it runs
+//	into a bad address.
+//----------------------------------------------------------------------
+
+int
+CopyStringFromUser(int virtAddr, char *buffer, int size)
+{
+    UserBuffer user(virtAddr, size, FALSE);
+    char *span;
+    int i, n, length = 0;
+
+    while ((span = user.NextSpan(&n)) != NULL)
+	for (i = 0; i < n; i++) {
+	    buffer[length] = span[i];
+	    if (span[i] == '\0')
+		return length;
+	    length++;
+	}
+    return -1;
+}
@@ -0,0 +1,64 @@
+// usermem.h
+//	Routines for the kernel to get at a user program's memory, for
+//	system calls that are passed buffers and strings.
+//
+//	Going through Machine::ReadMem and WriteMem costs a full address
+//	translation per byte.  These walk a user address range a page at
+//	a time instead: each page is translated once, and its part of the
+//	range is then copied straight to or from main memory -- or handed
+//	out as is, as a span of main memory that an I/O routine can read
+//	from or fill in, with no copy at all.  Pages that follow one
+//	another in main memory as well go out as one span, so a large
+//	transfer takes as few I/O calls as the page mapping allows.
+//
+//	If a page isn't there (a page fault, or a TLB miss), the kernel's
+//	exception handler gets the chance to bring it in, just as if the
+//	user program had touched it, and the translation is tried again.
+//	An address that still can't be translated ends the walk, and the
+//	system call gets back how far it got.
+//
+//	A span points into main memory, so once paging is implemented, it
+//	is only good until its page might be replaced.
+
+#include "copyright.h"
+
+#ifndef USERMEM_H
+#define USERMEM_H
+
+// The following class defines a walk over a buffer in user memory,
+// one span (a run of pages that are contiguous in main memory) at a time.
+
+class UserBuffer {
+  public:
+    UserBuffer(int virtAddr, int length, bool writing);
+				// Set up to walk "length" bytes at
+				// "virtAddr"; "writing" if the kernel is
+				// going to put data there
+
+    char *NextSpan(int *spanLength);
+				// Return the next piece of the buffer, as
+				// a pointer into main memory, and its length;
+				// NULL at the end, or at a bad address
+    int BytesDone() { return done; }
+				// How much of the buffer has been handed
+				// out so far
+
+  private:
+    int addr;			// Where the rest of the buffer starts
+    int left;			// How much of it there is
+    bool writing;
+    int done;
+};
+
+extern int CopyFromUser(int virtAddr, char *buffer, int length);
+				// Copy "length" bytes in from user memory;
+				// return how many could be copied
+extern int CopyToUser(char *buffer, int virtAddr, int length);
+				// Likewise, out to user memory
+extern int CopyStringFromUser(int virtAddr, char *buffer, int size);
+				// Copy in a null-terminated string, of
+				// at most "size" bytes with the null; return
+				// its length, or -1 if it doesn't fit or
+				// runs into a bad address
+
+#endif // USERMEM_H